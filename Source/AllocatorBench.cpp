@@ -0,0 +1,624 @@
+// Replays an allocation trace through the allocators the upload heap can
+// use and compares their speed and how well they use the space, and fuzzes
+// them together with HandleAlloc.
+//
+//   AllocatorBench [trace file]
+//   AllocatorBench synth <trace file> [frames] [seed]
+//   AllocatorBench fuzz [operations] [seed]
+//
+// Without a file, a synthetic trace shaped like the uploads of a streaming
+// scene is used: small constant and vertex updates every frame, meshes and
+// textures now and then, each freed a few frames later. A recorded trace
+// comes from the upload heap built with UPLOAD_HEAP_TRACE, synth writes the
+// synthetic one to a file so it can be replayed elsewhere. The trace is also
+// replayed through a HandleAlloc, an allocation taking a handle.
+//
+// fuzz makes random requests, sizes of 0 and larger than the heap included,
+// on small heaps that fill up often, and checks after every one that the
+// allocator passes validate(), that the blocks it gives are inside the heap
+// and don't overlap, and that its free space adds up. HandleAlloc gets random
+// Alloc, Free, Retire and Recycle calls and is checked with Validate() and
+// against the handles it should have. It returns 1 on the first failure, to
+// be used as a regression gate for allocator changes. Off Windows it builds
+// with:
+//
+//   g++ -std=c++14 -O2 -ISource Source/AllocatorBench.cpp -o AllocatorBench
+//
+// A trace is text, one request per line: "+ <id> <size>" allocates, "- <id>"
+// frees what the allocation with that id got. Lines starting with # are
+// skipped.
+
+#include "BuddyAllocator.h"
+#include "HandleAlloc.h"
+#include "TLSFAllocator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	using namespace bamboo;
+
+	// the upload heap configuration, see UploadHeapDX12.h
+	constexpr uint64_t HeapSize = 32 * 1024 * 1024;
+	constexpr uint64_t HeapMinSize = 64 * 1024;
+
+	typedef memory::FastBuddyAllocator<HeapSize, HeapMinSize> buddy_alloc_t;
+	typedef memory::TLSFAllocator<HeapSize, HeapMinSize> tlsf_alloc_t;
+
+	// small heaps for the fuzzing, they run out of space every few requests
+	constexpr uint64_t FuzzHeapSize = 1024 * 1024;
+	constexpr uint64_t FuzzMinSize = 4 * 1024;
+
+	typedef memory::FastBuddyAllocator<FuzzHeapSize, FuzzMinSize> fuzz_buddy_alloc_t;
+	typedef memory::TLSFAllocator<FuzzHeapSize, FuzzMinSize, uint32_t> fuzz_tlsf_alloc_t;
+	typedef memory::TLSFAllocator<FuzzHeapSize, 256> fuzz_fine_tlsf_alloc_t;
+
+	constexpr size_t FuzzHandleCount = 1000;
+
+	struct TraceOp
+	{
+		uint32_t					slot;		// dense index of the allocation id
+		bool						alloc;
+		uint64_t					size;
+	};
+
+	struct Trace
+	{
+		std::vector<TraceOp>		ops;
+		uint32_t					slotCount;
+		uint32_t					allocCount;
+	};
+
+	bool LoadTrace(const char* filename, Trace& trace)
+	{
+		FILE* fp = fopen(filename, "r");
+		if (nullptr == fp) return false;
+
+		std::unordered_map<unsigned long long, uint32_t> slots;
+		trace.ops.clear();
+		trace.slotCount = 0;
+		trace.allocCount = 0;
+
+		char line[256];
+		bool ok = true;
+		while (ok && nullptr != fgets(line, sizeof(line), fp))
+		{
+			unsigned long long id, size;
+			if ('#' == line[0] || '\n' == line[0])
+				continue;
+
+			if (2 == sscanf(line, "+ %llu %llu", &id, &size))
+			{
+				// an id can be used again once it was freed
+				uint32_t slot = trace.slotCount++;
+				slots[id] = slot;
+				trace.ops.push_back(TraceOp{ slot, true, size });
+				trace.allocCount++;
+			}
+			else if (1 == sscanf(line, "- %llu", &id))
+			{
+				auto it = slots.find(id);
+				ok = it != slots.end();
+				if (ok)
+				{
+					trace.ops.push_back(TraceOp{ it->second, false, 0 });
+					slots.erase(it);
+				}
+			}
+			else
+			{
+				ok = false;
+			}
+		}
+
+		fclose(fp);
+		return ok;
+	}
+
+	// xorshift, so a seed gives the same trace everywhere
+	struct Random
+	{
+		uint64_t					state;
+
+		explicit Random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+		uint64_t Next()
+		{
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return state;
+		}
+
+		uint64_t Range(uint64_t lo, uint64_t hi)
+		{
+			return lo + Next() % (hi - lo + 1);
+		}
+	};
+
+	void SynthesizeTrace(uint32_t frameCount, uint64_t seed, Trace& trace)
+	{
+		Random random(seed);
+
+		struct Pending { uint32_t slot; uint32_t frame; };
+		std::vector<Pending> pending;
+
+		trace.ops.clear();
+		trace.slotCount = 0;
+		trace.allocCount = 0;
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			uint32_t uploads = static_cast<uint32_t>(random.Range(8, 32));
+			for (uint32_t i = 0; i < uploads; ++i)
+			{
+				uint64_t kind = random.Range(0, 99);
+				uint64_t size;
+				uint32_t lifetime;
+				if (kind < 70)
+				{
+					// constants and small dynamic buffers, gone once the GPU has the frame
+					size = random.Range(64, 4 * 1024);
+					lifetime = 2;
+				}
+				else if (kind < 95)
+				{
+					size = random.Range(4 * 1024, 256 * 1024);
+					lifetime = static_cast<uint32_t>(random.Range(1, 6));
+				}
+				else
+				{
+					size = random.Range(256 * 1024, 4 * 1024 * 1024);
+					lifetime = static_cast<uint32_t>(random.Range(2, 8));
+				}
+
+				uint32_t slot = trace.slotCount++;
+				trace.ops.push_back(TraceOp{ slot, true, size });
+				trace.allocCount++;
+				pending.push_back(Pending{ slot, frame + lifetime });
+			}
+
+			// frees in the order the uploads were made, as the upload heap does
+			for (size_t i = 0; i < pending.size();)
+			{
+				if (pending[i].frame <= frame)
+				{
+					trace.ops.push_back(TraceOp{ pending[i].slot, false, 0 });
+					pending.erase(pending.begin() + i);
+				}
+				else
+				{
+					++i;
+				}
+			}
+		}
+
+		for (const Pending& p : pending)
+			trace.ops.push_back(TraceOp{ p.slot, false, 0 });
+	}
+
+	bool WriteTrace(const char* filename, const Trace& trace)
+	{
+		FILE* fp = fopen(filename, "w");
+		if (nullptr == fp) return false;
+
+		fprintf(fp, "# bamboo allocation trace\n");
+		for (const TraceOp& op : trace.ops)
+		{
+			if (op.alloc)
+				fprintf(fp, "+ %u %llu\n", op.slot, static_cast<unsigned long long>(op.size));
+			else
+				fprintf(fp, "- %u\n", op.slot);
+		}
+
+		fclose(fp);
+		return true;
+	}
+
+	struct Result
+	{
+		double						nsPerOp;
+		uint64_t					peakUsed;
+		double						internalFragmentation;	// average over the allocations
+		double						externalFragmentation;	// average over all the requests
+		uint32_t					failures;
+	};
+
+	// the allocator and the out of band memory it keeps its records in
+	template<typename Alloc>
+	struct Heap
+	{
+		std::vector<uint64_t>		treeMem;
+		Alloc*						alloc;
+
+		Heap()
+			:
+			treeMem(Alloc::treeSize / sizeof(uint64_t) + 1)
+		{
+			alloc = Alloc::create(treeMem.data());
+		}
+	};
+
+	template<typename Alloc>
+	Result Run(const Trace& trace)
+	{
+		Result result = {};
+		std::vector<uint64_t> offsets(trace.slotCount);
+		std::vector<uint64_t> requested(trace.slotCount);
+
+		// the metrics, in a pass of its own so the timing doesn't include them
+		{
+			Heap<Alloc> heap;
+			uint64_t requestedBytes = 0;
+			uint32_t allocated = 0;
+
+			for (const TraceOp& op : trace.ops)
+			{
+				if (op.alloc)
+				{
+					uint64_t offset = heap.alloc->allocateOffset(op.size);
+					offsets[op.slot] = offset;
+					if (Alloc::invalid_offset == offset)
+					{
+						result.failures++;
+						continue;
+					}
+
+					requested[op.slot] = op.size;
+					requestedBytes += op.size;
+
+					uint64_t used = HeapSize - heap.alloc->freeRemaining();
+					if (used > result.peakUsed)
+						result.peakUsed = used;
+					result.internalFragmentation += 1.0 - double(requestedBytes) / double(used);
+					allocated++;
+				}
+				else if (Alloc::invalid_offset != offsets[op.slot])
+				{
+					heap.alloc->deallocateOffset(offsets[op.slot]);
+					requestedBytes -= requested[op.slot];
+				}
+
+				uint64_t freeBytes = heap.alloc->freeRemaining();
+				if (freeBytes > 0)
+					result.externalFragmentation += 1.0 - double(heap.alloc->largestFree()) / double(freeBytes);
+			}
+
+			if (allocated > 0)
+				result.internalFragmentation /= allocated;
+			if (!trace.ops.empty())
+				result.externalFragmentation /= trace.ops.size();
+		}
+
+		// as many replays as fit in about half a second
+		uint64_t opCount = 0;
+		double seconds = 0.0;
+		while (seconds < 0.5 && !trace.ops.empty())
+		{
+			Heap<Alloc> heap;
+			auto start = std::chrono::steady_clock::now();
+
+			for (const TraceOp& op : trace.ops)
+			{
+				if (op.alloc)
+					offsets[op.slot] = heap.alloc->allocateOffset(op.size);
+				else if (Alloc::invalid_offset != offsets[op.slot])
+					heap.alloc->deallocateOffset(offsets[op.slot]);
+			}
+
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			opCount += trace.ops.size();
+		}
+		result.nsPerOp = opCount > 0 ? seconds * 1e9 / opCount : 0.0;
+
+		return result;
+	}
+
+	// the trace through a HandleAlloc, each allocation takes a handle, the
+	// sizes don't matter. Only the time and the failures are measured.
+	Result RunHandles(const Trace& trace)
+	{
+		Result result = {};
+		std::vector<uint32_t> handles(trace.slotCount);
+
+		uint32_t live = 0;
+		for (const TraceOp& op : trace.ops)
+		{
+			live += op.alloc ? 1 : -1;
+			if (live > result.peakUsed)
+				result.peakUsed = live;
+		}
+
+		uint64_t opCount = 0;
+		double seconds = 0.0;
+		while (seconds < 0.5 && !trace.ops.empty())
+		{
+			HandleAlloc<> alloc(HandleAlloc<>::maxCapacity);
+			uint32_t failures = 0;
+			auto start = std::chrono::steady_clock::now();
+
+			for (const TraceOp& op : trace.ops)
+			{
+				if (op.alloc)
+				{
+					handles[op.slot] = alloc.Alloc();
+					if (HandleAlloc<>::invalid == handles[op.slot])
+						failures++;
+				}
+				else
+				{
+					alloc.Free(handles[op.slot]);
+				}
+			}
+
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			opCount += trace.ops.size();
+			result.failures = failures;
+		}
+		result.nsPerOp = opCount > 0 ? seconds * 1e9 / opCount : 0.0;
+
+		return result;
+	}
+
+	// the blocks given out, offset to size, and how much free space they took
+	struct FuzzBlock
+	{
+		uint64_t					size;		// taken from the free space
+		uint64_t					requested;
+	};
+
+	template<typename Alloc>
+	bool FuzzAllocator(const char* name, uint64_t heapSize, uint64_t minSize, uint32_t opCount, uint64_t seed)
+	{
+		Heap<Alloc> heap;
+		Random random(seed);
+		std::map<uint64_t, FuzzBlock> blocks;
+		std::vector<uint64_t> offsets;
+		uint64_t usedBytes = 0;
+		uint32_t failures = 0;
+
+		auto fail = [&](uint32_t op, const char* what)
+		{
+			printf("%s: operation %u: %s\n", name, op, what);
+			return false;
+		};
+
+		for (uint32_t op = 0; op < opCount; ++op)
+		{
+			if (offsets.empty() || random.Range(0, 99) < 55)
+			{
+				uint64_t size;
+				switch (random.Range(0, 9))
+				{
+				case 0: size = 0; break;
+				case 1: size = minSize * random.Range(1, 8); break;
+				case 2: size = heapSize + random.Range(0, 1) * minSize; break;
+				case 3: size = random.Range(1, heapSize); break;
+				default: size = random.Range(1, minSize * 16); break;
+				}
+
+				bool expected = heap.alloc->canAllocate(size);
+				uint64_t freeBefore = heap.alloc->freeRemaining();
+				uint64_t offset = heap.alloc->allocateOffset(size);
+
+				if (Alloc::invalid_offset == offset)
+				{
+					if (expected)
+						return fail(op, "canAllocate said yes, allocateOffset failed");
+					if (heap.alloc->freeRemaining() != freeBefore)
+						return fail(op, "a failed allocation took space");
+					failures++;
+				}
+				else
+				{
+					uint64_t taken = freeBefore - heap.alloc->freeRemaining();
+					if (size > heapSize || taken < size || taken < minSize || offset % minSize != 0 || offset + taken > heapSize)
+						return fail(op, "block out of the heap or too small");
+
+					// the block after it and the one before it must not overlap it
+					auto next = blocks.lower_bound(offset);
+					if (next != blocks.end() && next->first < offset + taken)
+						return fail(op, "block overlaps the next one");
+					if (next != blocks.begin() && std::prev(next)->first + std::prev(next)->second.size > offset)
+						return fail(op, "block overlaps the previous one");
+
+					blocks[offset] = FuzzBlock{ taken, size };
+					offsets.push_back(offset);
+					usedBytes += taken;
+				}
+			}
+			else
+			{
+				size_t i = static_cast<size_t>(random.Range(0, offsets.size() - 1));
+				uint64_t offset = offsets[i];
+				offsets[i] = offsets.back();
+				offsets.pop_back();
+
+				uint64_t freeBefore = heap.alloc->freeRemaining();
+				heap.alloc->deallocateOffset(offset);
+
+				auto block = blocks.find(offset);
+				if (heap.alloc->freeRemaining() - freeBefore != block->second.size)
+					return fail(op, "free gave back another size than allocate took");
+
+				usedBytes -= block->second.size;
+				blocks.erase(block);
+			}
+
+			if (!heap.alloc->validate())
+				return fail(op, "validate failed");
+			if (heap.alloc->freeRemaining() != heapSize - usedBytes)
+				return fail(op, "free space doesn't add up");
+			if (heap.alloc->largestFree() > heap.alloc->freeRemaining())
+				return fail(op, "largest free block above the free space");
+		}
+
+		printf("%s: %u operations, %u failed allocations, ok\n", name, opCount, failures);
+		return true;
+	}
+
+	bool FuzzHandleAlloc(uint32_t opCount, uint64_t seed)
+	{
+		HandleAlloc<10> alloc(FuzzHandleCount);
+		Random random(seed);
+		std::vector<uint32_t> live;
+		std::vector<uint32_t> retired;		// slot indices
+		std::vector<uint32_t> stale;
+		uint32_t failures = 0;
+
+		auto fail = [&](uint32_t op, const char* what)
+		{
+			printf("handle alloc: operation %u: %s\n", op, what);
+			return false;
+		};
+
+		for (uint32_t op = 0; op < opCount; ++op)
+		{
+			uint64_t action = random.Range(0, 99);
+			if (live.empty() || action < 50)
+			{
+				uint32_t handle = alloc.Alloc();
+				if (HandleAlloc<10>::invalid == handle)
+				{
+					if (live.size() + retired.size() < FuzzHandleCount)
+						return fail(op, "Alloc failed with free slots");
+					failures++;
+				}
+				else
+				{
+					if (alloc.Count() != live.size() + 1)
+						return fail(op, "Count is off after Alloc");
+					live.push_back(handle);
+				}
+			}
+			else if (action < 80 || (action < 90 && retired.empty()))
+			{
+				size_t i = static_cast<size_t>(random.Range(0, live.size() - 1));
+				uint32_t handle = live[i];
+				live[i] = live.back();
+				live.pop_back();
+
+				if (action < 70)
+				{
+					alloc.Free(handle);
+				}
+				else
+				{
+					alloc.Retire(handle);
+					retired.push_back(HandleAlloc<10>::GetIndex(handle));
+				}
+
+				stale.push_back(handle);
+				if (stale.size() > 64)
+					stale.erase(stale.begin());
+			}
+			else if (!retired.empty())
+			{
+				size_t i = static_cast<size_t>(random.Range(0, retired.size() - 1));
+				alloc.Recycle(retired[i]);
+				retired[i] = retired.back();
+				retired.pop_back();
+			}
+
+			if (!alloc.Validate())
+				return fail(op, "Validate failed");
+			if (alloc.Count() != live.size() || alloc.RetiredCount() != retired.size())
+				return fail(op, "Count or RetiredCount is off");
+			for (uint32_t handle : live)
+			{
+				if (!alloc.InUse(handle))
+					return fail(op, "a live handle isn't in use");
+			}
+			for (uint32_t handle : stale)
+			{
+				// a recent stale handle can only match if the generation wrapped around
+				bool reused = false;
+				for (uint32_t other : live)
+					reused |= other == handle;
+				if (!reused && alloc.InUse(handle))
+					return fail(op, "a stale handle is in use");
+			}
+		}
+
+		printf("handle alloc: %u operations, %u failed allocations, ok\n", opCount, failures);
+		return true;
+	}
+
+	int Fuzz(uint32_t opCount, uint64_t seed)
+	{
+		bool ok = FuzzAllocator<fuzz_buddy_alloc_t>("fast buddy", FuzzHeapSize, FuzzMinSize, opCount, seed) &&
+			FuzzAllocator<fuzz_tlsf_alloc_t>("tlsf", FuzzHeapSize, FuzzMinSize, opCount, seed) &&
+			FuzzAllocator<fuzz_fine_tlsf_alloc_t>("tlsf 256", FuzzHeapSize, 256, opCount, seed) &&
+			FuzzHandleAlloc(opCount, seed);
+
+		return ok ? 0 : 1;
+	}
+
+	void Print(const char* name, const Trace& trace, const Result& result)
+	{
+		printf("%-12s %8.1f %9.2f %9.1f%% %9.1f%% %8.2f%%\n",
+			name,
+			result.nsPerOp,
+			result.peakUsed / (1024.0 * 1024.0),
+			result.internalFragmentation * 100.0,
+			result.externalFragmentation * 100.0,
+			trace.allocCount > 0 ? result.failures * 100.0 / trace.allocCount : 0.0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Trace trace;
+
+	if (argc > 1 && 0 == strcmp(argv[1], "fuzz"))
+	{
+		uint32_t ops = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 100000;
+		uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1;
+		return Fuzz(ops, seed);
+	}
+
+	if (argc > 2 && 0 == strcmp(argv[1], "synth"))
+	{
+		uint32_t frames = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 1000;
+		uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1;
+		SynthesizeTrace(frames, seed, trace);
+		if (!WriteTrace(argv[2], trace))
+		{
+			printf("can't write %s\n", argv[2]);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 1)
+	{
+		if (!LoadTrace(argv[1], trace))
+		{
+			printf("can't read trace %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+	{
+		SynthesizeTrace(1000, 1, trace);
+	}
+
+	printf("%u allocations, %u requests, %llu MB heap in %llu KB blocks\n\n",
+		trace.allocCount, static_cast<uint32_t>(trace.ops.size()),
+		static_cast<unsigned long long>(HeapSize >> 20), static_cast<unsigned long long>(HeapMinSize >> 10));
+	printf("allocator       ns/op   peak MB  internal  external   failed\n");
+	Print("fast buddy", trace, Run<buddy_alloc_t>(trace));
+	Print("tlsf", trace, Run<tlsf_alloc_t>(trace));
+
+	Result handles = RunHandles(trace);
+	printf("\nhandle alloc %8.1f ns/op, %llu handles at most, %u failed\n",
+		handles.nsPerOp, static_cast<unsigned long long>(handles.peakUsed), handles.failures);
+
+	return 0;
+}
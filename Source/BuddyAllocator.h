@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 namespace bamboo
 {
@@ -14,14 +16,15 @@ namespace bamboo
 		template<unsigned int memSize, unsigned int minSize>
 		struct BuddyAllocator
 		{
-			// size of tree data
-			static constexpr unsigned int treeSize = memSize / minSize / 8 * 4;
+			// size of tree data, the free bytes counter followed by the nodes
+			static constexpr unsigned int treeSize = sizeof(unsigned int) + memSize / minSize / 8 * 4;
 
 			static constexpr unsigned int flag_unused = 0;      // the node is free
 			static constexpr unsigned int flag_used = 1;        // the node is allocated as a whole
 			static constexpr unsigned int flag_split = 2;       // the node is splitted into children, partially allocated
 			static constexpr unsigned int flag_split_full = 3;  // the node is splitted into children, and all children are allocated
 
+			unsigned int freeBytes;		// kept up to date by allocate / deallocate
 			unsigned char space[1];
 
 			static BuddyAllocator* create(void* addr)
@@ -64,6 +67,8 @@ namespace bamboo
 
 			void initialize()
 			{
+				freeBytes = memSize;
+
 				// set the root node's flag to flag_unused
 				space[0] = 0;
 			}
@@ -132,7 +137,10 @@ namespace bamboo
 				if (size > memSize)
 					return nullptr;
 
-				return binarySearchAlloc(0, memSize, size, 0, baseAddr);
+				void* ptr = binarySearchAlloc(0, memSize, size, 0, baseAddr);
+				if (nullptr != ptr)
+					freeBytes -= size;
+				return ptr;
 			}
 
 			void binarySearchDealloc(unsigned int index, unsigned int nodeSize, unsigned int nodeOffset, unsigned int offset)
@@ -143,6 +151,7 @@ namespace bamboo
 				if (nodeOffset == offset && flag == flag_used)
 				{
 					write(index, flag_unused);
+					freeBytes += nodeSize;
 
 					// trace back and merge all free buddies.
 					for (unsigned int i = index; i > 0;)
@@ -177,6 +186,13 @@ namespace bamboo
 				binarySearchDealloc(0, memSize, 0, offset);
 			}
 
+			// the largest free block has no such counter, it would take a walk of
+			// the whole tree
+			unsigned int freeRemaining() const
+			{
+				return freeBytes;
+			}
+
 			//unsigned int binarySearchFreeSpace(unsigned int index, unsigned int nodeSize, unsigned int op) const
 			//{
 			//	int flag = read(index);
@@ -217,5 +233,246 @@ namespace bamboo
 			//	return binarySearchFreeSpace(0, memSize, 2);
 			//}
 		};
+
+		/*
+		Same interface as BuddyAllocator, but each node keeps one byte that
+		summarizes its subtree: the order of the largest free block inside it
+		plus one (order 0 is a block of minSize), 0 means nothing is free.
+		Allocation descends from the root picking the first child that still
+		holds a large enough block, so both allocate and deallocate are
+		iterative and touch O(log n) nodes at most, no matter how fragmented
+		the space is. The tree is a 1-based heap, node i has children 2i and
+		2i + 1, leaves start at index leafCount.
+
+		Sizes and offsets are of size_type, so with a 64-bit size_type it can
+		manage heaps beyond 4 GB; the tree costs 2 bytes per minSize block,
+		e.g. 512 KB for 16 GB in 64 KB blocks.
+		*/
+		template<uint64_t memSize, uint64_t minSize, typename size_type = uint64_t>
+		struct FastBuddyAllocator
+		{
+			static constexpr size_t leafCount = static_cast<size_t>(memSize / minSize);
+
+			static_assert(memSize <= static_cast<size_type>(~size_type(0)), "memSize doesn't fit in size_type");
+			static_assert(minSize > 0 && (minSize & (minSize - 1)) == 0, "minSize must be power of 2");
+			static_assert(leafCount > 0 && (leafCount & (leafCount - 1)) == 0, "memSize / minSize must be power of 2");
+
+			// returned by allocateOffset when there is no space
+			static constexpr size_type invalid_offset = static_cast<size_type>(~size_type(0));
+
+			// size of tree data, the free bytes counter followed by one byte
+			// per node (and the unused slot 0)
+			static constexpr size_t treeSize = sizeof(size_type) + leafCount * 2;
+
+			size_type freeBytes;		// kept up to date by allocate / deallocate
+			unsigned char space[1];
+
+			static FastBuddyAllocator* create(void* addr)
+			{
+				FastBuddyAllocator* obj = reinterpret_cast<FastBuddyAllocator*>(addr);
+				obj->initialize();
+				return obj;
+			}
+
+			static constexpr unsigned int log2_of_pow2(uint64_t x)
+			{
+				return x > 1 ? 1 + log2_of_pow2(x >> 1) : 0;
+			}
+
+			// order of the root node
+			static constexpr unsigned int maxOrder()
+			{
+				return log2_of_pow2(leafCount);
+			}
+
+			// order of the smallest block that can hold size bytes
+			static inline unsigned int order_of(size_type size)
+			{
+				size_type blocks = (size + minSize - 1) / minSize;
+				unsigned int order = 0;
+				while ((size_type(1) << order) < blocks) ++order;
+				return order;
+			}
+
+			static inline size_type block_size(unsigned int order)
+			{
+				return static_cast<size_type>(minSize) << order;
+			}
+
+			void initialize()
+			{
+				freeBytes = static_cast<size_type>(memSize);
+
+				// every node is free as a whole
+				unsigned int value = maxOrder() + 1;
+				for (size_t levelStart = 1; levelStart < leafCount * 2; levelStart <<= 1, --value)
+				{
+					for (size_t i = levelStart; i < (levelStart << 1); ++i)
+						space[i] = static_cast<unsigned char>(value);
+				}
+			}
+
+			// recompute the summaries from node index up to the root
+			inline void update(size_t index, unsigned int order)
+			{
+				while (index > 1)
+				{
+					index >>= 1;
+					++order;
+
+					unsigned int l = space[index * 2];
+					unsigned int r = space[index * 2 + 1];
+
+					// both children free as a whole merge into this node
+					unsigned int value = (l == order && r == order) ? order + 1 : (l < r ? r : l);
+					if (space[index] == value)
+						break;
+
+					space[index] = static_cast<unsigned char>(value);
+				}
+			}
+
+			size_type allocateOffset(size_type size)
+			{
+				if (size > memSize)
+					return invalid_offset;
+
+				unsigned int need = order_of(size);
+				if (space[1] < need + 1)
+					return invalid_offset;
+
+				size_t index = 1;
+				unsigned int order = maxOrder();
+				size_type offset = 0;
+				while (order > need)
+				{
+					--order;
+					index <<= 1;
+					if (space[index] < need + 1)
+					{
+						// the left child can't hold it, so the right one does
+						++index;
+						offset += block_size(order);
+					}
+				}
+
+				assert(space[index] == order + 1);
+				space[index] = 0;
+				update(index, order);
+				freeBytes -= block_size(order);
+
+				return offset;
+			}
+
+			void deallocateOffset(size_type offset)
+			{
+				assert(offset < memSize && offset % minSize == 0);
+
+				// nodes below an allocated block still read as free, so the
+				// first empty node on the way up from the leaf is the block
+				size_t index = leafCount + static_cast<size_t>(offset / minSize);
+				unsigned int order = 0;
+				while (space[index] != 0)
+				{
+					assert(index > 1);
+					index >>= 1;
+					++order;
+				}
+				assert((offset & (block_size(order) - 1)) == 0);
+
+				space[index] = static_cast<unsigned char>(order + 1);
+				update(index, order);
+				freeBytes += block_size(order);
+			}
+
+			// the base addres of the managed memory is provided here,
+			// because it is imaginary to the buddy allocator, we don't
+			// keep it. The algorithm is actually operating on offsets.
+			void* allocate(void* baseAddr, size_type size)
+			{
+				size_type offset = allocateOffset(size);
+				if (invalid_offset == offset)
+					return nullptr;
+
+				return reinterpret_cast<void*>(reinterpret_cast<char*>(baseAddr) + offset);
+			}
+
+			void deallocate(void* baseAddr, void* addr)
+			{
+				deallocateOffset(static_cast<size_type>(
+					reinterpret_cast<char*>(addr) - reinterpret_cast<char*>(baseAddr)
+					));
+			}
+
+			// total free bytes, O(1)
+			size_type freeRemaining() const
+			{
+				return freeBytes;
+			}
+
+			// the largest block allocate() can return right now, O(1)
+			size_type largestFree() const
+			{
+				return space[1] > 0 ? block_size(space[1] - 1) : 0;
+			}
+
+			// whether allocate(size) would succeed, without touching the tree
+			bool canAllocate(size_type size) const
+			{
+				return size <= memSize && space[1] >= order_of(size) + 1;
+			}
+
+			// check the tree against its invariants, O(n), for debugging only
+			bool validate() const
+			{
+				// free bytes of each node, filled bottom up
+				size_type total = 0;
+				for (size_t levelStart = leafCount, order = 0; levelStart > 0; levelStart >>= 1, ++order)
+				{
+					for (size_t i = levelStart; i < (levelStart << 1); ++i)
+					{
+						unsigned int value = space[i];
+						if (value > order + 1)
+							return false;
+
+						if (order == 0)
+						{
+							if (value != 0 && value != 1)
+								return false;
+							continue;
+						}
+
+						unsigned int l = space[i * 2];
+						unsigned int r = space[i * 2 + 1];
+						bool merged = l == order && r == order;
+						// a node allocated as a whole reads 0 above two free children
+						if (value != (merged ? order + 1 : (l < r ? r : l)) && !(merged && value == 0))
+							return false;
+					}
+				}
+
+				// sum up the free blocks, nodes below a free or allocated block are skipped
+				size_t stack[64 * 2];
+				size_t top = 0;
+				stack[top++] = 1;
+				while (top > 0)
+				{
+					size_t i = stack[--top];
+					unsigned int order = maxOrder() - log2_of_pow2(i);
+					unsigned int value = space[i];
+					if (value == order + 1)
+					{
+						total += block_size(order);
+					}
+					else if (order > 0 && !(value == 0 && space[i * 2] == order && space[i * 2 + 1] == order))
+					{
+						stack[top++] = i * 2 + 1;
+						stack[top++] = i * 2;
+					}
+				}
+
+				return total == freeBytes;
+			}
+		};
 	}
 }
\ No newline at end of file
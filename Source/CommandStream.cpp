@@ -0,0 +1,244 @@
+#include "CommandStream.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace bamboo
+{
+	constexpr size_t DrawCommandWords = sizeof(DrawCommand) / sizeof(uint32_t);
+	constexpr size_t ViewportWords = sizeof(Viewport) / sizeof(uint32_t);
+
+	static_assert(sizeof(Viewport) % sizeof(uint32_t) == 0, "Viewport should be made of words");
+
+	CommandStream::CommandStream(bool elideViewports)
+		:
+		drawCount(0),
+		lastViewport{},
+		hasViewport(false),
+		elideViewports(elideViewports)
+	{
+	}
+
+	void CommandStream::Clear()
+	{
+		words.clear();
+		drawCount = 0;
+		hasViewport = false;
+	}
+
+	void CommandStream::Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall)
+	{
+		uint32_t bindingDataSize = drawcall.BindingDataSize;
+		if (0 == bindingDataSize)
+		{
+			bindingDataSize = MaxBindingDataSize;
+			while (bindingDataSize > 0 && 0 == drawcall.ResourceBindingData[bindingDataSize - 1])
+				bindingDataSize--;
+		}
+		assert(bindingDataSize <= MaxBindingDataSize);
+
+		bool instanced = drawcall.InstanceCount > 1 || drawcall.FirstInstance > 0;
+		bool hasElementRange = drawcall.StartIndex > 0 || drawcall.BaseVertex != 0;
+
+		bool hasBufferOffsets = drawcall.HasIndexBuffer && drawcall.IndexBufferOffset > 0;
+		for (uint32_t i = 0; i < drawcall.VertexBufferCount && !hasBufferOffsets; ++i)
+			hasBufferOffsets = drawcall.VertexBufferOffsets[i] > 0;
+
+		bool viewportChanged = !elideViewports || !hasViewport ||
+			0 != memcmp(&lastViewport, &drawcall.Viewport, sizeof(Viewport));
+
+		DrawCommand cmd = {};
+		cmd.PipelineState = stateHandle.id;
+		cmd.ElementCount = drawcall.ElementCount;
+		cmd.VertexBufferCount = static_cast<uint8_t>(drawcall.VertexBufferCount);
+		cmd.BindingDataSize = static_cast<uint8_t>(bindingDataSize);
+		cmd.RenderTargetCount = static_cast<uint8_t>(drawcall.RenderTargetCount);
+		cmd.SamplerCount = drawcall.SamplerCount;
+		cmd.Flags =
+			(drawcall.HasIndexBuffer ? DrawCommand::HAS_INDEX_BUFFER : 0) |
+			(drawcall.HasDepthStencil ? DrawCommand::HAS_DEPTH_STENCIL : 0) |
+			(viewportChanged ? DrawCommand::HAS_VIEWPORT : 0) |
+			(drawcall.HasBindingGroup ? DrawCommand::HAS_BINDING_GROUP : 0) |
+			(instanced ? DrawCommand::HAS_INSTANCES : 0) |
+			(hasElementRange ? DrawCommand::HAS_ELEMENT_RANGE : 0) |
+			(hasBufferOffsets ? DrawCommand::HAS_BUFFER_OFFSETS : 0);
+
+		size_t size = DrawCommandWords +
+			(instanced ? 2 : 0) +
+			(hasElementRange ? 2 : 0) +
+			(hasBufferOffsets ? 2 : 1) * (cmd.VertexBufferCount + (drawcall.HasIndexBuffer ? 1 : 0)) +
+			cmd.RenderTargetCount +
+			(drawcall.HasDepthStencil ? 1 : 0) +
+			(drawcall.HasBindingGroup ? 1 : 0) +
+			(viewportChanged ? ViewportWords : 0) +
+			bindingDataSize;
+
+		size_t start = words.size();
+		words.resize(start + size);
+		uint32_t* p = words.data() + start;
+
+		memcpy(p, &cmd, sizeof(cmd));
+		p += DrawCommandWords;
+
+		if (instanced)
+		{
+			*p++ = drawcall.InstanceCount;
+			*p++ = drawcall.FirstInstance;
+		}
+
+		if (hasElementRange)
+		{
+			*p++ = drawcall.StartIndex;
+			*p++ = static_cast<uint32_t>(drawcall.BaseVertex);
+		}
+
+		for (uint32_t i = 0; i < cmd.VertexBufferCount; ++i)
+			*p++ = drawcall.VertexBuffers[i].id;
+
+		if (drawcall.HasIndexBuffer)
+			*p++ = drawcall.IndexBuffer.id;
+
+		if (hasBufferOffsets)
+		{
+			for (uint32_t i = 0; i < cmd.VertexBufferCount; ++i)
+				*p++ = drawcall.VertexBufferOffsets[i];
+
+			if (drawcall.HasIndexBuffer)
+				*p++ = drawcall.IndexBufferOffset;
+		}
+
+		for (uint32_t i = 0; i < cmd.RenderTargetCount; ++i)
+			*p++ = drawcall.RenderTargets[i].id;
+
+		if (drawcall.HasDepthStencil)
+			*p++ = drawcall.DepthStencil.id;
+
+		if (drawcall.HasBindingGroup)
+			*p++ = drawcall.BindingGroup.id;
+
+		if (viewportChanged)
+		{
+			memcpy(p, &drawcall.Viewport, sizeof(Viewport));
+			p += ViewportWords;
+
+			lastViewport = drawcall.Viewport;
+			hasViewport = true;
+		}
+
+		memcpy(p, drawcall.ResourceBindingData, bindingDataSize * sizeof(uint32_t));
+
+		drawCount++;
+	}
+
+	CommandStreamReader::CommandStreamReader(const CommandStream& stream)
+		:
+		begin(stream.Data()),
+		cursor(stream.Data()),
+		end(stream.Data() + stream.Size() / sizeof(uint32_t)),
+		drawcall{}
+	{
+	}
+
+	CommandStreamReader::CommandStreamReader(const uint32_t* words, size_t count)
+		:
+		begin(words),
+		cursor(words),
+		end(words + count),
+		drawcall{}
+	{
+	}
+
+	const DrawCall* CommandStreamReader::Next(PipelineStateHandle& stateHandle)
+	{
+		if (cursor >= end)
+			return nullptr;
+
+		DrawCommand cmd;
+		memcpy(&cmd, cursor, sizeof(cmd));
+		cursor += DrawCommandWords;
+
+		stateHandle.id = cmd.PipelineState;
+
+		drawcall.ElementCount = cmd.ElementCount;
+		drawcall.VertexBufferCount = cmd.VertexBufferCount;
+		drawcall.RenderTargetCount = cmd.RenderTargetCount;
+		drawcall.SamplerCount = cmd.SamplerCount;
+		drawcall.HasIndexBuffer = (cmd.Flags & DrawCommand::HAS_INDEX_BUFFER) ? 1 : 0;
+		drawcall.HasDepthStencil = (cmd.Flags & DrawCommand::HAS_DEPTH_STENCIL) ? 1 : 0;
+		drawcall.HasBindingGroup = (cmd.Flags & DrawCommand::HAS_BINDING_GROUP) ? 1 : 0;
+
+		if (cmd.Flags & DrawCommand::HAS_INSTANCES)
+		{
+			drawcall.InstanceCount = *cursor++;
+			drawcall.FirstInstance = *cursor++;
+		}
+		else
+		{
+			drawcall.InstanceCount = 1;
+			drawcall.FirstInstance = 0;
+		}
+
+		if (cmd.Flags & DrawCommand::HAS_ELEMENT_RANGE)
+		{
+			drawcall.StartIndex = *cursor++;
+			drawcall.BaseVertex = static_cast<int32_t>(*cursor++);
+		}
+		else
+		{
+			drawcall.StartIndex = 0;
+			drawcall.BaseVertex = 0;
+		}
+
+		for (uint32_t i = 0; i < cmd.VertexBufferCount; ++i)
+			drawcall.VertexBuffers[i].id = *cursor++;
+
+		if (drawcall.HasIndexBuffer)
+			drawcall.IndexBuffer.id = *cursor++;
+
+		if (cmd.Flags & DrawCommand::HAS_BUFFER_OFFSETS)
+		{
+			for (uint32_t i = 0; i < cmd.VertexBufferCount; ++i)
+				drawcall.VertexBufferOffsets[i] = *cursor++;
+
+			drawcall.IndexBufferOffset = drawcall.HasIndexBuffer ? *cursor++ : 0;
+		}
+		else
+		{
+			memset(drawcall.VertexBufferOffsets, 0, cmd.VertexBufferCount * sizeof(uint32_t));
+			drawcall.IndexBufferOffset = 0;
+		}
+
+		for (uint32_t i = 0; i < cmd.RenderTargetCount; ++i)
+			drawcall.RenderTargets[i].id = *cursor++;
+
+		if (drawcall.HasDepthStencil)
+			drawcall.DepthStencil.id = *cursor++;
+
+		if (drawcall.HasBindingGroup)
+			drawcall.BindingGroup.id = *cursor++;
+
+		if (cmd.Flags & DrawCommand::HAS_VIEWPORT)
+		{
+			memcpy(&drawcall.Viewport, cursor, sizeof(Viewport));
+			cursor += ViewportWords;
+		}
+
+		// the words the last draw used beyond this one go back to zero
+		uint32_t lastSize = drawcall.BindingDataSize;
+		memcpy(drawcall.ResourceBindingData, cursor, cmd.BindingDataSize * sizeof(uint32_t));
+		if (lastSize > cmd.BindingDataSize)
+			memset(drawcall.ResourceBindingData + cmd.BindingDataSize, 0, (lastSize - cmd.BindingDataSize) * sizeof(uint32_t));
+		drawcall.BindingDataSize = cmd.BindingDataSize;
+		cursor += cmd.BindingDataSize;
+
+		assert(cursor <= end);
+
+		return &drawcall;
+	}
+
+	const DrawCall* CommandStreamReader::Read(uint32_t position, PipelineStateHandle& stateHandle)
+	{
+		cursor = begin + position;
+		return Next(stateHandle);
+	}
+}
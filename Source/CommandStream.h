@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+
+#include <vector>
+
+namespace bamboo
+{
+	// Header of an encoded draw, the used parts of the DrawCall follow it
+	// in this order: instance count and first instance (only if instanced),
+	// start index and base vertex (only if not 0), vertex buffers, index
+	// buffer, their offsets (only if one isn't 0), render targets, depth
+	// stencil, binding group, viewport (only if it changed), binding data.
+	struct DrawCommand
+	{
+		enum Flag
+		{
+			HAS_INDEX_BUFFER = 1 << 0,
+			HAS_DEPTH_STENCIL = 1 << 1,
+			HAS_VIEWPORT = 1 << 2,
+			HAS_BINDING_GROUP = 1 << 3,
+			HAS_INSTANCES = 1 << 4,
+			HAS_ELEMENT_RANGE = 1 << 5,
+			HAS_BUFFER_OFFSETS = 1 << 6,
+		};
+
+		uint32_t					PipelineState;
+		uint32_t					ElementCount;
+		uint8_t						VertexBufferCount;
+		uint8_t						BindingDataSize;	// in 32-bit words
+		uint8_t						RenderTargetCount : 4;
+		uint8_t						SamplerCount : 4;
+		uint8_t						Flags;
+	};
+
+	static_assert(sizeof(DrawCommand) == 12, "DrawCommand should be 3 words");
+
+	// Draws recorded back to back into a stream of 32-bit words. A draw only
+	// takes the header and what it uses, the binding data is cut after the
+	// last non-zero word (or to DrawCall::BindingDataSize if it is set).
+	// Unless elideViewports is false, a viewport equal to the one of the
+	// previous draw is left out, so the draws can only be read in order.
+	class CommandStream
+	{
+	public:
+		explicit CommandStream(bool elideViewports = true);
+
+		void Clear();
+
+		void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall);
+
+		uint32_t DrawCount() const { return drawCount; }
+
+		// bytes taken by the encoded draws
+		size_t Size() const { return words.size() * sizeof(uint32_t); }
+
+		// position the next draw will be written at, in words
+		uint32_t Tell() const { return static_cast<uint32_t>(words.size()); }
+
+		const uint32_t* Data() const { return words.data(); }
+
+	private:
+		std::vector<uint32_t>		words;
+		uint32_t					drawCount;
+
+		bamboo::Viewport			lastViewport;
+		bool						hasViewport;
+		bool						elideViewports;
+	};
+
+	// Decodes a CommandStream into a DrawCall it owns. Only the parts a
+	// draw uses are written, the rest of the binding data is kept zero.
+	class CommandStreamReader
+	{
+	public:
+		explicit CommandStreamReader(const CommandStream& stream);
+
+		// words copied out of a CommandStream, count in words
+		CommandStreamReader(const uint32_t* words, size_t count);
+
+		// the next draw, or nullptr at the end of the stream
+		const DrawCall* Next(PipelineStateHandle& stateHandle);
+
+		// the draw at a position from CommandStream::Tell, the stream must
+		// not elide viewports
+		const DrawCall* Read(uint32_t position, PipelineStateHandle& stateHandle);
+
+	private:
+		const uint32_t*				begin;
+		const uint32_t*				cursor;
+		const uint32_t*				end;
+
+		DrawCall					drawcall;
+	};
+}
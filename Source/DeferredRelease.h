@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bamboo
+{
+	// Objects the application has destroyed while the GPU may still be using
+	// them. Each one is queued with the fence value signaled at the end of the
+	// frame it was destroyed in, and handed to the release function by Retire
+	// once the fence has reached that value. Frames are submitted in order, so
+	// the values never go down from one Push to the next, the queue stays
+	// sorted and Retire only looks at its front. It knows nothing of the
+	// device, T is whatever the backend needs to find the object again.
+	template<typename T>
+	class DeferredReleaseQueue
+	{
+	public:
+		DeferredReleaseQueue()
+			:
+			head(0)
+		{}
+
+		void Push(uint64_t fenceValue, const T& item)
+		{
+			assert(head == entries.size() || entries.back().fenceValue <= fenceValue);
+			entries.push_back(Entry{ fenceValue, item });
+		}
+
+		// releases the objects whose fence value has been reached, in the order
+		// they were pushed, returns how many
+		template<typename Release>
+		size_t Retire(uint64_t completedFenceValue, Release release)
+		{
+			size_t count = 0;
+			while (head < entries.size() && entries[head].fenceValue <= completedFenceValue)
+			{
+				release(entries[head].item);
+				++head;
+				++count;
+			}
+
+			Compact();
+			return count;
+		}
+
+		// releases everything, once the GPU is idle
+		template<typename Release>
+		size_t Flush(Release release)
+		{
+			return Retire(UINT64_MAX, release);
+		}
+
+		size_t Size() const
+		{
+			return entries.size() - head;
+		}
+
+		bool Empty() const
+		{
+			return head == entries.size();
+		}
+
+	private:
+		struct Entry
+		{
+			uint64_t				fenceValue;
+			T						item;
+		};
+
+		// drop the retired entries once they are the bigger part of the vector
+		void Compact()
+		{
+			if (head == entries.size())
+			{
+				entries.clear();
+				head = 0;
+			}
+			else if (head >= 64 && head * 2 >= entries.size())
+			{
+				entries.erase(entries.begin(), entries.begin() + head);
+				head = 0;
+			}
+		}
+
+		std::vector<Entry>			entries;
+		size_t						head;		// first entry not retired yet
+	};
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include "TLSFAllocator.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace bamboo
+{
+	struct DescriptorCacheStatistics
+	{
+		uint32_t					Hits;
+		uint32_t					Misses;
+		uint32_t					Evictions;		// tables dropped to make room
+		uint32_t					Invalidations;	// tables dropped because a resource in them went away
+		uint32_t					Failures;		// no room even after evicting
+	};
+
+	// Descriptor tables placed in a shader visible heap of heapSize slots and
+	// found again by their content. A table is described by one 64-bit key
+	// per descriptor, made by the backend from what the descriptor points to,
+	// so a draw binding the same resources as an earlier one gets the range
+	// already written for it and descriptors are only created on a miss.
+	//
+	// Ranges are placed by a TLSF allocator over the slots. When there is no
+	// room, the least recently used tables are evicted, but only those the
+	// GPU is done with: last used in a frame not later than the completed one
+	// given to SetFrame. A pinned table is never evicted, for descriptors
+	// that live as long as some object does. The cache knows nothing of the
+	// device, it only hands out slot offsets.
+	//
+	// Every slot in use is also chained by the hash of its key, so Invalidate
+	// only looks at the tables that may have the key. The tables it drops
+	// wait in a list of their own, in the order they were dropped, until the
+	// GPU is done with them. Both lists go from the oldest frame to the
+	// newest, an eviction only looks at their ends.
+	template<uint32_t heapSize>
+	class DescriptorCache
+	{
+	public:
+		static constexpr uint32_t invalid_offset = UINT32_MAX;
+
+		DescriptorCache()
+			:
+			alloc(nullptr),
+			lru{ none, none },
+			dropped{ none, none },
+			freeEntry(none),
+			frame(0),
+			completedFrame(0),
+			stats{}
+		{}
+
+		DescriptorCache(const DescriptorCache&) = delete;
+		DescriptorCache& operator=(const DescriptorCache&) = delete;
+
+		void Init()
+		{
+			alloc = alloc_t::create(treeMem);
+
+			entries.resize(heapSize);
+			keys.resize(heapSize);
+			owners.resize(heapSize);
+			keyNext.resize(heapSize);
+			keyPrev.resize(heapSize);
+			buckets.assign(bucketCount, static_cast<uint32_t>(none));
+			keyBuckets.assign(bucketCount, static_cast<uint32_t>(none));
+
+			for (uint32_t i = 0; i < heapSize; ++i)
+			{
+				entries[i].pins = 0;
+				entries[i].cached = false;
+				entries[i].hashNext = i + 1 < heapSize ? i + 1 : none;
+			}
+			freeEntry = 0;
+			lru = List{ none, none };
+			dropped = List{ none, none };
+
+			memset(&stats, 0, sizeof(stats));
+		}
+
+		// frame is stamped on the tables used from now on, the ones last used
+		// in completedFrame or before can be evicted
+		void SetFrame(uint64_t frame, uint64_t completedFrame)
+		{
+			assert(completedFrame < frame);
+			this->frame = frame;
+			this->completedFrame = completedFrame;
+		}
+
+		// offset of the table with these keys, created is set if the range is
+		// new and its descriptors have to be written. invalid_offset if there
+		// is no room for it.
+		uint32_t Acquire(const uint64_t* key, uint32_t count, bool& created)
+		{
+			assert(count > 0 && count <= heapSize);
+
+			uint64_t hash = Hash(key, count);
+			uint32_t bucket = static_cast<uint32_t>(hash) & (bucketCount - 1);
+
+			for (uint32_t i = buckets[bucket]; none != i; i = entries[i].hashNext)
+			{
+				Entry& entry = entries[i];
+				if (entry.hash == hash && entry.count == count &&
+					0 == memcmp(&keys[entry.offset], key, count * sizeof(uint64_t)))
+				{
+					Touch(i);
+					stats.Hits++;
+					created = false;
+					return entry.offset;
+				}
+			}
+
+			stats.Misses++;
+
+			uint32_t offset;
+			while (alloc_t::invalid_offset == (offset = alloc->allocateOffset(count)))
+			{
+				if (!EvictOne())
+				{
+					stats.Failures++;
+					return invalid_offset;
+				}
+			}
+
+			// each table takes at least a slot, so there is always an entry left
+			assert(none != freeEntry);
+			uint32_t index = freeEntry;
+			Entry& entry = entries[index];
+			freeEntry = entry.hashNext;
+
+			entry.hash = hash;
+			entry.lastUsed = frame;
+			entry.offset = offset;
+			entry.count = count;
+			entry.pins = 0;
+			entry.cached = true;
+
+			entry.hashNext = buckets[bucket];
+			buckets[bucket] = index;
+
+			LinkFront(lru, index);
+
+			memcpy(&keys[offset], key, count * sizeof(uint64_t));
+			for (uint32_t slot = offset; slot < offset + count; ++slot)
+			{
+				owners[slot] = index;
+				LinkKey(slot);
+			}
+
+			created = true;
+			return offset;
+		}
+
+		// drops the tables with this key in them, they are not found any more
+		// and their range is given back once the GPU is done with it
+		void Invalidate(uint64_t descriptorKey)
+		{
+			uint32_t bucket = KeyBucket(descriptorKey);
+			uint32_t slot = keyBuckets[bucket];
+			while (none != slot)
+			{
+				if (keys[slot] != descriptorKey)
+				{
+					slot = keyNext[slot];
+					continue;
+				}
+
+				// takes the slots of the table out of the chain, start over
+				Uncache(owners[slot]);
+				stats.Invalidations++;
+				slot = keyBuckets[bucket];
+			}
+		}
+
+		// keeps the table at offset (from Acquire) until as many Unpin
+		void Pin(uint32_t offset)
+		{
+			uint32_t index = owners[offset];
+			assert(entries[index].cached || entries[index].pins > 0);
+			if (0 == entries[index].pins++)
+				Unlink(lru, index);
+		}
+
+		void Unpin(uint32_t offset)
+		{
+			uint32_t index = owners[offset];
+			Entry& entry = entries[index];
+			assert(entry.pins > 0);
+			if (0 == --entry.pins)
+			{
+				// it may have been used this frame
+				entry.lastUsed = frame;
+				if (entry.cached)
+					LinkFront(lru, index);
+				else
+					Drop(index);
+			}
+		}
+
+		const DescriptorCacheStatistics& GetStatistics() const { return stats; }
+
+		void ResetStatistics() { memset(&stats, 0, sizeof(stats)); }
+
+	private:
+		typedef memory::TLSFAllocator<heapSize, 1, uint32_t> alloc_t;
+
+		static constexpr uint32_t none = UINT32_MAX;
+
+		// at least twice the most tables there can be
+		static constexpr uint32_t bucketCount = 2u << memory::log2_floor(heapSize);
+
+		struct Entry
+		{
+			uint64_t				hash;
+			uint64_t				lastUsed;		// frame
+			uint32_t				offset;			// in slots, where its keys are as well
+			uint32_t				count;
+			uint32_t				prev;			// LRU or dropped list, the head is the most recent
+			uint32_t				next;
+			uint32_t				hashNext;		// bucket chain, or free list
+			uint32_t				pins;			// in neither list while pinned
+			bool					cached;			// in a bucket, can be found
+		};
+
+		struct List
+		{
+			uint32_t				head;
+			uint32_t				tail;
+		};
+
+		static uint64_t Hash(const uint64_t* key, uint32_t count)
+		{
+			// FNV-1a over the words, with a final mix for the bucket bits
+			uint64_t h = 14695981039346656037ull;
+			for (uint32_t i = 0; i < count; ++i)
+				h = (h ^ key[i]) * 1099511628211ull;
+			h ^= h >> 32;
+			return h;
+		}
+
+		static uint32_t KeyBucket(uint64_t key)
+		{
+			return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (bucketCount - 1);
+		}
+
+		void LinkFront(List& list, uint32_t index)
+		{
+			Entry& entry = entries[index];
+			entry.prev = none;
+			entry.next = list.head;
+			if (none != list.head)
+				entries[list.head].prev = index;
+			else
+				list.tail = index;
+			list.head = index;
+		}
+
+		void Unlink(List& list, uint32_t index)
+		{
+			Entry& entry = entries[index];
+			if (none != entry.prev)
+				entries[entry.prev].next = entry.next;
+			else
+				list.head = entry.next;
+
+			if (none != entry.next)
+				entries[entry.next].prev = entry.prev;
+			else
+				list.tail = entry.prev;
+		}
+
+		void LinkKey(uint32_t slot)
+		{
+			uint32_t& head = keyBuckets[KeyBucket(keys[slot])];
+			keyPrev[slot] = none;
+			keyNext[slot] = head;
+			if (none != head)
+				keyPrev[head] = slot;
+			head = slot;
+		}
+
+		void UnlinkKey(uint32_t slot)
+		{
+			if (none != keyPrev[slot])
+				keyNext[keyPrev[slot]] = keyNext[slot];
+			else
+				keyBuckets[KeyBucket(keys[slot])] = keyNext[slot];
+
+			if (none != keyNext[slot])
+				keyPrev[keyNext[slot]] = keyPrev[slot];
+		}
+
+		void Touch(uint32_t index)
+		{
+			entries[index].lastUsed = frame;
+			if (0 == entries[index].pins && lru.head != index)
+			{
+				Unlink(lru, index);
+				LinkFront(lru, index);
+			}
+		}
+
+		void Free(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			alloc->deallocateOffset(entry.offset);
+
+			entry.hashNext = freeEntry;
+			freeEntry = index;
+		}
+
+		// an unpinned table nobody can find, freed if the GPU is done with it,
+		// or else once it is done with this frame
+		void Drop(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			if (entry.lastUsed <= completedFrame)
+			{
+				Free(index);
+				return;
+			}
+
+			// at the head of the dropped list, which stays in frame order
+			entry.lastUsed = frame;
+			LinkFront(dropped, index);
+		}
+
+		// takes the table out of its bucket and its slots out of the key chains
+		void Uncache(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			uint32_t* link = &buckets[static_cast<uint32_t>(entry.hash) & (bucketCount - 1)];
+			while (*link != index)
+			{
+				assert(none != *link);
+				link = &entries[*link].hashNext;
+			}
+			*link = entry.hashNext;
+			entry.cached = false;
+
+			for (uint32_t slot = entry.offset; slot < entry.offset + entry.count; ++slot)
+				UnlinkKey(slot);
+
+			if (0 == entry.pins)
+			{
+				Unlink(lru, index);
+				Drop(index);
+			}
+		}
+
+		// frees the oldest dropped table, or else the least recently used one,
+		// if the GPU is done with it
+		bool EvictOne()
+		{
+			uint32_t index = dropped.tail;
+			if (none != index && entries[index].lastUsed <= completedFrame)
+			{
+				Unlink(dropped, index);
+				Free(index);
+				return true;
+			}
+
+			index = lru.tail;
+			if (none != index && entries[index].lastUsed <= completedFrame)
+			{
+				Uncache(index);
+				stats.Evictions++;
+				return true;
+			}
+
+			return false;
+		}
+
+		alignas(alloc_t) uint8_t	treeMem[alloc_t::treeSize];
+		alloc_t*					alloc;
+
+		std::vector<Entry>			entries;
+		std::vector<uint64_t>		keys;			// per slot, of the table there
+		std::vector<uint32_t>		owners;			// per slot, entry of the table there
+		std::vector<uint32_t>		keyNext;		// per slot, chain of the slots whose key is in the same bucket
+		std::vector<uint32_t>		keyPrev;
+		std::vector<uint32_t>		buckets;
+		std::vector<uint32_t>		keyBuckets;		// first slot of each chain
+
+		List						lru;
+		List						dropped;		// uncached, waiting for the GPU
+		uint32_t					freeEntry;
+
+		uint64_t					frame;
+		uint64_t					completedFrame;
+
+		DescriptorCacheStatistics	stats;
+	};
+}
@@ -0,0 +1,250 @@
+#include "DrawQueue.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace bamboo
+{
+	uint64_t SortKeyLayout::Encode(uint32_t view, uint32_t pass, PipelineStateHandle pipeline, uint32_t material, uint32_t depth) const
+	{
+		assert(ViewBits + PassBits + PipelineBits + MaterialBits + DepthBits <= 64);
+
+		uint64_t key = 0;
+		uint32_t fields[] = { view, pass, HandleAlloc<>::GetIndex(pipeline.id), material, depth };
+		uint8_t bits[] = { ViewBits, PassBits, PipelineBits, MaterialBits, DepthBits };
+
+		for (size_t i = 0; i < 5; ++i)
+		{
+			assert(bits[i] <= 32);
+			uint64_t mask = bits[i] >= 32 ? UINT32_MAX : ((uint64_t(1) << bits[i]) - 1);
+			key = (bits[i] > 0 ? (key << bits[i]) : key) | (fields[i] & mask);
+		}
+
+		// the fields start at the most significant bit
+		uint32_t total = ViewBits + PassBits + PipelineBits + MaterialBits + DepthBits;
+		return total < 64 ? key << (64 - total) : key;
+	}
+
+	DrawEncoder::DrawEncoder()
+		:
+		stream(false),
+		index(0),
+		capacity(0),
+		droppedDraws(0)
+	{
+	}
+
+	void DrawEncoder::Init(uint32_t index, uint32_t capacity)
+	{
+		this->index = index;
+		this->capacity = capacity;
+		entries.reserve(capacity);
+		Clear();
+	}
+
+	void DrawEncoder::Clear()
+	{
+		stream.Clear();
+		entries.clear();
+		droppedDraws = 0;
+	}
+
+	bool DrawEncoder::Draw(uint64_t sortKey, PipelineStateHandle stateHandle, const DrawCall& drawcall)
+	{
+		if (entries.size() >= capacity)
+		{
+			droppedDraws++;
+			return false;
+		}
+
+		DrawQueueEntry entry = { sortKey, stream.Tell(), index };
+		stream.Draw(stateHandle, drawcall);
+
+		entries.push_back(entry);
+
+		return true;
+	}
+
+	DrawQueue::DrawQueue()
+		:
+		sorted(false),
+		countedChanges(false),
+		stats{}
+	{
+	}
+
+	void DrawQueue::Init(uint32_t capacity, uint32_t encoderCount)
+	{
+		assert(encoderCount > 0);
+
+		encoders.clear();
+		encoders.resize(encoderCount);
+		for (uint32_t i = 0; i < encoderCount; ++i)
+			encoders[i].Init(i, capacity);
+
+		entries.reserve(capacity * encoderCount);
+		scratch.reserve(capacity * encoderCount);
+
+		readers.clear();
+		for (const DrawEncoder& encoder : encoders)
+			readers.emplace_back(encoder.stream);
+		readerWords.assign(encoderCount, nullptr);
+		readerSizes.assign(encoderCount, 0);
+
+		Clear();
+	}
+
+	void DrawQueue::Clear()
+	{
+		for (DrawEncoder& encoder : encoders)
+			encoder.Clear();
+
+		entries.clear();
+		sorted = false;
+		countedChanges = false;
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	DrawEncoder* DrawQueue::GetEncoder(uint32_t index)
+	{
+		return index < encoders.size() ? &encoders[index] : nullptr;
+	}
+
+	bool DrawQueue::Draw(uint64_t sortKey, PipelineStateHandle stateHandle, const DrawCall& drawcall)
+	{
+		return encoders[0].Draw(sortKey, stateHandle, drawcall);
+	}
+
+	uint32_t DrawQueue::Count() const
+	{
+		uint32_t count = 0;
+		for (const DrawEncoder& encoder : encoders)
+			count += encoder.Count();
+		return count;
+	}
+
+	const DrawQueueStats& DrawQueue::GetStats()
+	{
+		if (!countedChanges)
+		{
+			// gathered in encoder order, as the draws came in
+			std::vector<DrawQueueEntry> unsorted;
+			unsorted.reserve(Count());
+			for (const DrawEncoder& encoder : encoders)
+				unsorted.insert(unsorted.end(), encoder.entries.begin(), encoder.entries.end());
+
+			stats.PipelineChangesUnsorted = CountPipelineChanges(unsorted);
+			stats.PipelineChanges = sorted ? CountPipelineChanges(entries) : 0;
+			countedChanges = true;
+		}
+		return stats;
+	}
+
+	uint32_t DrawQueue::CountPipelineChanges(const std::vector<DrawQueueEntry>& order) const
+	{
+		uint32_t changes = 0;
+		uint32_t current = invalid_handle;
+		for (const DrawQueueEntry& entry : order)
+		{
+			// the pipeline state is the first word of the DrawCommand
+			uint32_t pipelineState = encoders[entry.encoder].stream.Data()[entry.position];
+			if (pipelineState != current)
+			{
+				current = pipelineState;
+				changes++;
+			}
+		}
+		return changes;
+	}
+
+	void DrawQueue::Sort()
+	{
+		// the encoders don't tell the queue when they record, draws were added
+		// since the last sort if there are more than it gathered
+		if (sorted && entries.size() == Count())
+			return;
+
+		// gather in encoder order, the stable sort keeps it for equal keys
+		entries.clear();
+		stats.DroppedDraws = 0;
+		for (const DrawEncoder& encoder : encoders)
+		{
+			entries.insert(entries.end(), encoder.entries.begin(), encoder.entries.end());
+			stats.DroppedDraws += encoder.droppedDraws;
+		}
+
+		size_t count = entries.size();
+		stats.DrawCount = static_cast<uint32_t>(count);
+		stats.SortPasses = 0;
+		stats.SkippedPasses = 0;
+
+		sorted = true;
+		countedChanges = false;
+		if (0 == count)
+			return;
+
+		// histograms of all the digits in one go
+		uint32_t histograms[8][256];
+		memset(histograms, 0, sizeof(histograms));
+		for (const DrawQueueEntry& entry : entries)
+		{
+			for (uint32_t pass = 0; pass < 8; ++pass)
+				histograms[pass][(entry.key >> (pass * 8)) & 0xff]++;
+		}
+
+		scratch.resize(count);
+
+		for (uint32_t pass = 0; pass < 8; ++pass)
+		{
+			uint32_t* histogram = histograms[pass];
+			uint32_t shift = pass * 8;
+
+			// every key has the same digit, nothing would move
+			if (histogram[(entries[0].key >> shift) & 0xff] == count)
+			{
+				stats.SkippedPasses++;
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < 256; ++digit)
+			{
+				uint32_t n = histogram[digit];
+				histogram[digit] = offset;
+				offset += n;
+			}
+
+			for (const DrawQueueEntry& entry : entries)
+				scratch[histogram[(entry.key >> shift) & 0xff]++] = entry;
+
+			entries.swap(scratch);
+			stats.SortPasses++;
+		}
+	}
+
+	void DrawQueue::Submit(GraphicsAPI* api)
+	{
+		Sort();
+
+		// only the streams that changed size or moved since the last Submit
+		// need a new reader
+		for (size_t i = 0; i < encoders.size(); ++i)
+		{
+			const CommandStream& stream = encoders[i].stream;
+			if (stream.Data() != readerWords[i] || stream.Tell() != readerSizes[i])
+			{
+				readers[i] = CommandStreamReader(stream);
+				readerWords[i] = stream.Data();
+				readerSizes[i] = stream.Tell();
+			}
+		}
+
+		PipelineStateHandle stateHandle;
+
+		for (const DrawQueueEntry& entry : entries)
+		{
+			const DrawCall* drawcall = readers[entry.encoder].Read(entry.position, stateHandle);
+			api->Draw(stateHandle, *drawcall);
+		}
+	}
+}
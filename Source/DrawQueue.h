@@ -0,0 +1,123 @@
+#pragma once
+
+#include "CommandStream.h"
+
+#include <vector>
+
+namespace bamboo
+{
+	// Bit widths of the fields of a sort key, from the most significant:
+	// view, pass, pipeline, material, depth. They must add up to 64 at most,
+	// values wider than their field are cut.
+	struct SortKeyLayout
+	{
+		uint8_t						ViewBits;
+		uint8_t						PassBits;
+		uint8_t						PipelineBits;
+		uint8_t						MaterialBits;
+		uint8_t						DepthBits;
+
+		// depth is quantized by the caller, invert it to sort back to front
+		uint64_t Encode(uint32_t view, uint32_t pass, PipelineStateHandle pipeline, uint32_t material, uint32_t depth) const;
+	};
+
+	constexpr SortKeyLayout DefaultSortKeyLayout = { 4, 4, 16, 16, 24 };
+
+	struct DrawQueueStats
+	{
+		uint32_t					DrawCount;
+		uint32_t					DroppedDraws;			// the queue was full
+		uint32_t					SortPasses;				// radix passes done
+		uint32_t					SkippedPasses;			// all keys had the same digit
+		uint32_t					PipelineChangesUnsorted;// in the order the draws came in
+		uint32_t					PipelineChanges;		// in the order they are submitted
+	};
+
+	struct DrawQueueEntry
+	{
+		uint64_t					key;
+		uint32_t					position;		// in the command stream
+		uint32_t					encoder;
+	};
+
+	// Records the draws of one thread. An encoder is not shared, so Draw
+	// takes no lock, different encoders can be used at the same time.
+	class DrawEncoder
+	{
+	public:
+		DrawEncoder();
+
+		bool Draw(uint64_t sortKey, PipelineStateHandle stateHandle, const DrawCall& drawcall);
+
+		uint32_t Count() const { return static_cast<uint32_t>(entries.size()); }
+
+	private:
+		friend class DrawQueue;
+
+		void Init(uint32_t index, uint32_t capacity);
+		void Clear();
+
+		CommandStream				stream;
+		std::vector<DrawQueueEntry>	entries;
+		uint32_t					index;
+		uint32_t					capacity;
+		uint32_t					droppedDraws;
+
+		// the encoders sit next to each other in the queue, a cache line
+		// between what two threads write keeps them from sharing one,
+		// however the vector aligns them
+		uint8_t						padding[64];
+	};
+
+	// Draws recorded with a 64-bit sort key by one or more encoders, merged
+	// and sorted by key before they are submitted. The sort is a stable LSD
+	// radix sort on bytes over the draws gathered in encoder order, so draws
+	// with the same key go by encoder index, then by the order they were
+	// recorded in. As long as each thread is given its encoder by a fixed
+	// index (not by who comes first), the submission order is deterministic.
+	// The memory is bounded by the capacity given to Init, Draw fails when
+	// an encoder is full.
+	class DrawQueue
+	{
+	public:
+		DrawQueue();
+
+		// capacity is per encoder
+		void Init(uint32_t capacity, uint32_t encoderCount = 1);
+
+		// not to be called while encoders are recording
+		void Clear();
+
+		DrawEncoder* GetEncoder(uint32_t index);
+
+		uint32_t GetEncoderCount() const { return static_cast<uint32_t>(encoders.size()); }
+
+		// records with encoder 0
+		bool Draw(uint64_t sortKey, PipelineStateHandle stateHandle, const DrawCall& drawcall);
+
+		// gathers and sorts the draws of all encoders, once they are done
+		void Sort();
+
+		// sorts the draws if needed and hands them to the api in key order
+		void Submit(GraphicsAPI* api);
+
+		uint32_t Count() const;
+
+		// the pipeline changes are only counted here, not on every sort
+		const DrawQueueStats& GetStats();
+
+	private:
+		uint32_t CountPipelineChanges(const std::vector<DrawQueueEntry>& order) const;
+
+		std::vector<DrawEncoder>	encoders;
+		std::vector<DrawQueueEntry>	entries;
+		std::vector<DrawQueueEntry>	scratch;
+		std::vector<CommandStreamReader> readers;	// one per encoder
+		std::vector<const uint32_t*> readerWords;	// stream words each reader was made for
+		std::vector<uint32_t>		readerSizes;	// and their size
+		bool						sorted;			// entries has all the draws, in key order
+		bool						countedChanges;	// the pipeline changes in stats are up to date
+
+		DrawQueueStats				stats;
+	};
+}
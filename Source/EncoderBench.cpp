@@ -0,0 +1,397 @@
+// Measures a DrawQueue filled from several threads at once, each recording
+// into an encoder of its own, for 1 to 16 threads.
+//
+//   EncoderBench [draws] [frames]
+//
+// The draws of a frame are cut into one slice per thread, thread t always
+// records its slice with encoder t. Once they are all done the queue is
+// sorted and submitted to the null backend. For each thread count it prints
+// the best frame time for recording (from the start of the threads to the
+// last one done), sorting and submitting. Before that it checks the order
+// is deterministic: the draws are recorded with sort keys that tie a lot,
+// many times for each thread count, and the order they reach the backend
+// must be the same every time, the one of a stable sort by key of the
+// draws taken encoder by encoder. It returns 1 if it isn't. Build without
+// _DEBUG, or the validation layer is measured too. Off Windows it builds
+// with:
+//
+//   g++ -std=c++14 -O2 -pthread -ISource Source/EncoderBench.cpp Source/DrawQueue.cpp Source/GraphicsAPI.cpp
+//       Source/GraphicsAPINull.cpp Source/GraphicsAPIValidation.cpp Source/CommandStream.cpp -o EncoderBench
+
+#include "GraphicsAPI.h"
+#include "GraphicsAPINull.h"
+#include "DrawQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace bamboo;
+
+	constexpr uint32_t PipelineCount = 4;
+	constexpr uint32_t MeshCount = 64;
+	constexpr uint32_t ConstantBufferCount = 256;
+	constexpr uint32_t ThreadCounts[] = { 1, 2, 4, 8, 16 };
+	constexpr uint32_t MaxThreadCount = 16;
+
+	struct Scene
+	{
+		BindingLayoutHandle			layout;
+		VertexShaderHandle			vs;
+		PixelShaderHandle			ps[PipelineCount];
+		PipelineStateHandle			pipelines[PipelineCount];
+		BufferHandle				vertexBuffers[MeshCount];
+		BufferHandle				constantBuffers[ConstantBufferCount];
+	};
+
+	void CreateScene(GraphicsAPI* api, Scene& scene)
+	{
+		// 4 root constants and a constant buffer
+		BindingLayout layout = {};
+		layout.SetEntry(0, BINDING_SLOT_TYPE_CONSTANT, SHADER_VISIBILITY_ALL, 4, 0);
+		layout.SetEntry(1, BINDING_SLOT_TYPE_CBV, SHADER_VISIBILITY_ALL, 1, 0);
+		scene.layout = api->CreateBindingLayout(layout);
+
+		uint8_t bytecode[16] = {};
+		scene.vs = api->CreateVertexShader(bytecode, sizeof(bytecode));
+
+		for (uint32_t i = 0; i < PipelineCount; ++i)
+		{
+			bytecode[0] = static_cast<uint8_t>(i + 1);
+			scene.ps[i] = api->CreatePixelShader(bytecode, sizeof(bytecode));
+
+			PipelineState state = {};
+			state.BindingLayout = scene.layout;
+			state.VertexShader = scene.vs;
+			state.PixelShader = scene.ps[i];
+			state.VertexLayout.ElementCount = 1;
+			state.PrimitiveType = PRIMITIVE_TRIANGLES;
+			scene.pipelines[i] = api->CreatePipelineState(state);
+		}
+
+		float data[64] = {};
+		for (uint32_t i = 0; i < MeshCount; ++i)
+		{
+			scene.vertexBuffers[i] = api->CreateBuffer(sizeof(data), BINDING_VERTEX_BUFFER);
+			api->UpdateBuffer(scene.vertexBuffers[i], sizeof(data), data, 16);
+		}
+
+		for (uint32_t i = 0; i < ConstantBufferCount; ++i)
+			scene.constantBuffers[i] = api->CreateBuffer(256, BINDING_CONSTANT_BUFFER);
+	}
+
+	// the draw i of a frame, the first root constant is i so the order the
+	// draws are submitted in can be told. Only the pipeline and the mesh go
+	// in the key, many draws share one.
+	uint64_t FillDraw(const Scene& scene, uint32_t i, DrawCall& drawcall, PipelineStateHandle& pipeline)
+	{
+		uint32_t mesh = (i * 7) % MeshCount;
+
+		drawcall.ElementCount = 36 + mesh * 3;
+		drawcall.VertexBufferCount = 1;
+		drawcall.VertexBuffers[0] = scene.vertexBuffers[mesh];
+
+		drawcall.ResourceBindingData[0] = i;
+		drawcall.ResourceBindingData[1] = mesh;
+		drawcall.ResourceBindingData[2] = i * 3;
+		drawcall.ResourceBindingData[3] = 1;
+		drawcall.ResourceBindingData[4] = scene.constantBuffers[i % ConstantBufferCount].id;
+
+		pipeline = scene.pipelines[(i / 16) % PipelineCount];
+		return DefaultSortKeyLayout.Encode(0, 0, pipeline, mesh, 0);
+	}
+
+	// the draws of thread t out of count
+	void Slice(uint32_t drawCount, uint32_t t, uint32_t count, uint32_t& first, uint32_t& last)
+	{
+		first = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * t / count);
+		last = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (t + 1) / count);
+	}
+
+	// Threads recording a frame each time Record is called, thread t with
+	// encoder t. They are kept between frames so starting them isn't timed.
+	class Recorders
+	{
+	public:
+		Recorders(const Scene& scene, DrawQueue& queue, uint32_t drawCount)
+			:
+			scene(scene),
+			queue(queue),
+			drawCount(drawCount),
+			generation(0),
+			running(0),
+			quit(false)
+		{
+			for (uint32_t t = 0; t < queue.GetEncoderCount(); ++t)
+				threads.emplace_back([this, t]() { Run(t); });
+		}
+
+		~Recorders()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			start.notify_all();
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+
+		// returns once every thread has recorded its slice
+		void Record()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			running = static_cast<uint32_t>(threads.size());
+			generation++;
+			start.notify_all();
+			done.wait(lock, [this]() { return 0 == running; });
+		}
+
+	private:
+		void Run(uint32_t t)
+		{
+			uint64_t seen = 0;
+			DrawEncoder* encoder = queue.GetEncoder(t);
+			uint32_t first, last;
+			Slice(drawCount, t, queue.GetEncoderCount(), first, last);
+
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					start.wait(lock, [&]() { return quit || generation != seen; });
+					if (quit)
+						return;
+					seen = generation;
+				}
+
+				DrawCall drawcall;
+				PipelineStateHandle pipeline;
+				for (uint32_t i = first; i < last; ++i)
+				{
+					memset(&drawcall, 0, sizeof(drawcall));
+					uint64_t key = FillDraw(scene, i, drawcall, pipeline);
+					encoder->Draw(key, pipeline, drawcall);
+				}
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (0 == --running)
+					done.notify_one();
+			}
+		}
+
+		const Scene&				scene;
+		DrawQueue&					queue;
+		uint32_t					drawCount;
+
+		std::vector<std::thread>	threads;
+		std::mutex					mutex;
+		std::condition_variable		start;
+		std::condition_variable		done;
+		uint64_t					generation;
+		uint32_t					running;
+		bool						quit;
+	};
+
+	// A layer over the backend keeping the first root constant of every
+	// draw, in the order they come
+	struct DrawOrder final : public GraphicsAPI
+	{
+		GraphicsAPI*				backend;
+		std::vector<uint32_t>		draws;
+
+		explicit DrawOrder(GraphicsAPI* backend) : backend(backend) {}
+
+		BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) override { return backend->CreateBindingLayout(layout); }
+		void DestroyBindingLayout(BindingLayoutHandle handle) override { backend->DestroyBindingLayout(handle); }
+		BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) override { return backend->CreateBindingGroup(layout, bindingData); }
+		void DestroyBindingGroup(BindingGroupHandle handle) override { backend->DestroyBindingGroup(handle); }
+		PipelineStateHandle CreatePipelineState(const PipelineState& state) override { return backend->CreatePipelineState(state); }
+		void DestroyPipelineState(PipelineStateHandle handle) override { backend->DestroyPipelineState(handle); }
+		BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic = false) override { return backend->CreateBuffer(size, bindingFlags, dynamic); }
+		void DestroyBuffer(BufferHandle handle) override { backend->DestroyBuffer(handle); }
+		void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) override { backend->UpdateBuffer(handle, size, data, stride, format); }
+		bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) override { return backend->UpdateBufferRegion(handle, offset, size, data, stride, format); }
+		TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height = 1, uint32_t depth = 1, uint32_t arraySize = 1, uint32_t mipLevels = 1, bool dynamic = false) override { return backend->CreateTexture(type, format, bindFlags, width, height, depth, arraySize, mipLevels, dynamic); }
+		TextureHandle CreateTexture(const wchar_t* filename) override { return backend->CreateTexture(filename); }
+		void DestroyTexture(TextureHandle handle) override { backend->DestroyTexture(handle); }
+		void UpdateTexture(TextureHandle handle, size_t pitch, const void* data) override { backend->UpdateTexture(handle, pitch, data); }
+		void Clear(TextureHandle handle, float color[4]) override { backend->Clear(handle, color); }
+		void ClearDepth(TextureHandle handle, float depth) override { backend->ClearDepth(handle, depth); }
+		void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil) override { backend->ClearDepthStencil(handle, depth, stencil); }
+		SamplerHandle CreateSampler() override { return backend->CreateSampler(); }
+		void DestroySampler(SamplerHandle handle) override { backend->DestroySampler(handle); }
+		VertexShaderHandle CreateVertexShader(const void* bytecode, size_t size) override { return backend->CreateVertexShader(bytecode, size); }
+		void DestroyVertexShader(VertexShaderHandle handle) override { backend->DestroyVertexShader(handle); }
+		PixelShaderHandle CreatePixelShader(const void* bytecode, size_t size) override { return backend->CreatePixelShader(bytecode, size); }
+		void DestroyPixelShader(PixelShaderHandle handle) override { backend->DestroyPixelShader(handle); }
+		void Present() override { backend->Present(); }
+		void Shutdown() override { backend->Shutdown(); }
+		void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const override { backend->GetResourceMemoryUsage(usage); }
+		const GraphicsAPI* GetBackendAPI() const override { return backend->GetBackendAPI(); }
+
+		void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) override
+		{
+			draws.push_back(drawcall.ResourceBindingData[0]);
+			backend->Draw(stateHandle, drawcall);
+		}
+	};
+
+	// the order the queue has to give: a stable sort by key of the draws
+	// gathered encoder by encoder, as each was recorded
+	std::vector<uint32_t> ExpectedOrder(const Scene& scene, uint32_t drawCount)
+	{
+		std::vector<std::pair<uint64_t, uint32_t>> draws(drawCount);
+		DrawCall drawcall;
+		PipelineStateHandle pipeline;
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			memset(&drawcall, 0, sizeof(drawcall));
+			draws[i] = std::make_pair(FillDraw(scene, i, drawcall, pipeline), i);
+		}
+
+		std::stable_sort(draws.begin(), draws.end(),
+			[](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+
+		std::vector<uint32_t> order(drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i)
+			order[i] = draws[i].second;
+		return order;
+	}
+
+	// the slices are taken in thread order, so the draws gathered encoder
+	// by encoder are the draws in order, whatever the thread count
+	bool CheckOrder(GraphicsAPI* api, const Scene& scene, uint32_t drawCount, uint32_t runs)
+	{
+		std::vector<uint32_t> expected = ExpectedOrder(scene, drawCount);
+		DrawOrder order(api);
+		bool deterministic = true;
+
+		for (uint32_t threadCount : ThreadCounts)
+		{
+			DrawQueue queue;
+			queue.Init(drawCount / threadCount + 1, threadCount);
+			Recorders recorders(scene, queue, drawCount);
+
+			uint32_t mismatches = 0;
+			for (uint32_t run = 0; run < runs; ++run)
+			{
+				queue.Clear();
+				recorders.Record();
+
+				order.draws.clear();
+				queue.Submit(&order);
+				api->Present();
+
+				if (order.draws != expected)
+					mismatches++;
+			}
+
+			if (mismatches > 0)
+			{
+				printf("%u threads: %u runs of %u submitted the draws in another order\n", threadCount, mismatches, runs);
+				deterministic = false;
+			}
+		}
+
+		return deterministic;
+	}
+
+	struct Result
+	{
+		double						recordTime;		// in milliseconds, the best frame
+		double						sortTime;
+		double						submitTime;
+	};
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Result Run(GraphicsAPI* api, const Scene& scene, uint32_t drawCount, uint32_t frameCount, uint32_t threadCount)
+	{
+		DrawQueue queue;
+		queue.Init(drawCount / threadCount + 1, threadCount);
+		Recorders recorders(scene, queue, drawCount);
+
+		Result result = {};
+		null::ResetStatistics(api);
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			queue.Clear();
+
+			auto start = std::chrono::steady_clock::now();
+			recorders.Record();
+			double recordTime = Milliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			queue.Sort();
+			double sortTime = Milliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			queue.Submit(api);
+			double submitTime = Milliseconds(start);
+
+			api->Present();
+
+			if (0 == frame || recordTime < result.recordTime) result.recordTime = recordTime;
+			if (0 == frame || sortTime < result.sortTime) result.sortTime = sortTime;
+			if (0 == frame || submitTime < result.submitTime) result.submitTime = submitTime;
+		}
+
+		null::Statistics stats;
+		null::GetStatistics(api, stats);
+		if (stats.DrawCalls != drawCount * frameCount || stats.DroppedDrawCalls != 0)
+			printf("%u draws of %u went through, %u dropped\n", stats.DrawCalls, drawCount * frameCount, stats.DroppedDrawCalls);
+
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t drawCount = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 100000;
+	uint32_t frameCount = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 20;
+
+	if (drawCount < MaxThreadCount || 0 == frameCount)
+	{
+		printf("usage: %s [draws] [frames], at least %u draws\n", argv[0], MaxThreadCount);
+		return 1;
+	}
+
+	GraphicsAPI* api = InitGraphicsAPI(Null, nullptr);
+	if (nullptr == api)
+	{
+		printf("can't create the null backend\n");
+		return 1;
+	}
+
+	Scene scene;
+	CreateScene(api, scene);
+
+	bool deterministic = CheckOrder(api, scene, std::min(drawCount, 20000u), 20);
+	printf("submission order %s\n\n", deterministic ? "is deterministic" : "is not the expected one");
+
+	printf("%u draws a frame, %u frames, %u hardware threads\n\n", drawCount, frameCount, std::thread::hardware_concurrency());
+	printf("threads  record ms    sort ms  submit ms  record ns/draw\n");
+
+	for (uint32_t threadCount : ThreadCounts)
+	{
+		Result result = Run(api, scene, drawCount, frameCount, threadCount);
+		printf("%7u %10.3f %10.3f %10.3f %15.1f\n", threadCount, result.recordTime, result.sortTime, result.submitTime,
+			result.recordTime * 1e6 / drawCount);
+	}
+
+	api->Shutdown();
+	return deterministic ? 0 : 1;
+}
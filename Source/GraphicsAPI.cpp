@@ -1,27 +1,63 @@
 #include "GraphicsAPI.h"
 
+#if defined(_WIN32)
 #include "GraphicsAPIDX11.h"
 #include "GraphicsAPIDX12.h"
+#endif
+#include "GraphicsAPINull.h"
+#include "GraphicsAPIValidation.h"
+#include "CommandStream.h"
 
 #include <cstring>
 
 namespace bamboo
 {
-	GraphicsAPI* InitGraphicsAPI(GraphicsAPIType type, void* windowHandle)
+	GraphicsAPI* InitGraphicsAPI(GraphicsAPIType type, void* windowHandle, const ResourceLimits& limits)
 	{
+		GraphicsAPI* api = nullptr;
+
 		switch (type)
 		{
+#if defined(_WIN32)
 		case Direct3D11:
-			return bamboo::dx11::InitGraphicsAPIDX11(windowHandle);
+			api = bamboo::dx11::InitGraphicsAPIDX11(windowHandle, limits);
 			break;
 		case Direct3D12:
-			return bamboo::dx12::InitGraphicsAPIDX12(windowHandle);
+			api = bamboo::dx12::InitGraphicsAPIDX12(windowHandle, limits);
+			break;
+#endif
+		case Null:
+			api = bamboo::null::InitGraphicsAPINull(windowHandle, limits);
 			break;
 		case GNM:
 		default:
 			break;
 		}
-		return nullptr;
+
+#if BAMBOO_GRAPHICS_VALIDATION
+		api = bamboo::validation::InitGraphicsAPIValidation(api, limits);
+#endif
+
+		return api;
+	}
+
+	void GraphicsAPI::Submit(const CommandStream& stream)
+	{
+		CommandStreamReader reader(stream);
+		PipelineStateHandle stateHandle;
+
+		while (const DrawCall* drawcall = reader.Next(stateHandle))
+		{
+			Draw(stateHandle, *drawcall);
+		}
+	}
+
+	void GraphicsAPI::Submit(const DrawItem* items, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			Draw(items[i].PipelineState, *items[i].Call);
+		}
 	}
 
 	void DrawCall::FillBindingData(uint32_t offset, const void * data, size_t size)
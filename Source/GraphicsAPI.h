@@ -5,11 +5,15 @@
 
 namespace bamboo
 {
-#define HANDLE_DECLARE(type) struct type##Handle { uint16_t id; }
+#define HANDLE_DECLARE(type) struct type##Handle { uint32_t id; }
 
-	constexpr uint16_t invalid_handle = UINT16_MAX;
+	constexpr uint32_t invalid_handle = UINT32_MAX;
+
+	// set on a handle in the binding data to mark a buffer bound as shader resource
+	constexpr uint32_t binding_buffer_flag = 0x80000000u;
 
 	HANDLE_DECLARE(BindingLayout);
+	HANDLE_DECLARE(BindingGroup);
 	HANDLE_DECLARE(PipelineState);
 	HANDLE_DECLARE(Buffer);
 	HANDLE_DECLARE(Texture);
@@ -130,6 +134,7 @@ namespace bamboo
 	constexpr size_t MaxSamplerBindingSlot = 16;
 
 	constexpr size_t MaxBindingLayoutCount = 32;
+	constexpr size_t MaxBindingGroupCount = 1024;
 	constexpr size_t MaxPipelineStateCount = 1024;
 	constexpr size_t MaxBufferCount = 4096;
 	constexpr size_t MaxTextureCount = 1024;
@@ -137,13 +142,52 @@ namespace bamboo
 	constexpr size_t MaxVertexShaderCount = 1024;
 	constexpr size_t MaxPixelShaderCount = 1024;
 
+	// how many of each resource type can be alive at the same time, the
+	// backend records are allocated on demand up to these numbers
+	struct ResourceLimits
+	{
+		uint32_t					BindingLayoutCount;
+		uint32_t					BindingGroupCount;
+		uint32_t					PipelineStateCount;
+		uint32_t					BufferCount;
+		uint32_t					TextureCount;
+		uint32_t					SamplerCount;
+		uint32_t					VertexShaderCount;
+		uint32_t					PixelShaderCount;
+	};
+
+	constexpr ResourceLimits DefaultResourceLimits =
+	{
+		MaxBindingLayoutCount,
+		MaxBindingGroupCount,
+		MaxPipelineStateCount,
+		MaxBufferCount,
+		MaxTextureCount,
+		MaxSamplerCount,
+		MaxVertexShaderCount,
+		MaxPixelShaderCount
+	};
+
+	// bytes taken by the handles and backend records of each resource type
+	struct ResourceMemoryUsage
+	{
+		size_t						BindingLayouts;
+		size_t						BindingGroups;
+		size_t						PipelineStates;
+		size_t						Buffers;
+		size_t						Textures;
+		size_t						Samplers;
+		size_t						VertexShaders;
+		size_t						PixelShaders;
+	};
+
 #pragma pack(push, 1)
 	struct VertexInputElement
 	{
 		uint16_t				SemanticId : 4;
 		uint16_t				ComponentCount : 2;  // 0 ~ 3 stands for 1 ~ 4
 		uint16_t				ComponentType : 3;
-		uint16_t				Reserved : 3;
+		uint16_t				InstanceStepRate : 3; // 0 for per vertex data, else the stream advances every n instances
 		uint16_t				BindingSlot : 4;
 	};
 #pragma pack(pop)
@@ -169,14 +213,14 @@ namespace bamboo
 	struct PipelineState
 	{
 		BindingLayoutHandle			BindingLayout;
-		VertexLayout				VertexLayout;
+		bamboo::VertexLayout		VertexLayout;
 
 		union
 		{
 			struct
 			{
 				uint32_t			CullMode : 2;
-				uint32_t			_Reserved : 30;
+				uint32_t			_Reserved0 : 30;
 			};
 			uint32_t				RasterizerState;
 		};
@@ -188,7 +232,7 @@ namespace bamboo
 				uint32_t			DepthEnable : 1;
 				uint32_t			DepthWrite : 1;
 				uint32_t			DepthFunc : 3;
-				uint32_t			_Reserved : 27;
+				uint32_t			_Reserved1 : 27;
 			};
 			uint32_t				DepthStencilState;
 		};
@@ -200,7 +244,7 @@ namespace bamboo
 		PixelFormat					RenderTargetFormats[MaxRenderTargetBindingSlot];
 		PixelFormat					DepthStencilFormat;
 
-		PrimitiveType				PrimitiveType;
+		bamboo::PrimitiveType		PrimitiveType;
 	};
 #pragma pack(pop)
 
@@ -240,6 +284,10 @@ namespace bamboo
 	struct DrawCall
 	{
 		uint32_t					ElementCount;
+		uint32_t					InstanceCount;		// 0 is taken as 1
+		uint32_t					FirstInstance;		// added to the instance index of the per instance streams only
+		uint32_t					StartIndex;			// first index read, if HasIndexBuffer
+		int32_t						BaseVertex;			// added to the indices, or the first vertex without index buffer
 
 		union
 		{
@@ -251,19 +299,27 @@ namespace bamboo
 				uint32_t			SamplerCount : 4;
 				uint32_t			HasIndexBuffer : 1;
 				uint32_t			HasDepthStencil : 1;
-				uint32_t			_Reserved : 14;
+				uint32_t			HasBindingGroup : 1;
+				uint32_t			_Reserved : 13;
 			};
 			uint32_t				InfoBits;
 		};
 
 		BufferHandle				VertexBuffers[MaxVertexBufferBindingSlot];
 		BufferHandle				IndexBuffer;
+		uint32_t					VertexBufferOffsets[MaxVertexBufferBindingSlot];	// in bytes
+		uint32_t					IndexBufferOffset;	// in bytes
 
 		uint32_t					ResourceBindingData[MaxBindingDataSize];
 
 		TextureHandle				RenderTargets[MaxRenderTargetBindingSlot];
 		TextureHandle				DepthStencil;
 
+		// if HasBindingGroup is set, the buffers, textures and samplers of the
+		// binding layout come from here, only the root constants are taken
+		// from ResourceBindingData
+		BindingGroupHandle			BindingGroup;
+
 		/*struct
 		{
 			SamplerHandle			Handle;
@@ -279,7 +335,7 @@ namespace bamboo
 			};
 		}							Samplers[MaxSamplerBindingSlot];*/
 
-		Viewport					Viewport;
+		bamboo::Viewport			Viewport;
 
 		void FillBindingData(uint32_t offset, BufferHandle handle)
 		{
@@ -307,12 +363,29 @@ namespace bamboo
 	};
 #pragma pack(pop)
 
+	// a draw of a batch given to GraphicsAPI::Submit, the DrawCall is not copied
+	struct DrawItem
+	{
+		PipelineStateHandle			PipelineState;
+		const DrawCall*				Call;
+	};
+
+	class CommandStream;
+
 	struct GraphicsAPI
 	{
 		// Binding Layout
 		virtual BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) = 0;
 		virtual void DestroyBindingLayout(BindingLayoutHandle handle) = 0;
 
+		// Binding Groups
+		// the resources of a binding layout, resolved once into what the backend binds.
+		// bindingData is laid out as DrawCall::ResourceBindingData, the root constants
+		// in it are ignored. A group is immutable, it must be destroyed before the
+		// resources in it, and used with pipeline states of the same binding layout.
+		virtual BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) = 0;
+		virtual void DestroyBindingGroup(BindingGroupHandle handle) = 0;
+
 		// Pipeline States
 		virtual PipelineStateHandle CreatePipelineState(const PipelineState& state) = 0;
 		virtual void DestroyPipelineState(PipelineStateHandle handle) = 0;
@@ -321,6 +394,11 @@ namespace bamboo
 		virtual BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic = false) = 0;
 		virtual void DestroyBuffer(BufferHandle handle) = 0;
 		virtual void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) = 0;
+		// writes size bytes at offset and leaves the rest of the buffer as it is, stride and format
+		// describe the whole buffer as in UpdateBuffer. Not for constant buffers. A dynamic buffer
+		// is not renamed, the range must not be in use by the GPU. false if nothing was written:
+		// a bad handle or range, or the backend is out of upload space for this frame.
+		virtual bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) = 0;
 
 		// Textures
 		virtual TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height = 1, uint32_t depth = 1, uint32_t arraySize = 1, uint32_t mipLevels = 1, bool dynamic = false) = 0;
@@ -346,6 +424,16 @@ namespace bamboo
 		// Draw Functions
 		virtual void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) = 0;
 
+		// draws recorded in the stream, in order, by default decoded one by one into Draw.
+		// Decoding rebuilds a DrawCall per draw, so it is for streams recorded ahead or on
+		// other threads, draws made on the spot are cheaper through Draw.
+		virtual void Submit(const CommandStream& stream);
+
+		// draws in order, as Draw would one by one. The backends look up a pipeline state and
+		// its binding layout once per run of items using it, and prefetch the records of the
+		// next draw while binding the current one.
+		virtual void Submit(const DrawItem* items, size_t count);
+
 		// Swap Chains
 		// TODO, bind swap chains with render targets
 		virtual void Present() = 0;
@@ -353,13 +441,35 @@ namespace bamboo
 		// Clean up
 		virtual void Shutdown() = 0;
 
-		HandleAlloc<MaxBindingLayoutCount>		blHandleAlloc;
-		HandleAlloc<MaxPipelineStateCount>		psoHandleAlloc;
-		HandleAlloc<MaxBufferCount>				bufHandleAlloc;
-		HandleAlloc<MaxTextureCount>			texHandleAlloc;
-		HandleAlloc<MaxSamplerCount>			sampHandleAlloc;
-		HandleAlloc<MaxVertexShaderCount>		vsHandleAlloc;
-		HandleAlloc<MaxPixelShaderCount>		psHandleAlloc;
+		// Statistics
+		virtual void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const = 0;
+
+		// The backend itself, the layers forwarding to one (validation, trace)
+		// return the one under them. The functions a backend has of its own go
+		// through this, so they take what InitGraphicsAPI returned as well.
+		virtual const GraphicsAPI* GetBackendAPI() const { return this; }
+		GraphicsAPI* GetBackendAPI() { return const_cast<GraphicsAPI*>(static_cast<const GraphicsAPI*>(this)->GetBackendAPI()); }
+
+		void InitHandleAllocs(const ResourceLimits& limits)
+		{
+			blHandleAlloc.Init(limits.BindingLayoutCount);
+			bgHandleAlloc.Init(limits.BindingGroupCount);
+			psoHandleAlloc.Init(limits.PipelineStateCount);
+			bufHandleAlloc.Init(limits.BufferCount);
+			texHandleAlloc.Init(limits.TextureCount);
+			sampHandleAlloc.Init(limits.SamplerCount);
+			vsHandleAlloc.Init(limits.VertexShaderCount);
+			psHandleAlloc.Init(limits.PixelShaderCount);
+		}
+
+		HandleAlloc<>				blHandleAlloc;
+		HandleAlloc<>				bgHandleAlloc;
+		HandleAlloc<>				psoHandleAlloc;
+		HandleAlloc<>				bufHandleAlloc;
+		HandleAlloc<>				texHandleAlloc;
+		HandleAlloc<>				sampHandleAlloc;
+		HandleAlloc<>				vsHandleAlloc;
+		HandleAlloc<>				psHandleAlloc;
 	};
 
 
@@ -367,9 +477,21 @@ namespace bamboo
 	{
 		Direct3D11,
 		Direct3D12,
-		GNM
+		GNM,
+		Null,		// no device, for running the frontend headless
 	};
 
 
-	GraphicsAPI* InitGraphicsAPI(GraphicsAPIType type, void* windowHandle);
+	// The backends only assert what the draws bind. With BAMBOO_GRAPHICS_VALIDATION set to 1,
+	// by default in debug builds, InitGraphicsAPI puts the backend behind the validation
+	// layer (GraphicsAPIValidation.h), which checks every call.
+#if !defined(BAMBOO_GRAPHICS_VALIDATION)
+#if defined(_DEBUG)
+#define BAMBOO_GRAPHICS_VALIDATION 1
+#else
+#define BAMBOO_GRAPHICS_VALIDATION 0
+#endif
+#endif
+
+	GraphicsAPI* InitGraphicsAPI(GraphicsAPIType type, void* windowHandle, const ResourceLimits& limits = DefaultResourceLimits);
 }
@@ -7,6 +7,9 @@ namespace bamboo
 {
 	namespace dx11
 	{
-		GraphicsAPI* InitGraphicsAPIDX11(void* windowHandle);
+		GraphicsAPI* InitGraphicsAPIDX11(void* windowHandle, const ResourceLimits& limits);
+
+		// the backend class is in GraphicsAPIDX11Impl.h, for GraphicsDevice
+		struct GraphicsAPIDX11;
 	}
 }
@@ -1,12 +1,51 @@
 #pragma once
 
 #include "GraphicsAPI.h"
+#include "DescriptorCache.h"
+#include "PipelineCache.h"
 
 
 namespace bamboo
 {
 	namespace dx12
 	{
-		GraphicsAPI* InitGraphicsAPIDX12(void* windowHandle);
+		enum StateCacheCounter
+		{
+			STATE_VERTEX_BUFFERS,
+			STATE_INDEX_BUFFER,
+			STATE_VIEWPORT,
+			STATE_SCISSOR_RECT,
+			STATE_ROOT_CONSTANTS,
+			STATE_ROOT_DESCRIPTORS,
+			STATE_DESCRIPTOR_TABLES,
+			STATE_RENDER_TARGETS,
+			NUM_STATE_CACHE_COUNTER
+		};
+
+		// per kind of state, how many times it was set on the command list
+		// and how many times it was skipped because it was already bound
+		struct StateCacheStatistics
+		{
+			uint32_t					Issued[NUM_STATE_CACHE_COUNTER];
+			uint32_t					Filtered[NUM_STATE_CACHE_COUNTER];
+		};
+
+		GraphicsAPI* InitGraphicsAPIDX12(void* windowHandle, const ResourceLimits& limits);
+
+		// api must have been created by InitGraphicsAPIDX12, or be a layer over
+		// one, as InitGraphicsAPI(Direct3D12) may return
+		void GetStateCacheStatistics(const GraphicsAPI* api, StateCacheStatistics& stats);
+		void ResetStateCacheStatistics(GraphicsAPI* api);
+
+		// descriptor tables of the CBV/SRV heap and of the sampler heap
+		void GetDescriptorCacheStatistics(const GraphicsAPI* api, DescriptorCacheStatistics& views, DescriptorCacheStatistics& samplers);
+		void ResetDescriptorCacheStatistics(GraphicsAPI* api);
+
+		// pipeline states shared between identical descriptions, and their compiles
+		void GetPipelineCacheStatistics(const GraphicsAPI* api, PipelineCacheStatistics& stats);
+		void ResetPipelineCacheStatistics(GraphicsAPI* api);
+
+		// the backend class is in GraphicsAPIDX12Impl.h, for GraphicsDevice
+		struct GraphicsAPIDX12;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,2981 @@
+#pragma once
+
+// The Direct3D 12 backend itself, in a header so GraphicsDevice can call its final
+// class directly, see StaticBackend. Only GraphicsAPIDX12.cpp and
+// GraphicsDevice.h include it.
+
+#include "GraphicsAPIDX12.h"
+
+#include <Windows.h>
+#include <dxgi1_5.h>
+#include <d3d12.h>
+#include <d3dx12.h>
+
+#include <WICTextureLoader12.h>
+#include <DDSTextureLoader12.h>
+
+#pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "d3d12.lib")
+
+#include <vector>
+#include <cstring>
+
+#include "UploadHeapDX12.h"
+#include "ResourcePool.h"
+#include "DeferredRelease.h"
+#include "PipelineCache.h"
+
+#define RELEASE(x) if (nullptr != (x)) { (x)->Release(); (x) = nullptr; }
+#define FREE_HANDLE(h, a) if ((a).InUse(h)) { (a).Free(h); (h) = invalid_handle; }
+#define CE(x, e) if (S_OK != (x)) return (e);
+#define CHECKED(x) if (S_OK != (x)) return -1;
+
+#define USING_SYNC_UPLOAD_HEAP 1
+
+namespace bamboo
+{
+	namespace dx12
+	{
+		constexpr size_t RTVHeapSize = 1024;
+		constexpr size_t DSVHeapSize = 1024;
+		constexpr size_t SRVHeapSize = 1024;
+		constexpr size_t SamplerHeapSize = MaxSamplerCount;
+
+
+		const DXGI_FORMAT InputSlotTypeTable[][4] =
+		{
+			// TYPE_FLOAT
+			{ DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT },
+			// TYPE_INT8
+			{ DXGI_FORMAT_R8_SINT, DXGI_FORMAT_R8G8_SINT, DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R8G8B8A8_SINT },
+			// TYPE_UINT8
+			{ DXGI_FORMAT_R8_UINT, DXGI_FORMAT_R8G8_UINT, DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R8G8B8A8_UINT },
+			// TYPE_INT16
+			{ DXGI_FORMAT_R16_SINT, DXGI_FORMAT_R16G16_SINT, DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R16G16B16A16_SINT },
+			// TYPE_UINT16
+			{ DXGI_FORMAT_R16_UINT, DXGI_FORMAT_R16G16_UINT, DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R16G16B16A16_UINT },
+			// TYPE_INT32
+			{ DXGI_FORMAT_R32_SINT, DXGI_FORMAT_R32G32_SINT, DXGI_FORMAT_R32G32B32_SINT, DXGI_FORMAT_R32G32B32A32_SINT },
+			// TYPE_UINT32
+			{ DXGI_FORMAT_R32_UINT, DXGI_FORMAT_R32G32_UINT, DXGI_FORMAT_R32G32B32_UINT, DXGI_FORMAT_R32G32B32A32_UINT },
+		};
+
+		const size_t InputSlotSizeTable[] =
+		{
+			4, // TYPE_FLOAT
+			1, // TYPE_INT8
+			1, // TYPE_UINT8
+			2, // TYPE_INT16
+			2, // TYPE_UINT16
+			4, // TYPE_INT32
+			4, // TYPE_UINT32
+		};
+
+		const DXGI_FORMAT IndexTypeTable[] =
+		{
+			DXGI_FORMAT_UNKNOWN, // TYPE_FLOAT
+			DXGI_FORMAT_UNKNOWN, // TYPE_INT8
+			DXGI_FORMAT_UNKNOWN, // TYPE_UINT8
+			DXGI_FORMAT_UNKNOWN, // TYPE_INT16
+			DXGI_FORMAT_R16_UINT, // TYPE_UINT16
+			DXGI_FORMAT_UNKNOWN, // TYPE_INT32
+			DXGI_FORMAT_R32_UINT, // TYPE_UINT32
+		};
+
+		const LPSTR InputSemanticsTable[] =
+		{
+			"POSITION",
+			"COLOR",
+			"NORMAL",
+			"TANGENT",
+			"BINORMAL",
+			"TEXCOORD",
+			"TEXCOORD",
+			"TEXCOORD",
+			"TEXCOORD",
+		};
+
+		const UINT InputSemanticsIndex[] =
+		{
+			0,
+			0,
+			0,
+			0,
+			0,
+			0,
+			1,
+			2,
+			3,
+		};
+
+		const D3D12_PRIMITIVE_TOPOLOGY_TYPE TopologyTypeTable[] =
+		{
+			D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT,
+			D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE,
+			D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
+		};
+
+		const D3D12_PRIMITIVE_TOPOLOGY TopologyTable[] =
+		{
+			D3D_PRIMITIVE_TOPOLOGY_POINTLIST,
+			D3D_PRIMITIVE_TOPOLOGY_LINELIST,
+			D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
+		};
+
+		const uint32_t PixelFormatSizeTable[] =
+		{
+			0,
+			4,
+			4,
+			8,
+			8,
+			16,
+			2,
+			4,
+			2,
+			4,
+			4,
+		};
+
+		const DXGI_FORMAT PixelFormatTable[] =
+		{
+			DXGI_FORMAT_UNKNOWN, // AUTO
+			DXGI_FORMAT_R8G8B8A8_UNORM,
+			DXGI_FORMAT_R8G8B8A8_SNORM,
+			DXGI_FORMAT_R16G16B16A16_UNORM,
+			DXGI_FORMAT_R16G16B16A16_SNORM,
+			DXGI_FORMAT_R32G32B32A32_FLOAT,
+			DXGI_FORMAT_R16_SINT,
+			DXGI_FORMAT_R32_SINT,
+			DXGI_FORMAT_R16_UINT,
+			DXGI_FORMAT_R32_UINT,
+			DXGI_FORMAT_D24_UNORM_S8_UINT,
+		};
+
+		const D3D12_SHADER_VISIBILITY ShaderVisibilityTable[] =
+		{
+			D3D12_SHADER_VISIBILITY_ALL,
+			D3D12_SHADER_VISIBILITY_VERTEX,
+			D3D12_SHADER_VISIBILITY_PIXEL,
+		};
+
+		inline PixelFormat PixelFormatFromDXGI(DXGI_FORMAT format)
+		{
+			for (unsigned i = PixelFormat::FORMAT_AUTO; i < PixelFormat::NUM_PIXEL_FORMAT; ++i)
+			{
+				if (PixelFormatTable[i] == format)
+				{
+					return static_cast<PixelFormat>(i);
+				}
+			}
+			return FORMAT_AUTO;
+		}
+
+		struct BindingLayoutDX12
+		{
+			ID3D12RootSignature*		rootSig;
+
+			uint32_t					entryCount;
+			BindingLayout				layout;
+			uint32_t					offsets[MaxBindingLayoutEntry];
+			uint32_t					slotId[MaxBindingLayoutEntry];
+
+			BindingLayoutDX12()
+				:
+				rootSig(nullptr),
+				entryCount(0),
+				layout{},
+				offsets{}
+			{}
+		};
+
+		// what a compile thread needs to make a pipeline state, copied from the
+		// objects the application may destroy before it runs
+		struct PipelineCompileDX12
+		{
+			ID3D12Device*				device;
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC	desc;		// points to the members below
+			D3D12_INPUT_ELEMENT_DESC	elements[MaxVertexInputElement];
+			std::vector<uint8_t>		vs;
+			std::vector<uint8_t>		ps;
+			ID3D12PipelineState*		state;
+
+			PipelineCompileDX12()
+				:
+				device(nullptr),
+				desc{},
+				state(nullptr)
+			{}
+
+			bool Compile()
+			{
+				bool succeeded = SUCCEEDED(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&state)));
+
+				std::vector<uint8_t>().swap(vs);
+				std::vector<uint8_t>().swap(ps);
+
+				return succeeded;
+			}
+
+			void Reset()
+			{
+				RELEASE(state);
+				RELEASE(desc.pRootSignature);
+				std::vector<uint8_t>().swap(vs);
+				std::vector<uint8_t>().swap(ps);
+			}
+		};
+
+		struct PipelineStateDX12
+		{
+			ID3D12PipelineState*		state;			// of the shared entry, once it is compiled
+			uint32_t					shared;			// entry in the pipeline cache
+			BindingLayoutHandle			bindingLayout;
+			D3D12_PRIMITIVE_TOPOLOGY	topology;
+
+			PipelineStateDX12()
+				:
+				state(nullptr),
+				shared(PipelineCache<PipelineCompileDX12>::invalid_entry),
+				bindingLayout{ invalid_handle }
+			{}
+		};
+
+		/*
+		Buffer and texture records are split by how often they are read. The
+		part a draw call reads (BufferDX12, TextureDX12) is packed into 16 bytes,
+		with the buffer state kept as an index into BufferStateTable since it is
+		checked on every bind (texture states live in an array of their own), and
+		the rest (BufferResourceDX12, TextureDescDX12) is only
+		touched on creation, update or when a barrier is actually needed. All of
+		them are indexed by the slot index of the handle.
+		*/
+		// the states a buffer goes through, BufferDX12::state indexes this
+		enum BufferStateDX12
+		{
+			BUFFER_STATE_COMMON = 0,
+			BUFFER_STATE_COPY_DEST,
+			BUFFER_STATE_VERTEX_AND_CONSTANT_BUFFER,
+			BUFFER_STATE_INDEX_BUFFER,
+			BUFFER_STATE_NON_PIXEL_SHADER_RESOURCE,
+			BUFFER_STATE_PIXEL_SHADER_RESOURCE,
+			BUFFER_STATE_COUNT,
+		};
+
+		const D3D12_RESOURCE_STATES BufferStateTable[BUFFER_STATE_COUNT] =
+		{
+			D3D12_RESOURCE_STATE_COMMON,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+			D3D12_RESOURCE_STATE_INDEX_BUFFER,
+			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		};
+
+		inline uint16_t BufferStateIndex(D3D12_RESOURCE_STATES state)
+		{
+			switch (state)
+			{
+			case D3D12_RESOURCE_STATE_COPY_DEST:					return BUFFER_STATE_COPY_DEST;
+			case D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER:	return BUFFER_STATE_VERTEX_AND_CONSTANT_BUFFER;
+			case D3D12_RESOURCE_STATE_INDEX_BUFFER:					return BUFFER_STATE_INDEX_BUFFER;
+			case D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE:	return BUFFER_STATE_NON_PIXEL_SHADER_RESOURCE;
+			case D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE:		return BUFFER_STATE_PIXEL_SHADER_RESOURCE;
+			default:												return BUFFER_STATE_COMMON;
+			}
+		}
+
+		// strides have to fit in BufferDX12::stride, which covers the largest
+		// structure stride D3D12 takes
+		constexpr uint32_t MaxBufferStride = D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES;
+
+		struct BufferDX12
+		{
+			D3D12_GPU_VIRTUAL_ADDRESS	gpuAddress;
+			uint32_t					size;
+			uint16_t					stride : 12;
+			uint16_t					state : 4;		// BufferStateDX12
+			uint8_t						bindFlags;
+			uint8_t						format;
+
+			BufferDX12()
+				:
+				gpuAddress(0),
+				size(0),
+				stride(0),
+				state(BUFFER_STATE_COMMON),
+				bindFlags(0),
+				format(FORMAT_AUTO)
+			{}
+		};
+
+		static_assert(MaxBufferStride < (1u << 12), "BufferDX12::stride is too narrow");
+
+		static_assert(sizeof(BufferDX12) <= 16, "BufferDX12 should stay within 16 bytes");
+
+		struct BufferResourceDX12
+		{
+			ID3D12Resource*				buffer;
+			//uint16_t					cbv;
+			//uint16_t					srv;
+
+			BufferResourceDX12()
+				:
+				buffer(nullptr)
+				//srv(invalid_handle)
+			{}
+		};
+
+		struct TextureDX12
+		{
+			ID3D12Resource*				texture;
+			//uint16_t					srv;
+			uint32_t					rtv;
+			uint32_t					dsv;
+
+			TextureDX12()
+				:
+				texture(nullptr),
+				//srv(invalid_handle),
+				rtv(invalid_handle),
+				dsv(invalid_handle)
+			{}
+		};
+
+		static_assert(sizeof(TextureDX12) <= 16, "TextureDX12 should stay within 16 bytes");
+
+		struct TextureDescDX12
+		{
+			TextureType					type;
+			PixelFormat					format;
+			uint32_t					width;
+			uint32_t					height;
+			uint32_t					depth;
+			uint32_t					arraySize;
+			uint32_t					mipLevels;
+			bool						isCubeMap;
+
+			TextureDescDX12()
+				:
+				type(TEXTURE_2D),
+				format(FORMAT_AUTO),
+				width(0),
+				height(0),
+				depth(0),
+				arraySize(0),
+				mipLevels(0),
+				isCubeMap(false)
+			{}
+		};
+
+		// What the command list has bound, so a draw only sets what differs
+		// from the previous one. Root arguments are indexed by root parameter
+		// (root constants by where they are in the binding data) and are lost
+		// when the root signature changes.
+		struct StateCacheDX12
+		{
+			D3D12_VERTEX_BUFFER_VIEW	vertexBuffers[MaxVertexBufferBindingSlot];
+			uint32_t					vertexBufferCount;
+			D3D12_INDEX_BUFFER_VIEW		indexBuffer;
+			D3D12_VIEWPORT				viewport;
+			D3D12_RECT					scissorRect;
+			bool						hasIndexBuffer;
+			bool						hasViewport;
+			bool						hasScissorRect;
+
+			uint32_t					rootConstants[MaxBindingDataSize];
+			D3D12_GPU_VIRTUAL_ADDRESS	rootDescriptors[MaxBindingLayoutEntry];
+			bool						rootArgumentValid[MaxBindingLayoutEntry];
+
+			D3D12_CPU_DESCRIPTOR_HANDLE	renderTargets[MaxRenderTargetBindingSlot];
+			uint32_t					renderTargetCount;
+			D3D12_CPU_DESCRIPTOR_HANDLE	depthStencil;
+			bool						hasRenderTargets;
+
+			StateCacheStatistics		stats;
+
+			void Invalidate()
+			{
+				vertexBufferCount = 0;
+				hasIndexBuffer = false;
+				hasViewport = false;
+				hasScissorRect = false;
+				hasRenderTargets = false;
+				InvalidateRootArguments();
+			}
+
+			void InvalidateRootArguments()
+			{
+				memset(rootArgumentValid, 0, sizeof(rootArgumentValid));
+			}
+
+			// returns true if the state has to be set
+			inline bool Update(StateCacheCounter counter, bool changed)
+			{
+				if (changed)
+					stats.Issued[counter]++;
+				else
+					stats.Filtered[counter]++;
+				return changed;
+			}
+		};
+
+		// what a descriptor in a table is made from, the upper word of its key
+		// in the descriptor cache, the lower one is the resource handle
+		enum DescriptorKind
+		{
+			DESCRIPTOR_SAMPLER,
+			DESCRIPTOR_CBV,
+			DESCRIPTOR_SRV_BUFFER,
+			DESCRIPTOR_SRV_TEXTURE,
+		};
+
+		inline uint64_t DescriptorKey(DescriptorKind kind, uint32_t handle)
+		{
+			return (static_cast<uint64_t>(kind) << 32) | handle;
+		}
+
+		enum RootArgumentType
+		{
+			ROOT_ARGUMENT_NONE,
+			ROOT_ARGUMENT_CBV,
+			ROOT_ARGUMENT_SRV,
+			ROOT_ARGUMENT_VIEW_TABLE,
+			ROOT_ARGUMENT_SAMPLER_TABLE,
+		};
+
+		// a resolved root parameter, value is the GPU address of the buffer or
+		// the GPU handle of the table
+		struct RootArgumentDX12
+		{
+			uint32_t					slot;
+			uint32_t					type;
+			uint32_t					tableOffset;	// in the heap of the table
+			uint64_t					value;
+		};
+
+		// a buffer or texture a draw reads, with the state it must be in
+		struct ResourceUseDX12
+		{
+			uint32_t					index;
+			uint32_t					isTexture;
+			D3D12_RESOURCE_STATES		state;
+		};
+
+		// a root signature can take 64 DWORDs, a table is 1 and a descriptor 2
+		constexpr size_t MaxRootArgumentCount = 64;
+
+		// root arguments resolved once, its tables are pinned in the descriptor
+		// caches. The resources are still moved to their states on every draw.
+		struct BindingGroupDX12
+		{
+			BindingLayoutHandle			layout;
+			uint32_t					argumentCount;
+			uint32_t					useCount;
+			RootArgumentDX12			arguments[MaxRootArgumentCount];
+			ResourceUseDX12				uses[MaxBindingDataSize];
+		};
+
+		// the objects the GPU may still read after they are destroyed, their
+		// release and the recycling of their slot wait for the fence
+		enum DeferredObjectDX12
+		{
+			DEFERRED_BINDING_LAYOUT,
+			DEFERRED_PIPELINE_STATE,
+			DEFERRED_BUFFER,
+			DEFERRED_TEXTURE,
+		};
+
+		struct DeferredReleaseDX12
+		{
+			DeferredObjectDX12			type;
+			uint32_t					index;		// slot of the retired handle
+		};
+
+		struct SamplerDX12
+		{
+			//uint32_t				sampler;
+			D3D12_SAMPLER_DESC		desc;
+
+			SamplerDX12()
+				:
+				//sampler(invalid_handle),
+				desc{}
+			{}
+		};
+
+		struct ShaderDX12
+		{
+			uint8_t*			data;
+			size_t				size;
+			uint64_t			hash;		// of the bytecode, for the pipeline cache
+
+			ShaderDX12()
+				:
+				data(nullptr),
+				size(0),
+				hash(0)
+			{}
+		};
+
+		struct GraphicsAPIDX12 final : public GraphicsAPI
+		{
+			int							width;
+			int							height;
+
+			HWND						hWnd;
+
+			ID3D12Device*				device;
+			ID3D12CommandQueue*			cmdQueue;
+
+			IDXGISwapChain4*			swapChain;
+
+			ID3D12CommandAllocator*		cmdAlloc;
+			ID3D12GraphicsCommandList*	cmdList;
+
+			ID3D12Fence*				fence;
+			HANDLE						fenceEvent;
+
+			UINT						backBufferIndex;
+			UINT64						frameIndex;
+
+
+			HandleAlloc<>				rtvHeapAlloc;
+			HandleAlloc<>				dsvHeapAlloc;
+			//HandleAlloc<>				srvHeapAlloc;
+			HandleAlloc<>				sampHeapAlloc;
+
+			ID3D12DescriptorHeap*		rtvHeap;
+			ID3D12DescriptorHeap*		dsvHeap;
+			ID3D12DescriptorHeap*		srvHeap;
+			ID3D12DescriptorHeap*		sampHeap;
+
+			UINT						rtvHeapInc;
+			UINT						dsvHeapInc;
+			UINT						srvHeapInc;
+			UINT						sampHeapInc;
+
+			DescriptorCache<SRVHeapSize>		srvCache;
+			DescriptorCache<SamplerHeapSize>	sampCache;
+
+			ResourcePool<BindingLayoutDX12, 2>	bindingLayouts;
+			ResourcePool<BindingGroupDX12>		bindingGroups;
+			ResourcePool<PipelineStateDX12>		pipelineStates;
+			ResourcePool<BufferDX12>			buffers;
+			ResourcePool<BufferResourceDX12>	bufferResources;
+			ResourcePool<TextureDX12>			textures;
+			ResourcePool<D3D12_RESOURCE_STATES>	textureStates;
+			ResourcePool<TextureDescDX12>		textureDescs;
+			ResourcePool<SamplerDX12>			samplers;
+			ResourcePool<ShaderDX12>			vertexShaders;
+			ResourcePool<ShaderDX12>			pixelShaders;
+
+			BindingLayoutHandle			currentBindingLayout;
+			PipelineStateHandle			currentPipelineState;
+
+			StateCacheDX12				stateCache;
+
+			PipelineCache<PipelineCompileDX12>	pipelineCache;
+
+			DeferredReleaseQueue<DeferredReleaseDX12>	releaseQueue;
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+			UploadHeapSyncDX12			uploadHeap;
+#else
+			UploadHeapDX12				uploadHeap;
+#endif
+
+			int Init(void* windowHandle, const ResourceLimits& limits)
+			{
+				hWnd = reinterpret_cast<HWND>(windowHandle);
+
+				InitHandleAllocs(limits);
+				bindingLayouts.Init(limits.BindingLayoutCount);
+				bindingGroups.Init(limits.BindingGroupCount);
+				pipelineStates.Init(limits.PipelineStateCount);
+				pipelineCache.Init(limits.PipelineStateCount, PipelineCache<PipelineCompileDX12>::DefaultThreadCount());
+				buffers.Init(limits.BufferCount);
+				bufferResources.Init(limits.BufferCount);
+				textures.Init(limits.TextureCount);
+				textureStates.Init(limits.TextureCount);
+				textureDescs.Init(limits.TextureCount);
+				samplers.Init(limits.SamplerCount);
+				vertexShaders.Init(limits.VertexShaderCount);
+				pixelShaders.Init(limits.PixelShaderCount);
+
+				int result = 0;
+
+				if (0 != (result = InitDirect3D()))
+					return result;
+
+				if (0 != (result = InitRenderTargets()))
+					return result;
+
+				InitPipelineStates();
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				if (!uploadHeap.Init(device, cmdList))
+#else
+				if (!uploadHeap.Init(device))
+#endif
+				{
+					return -1;
+				}
+
+				srvCache.Init();
+				sampCache.Init();
+				srvCache.SetFrame(frameIndex, fence->GetCompletedValue());
+				sampCache.SetFrame(frameIndex, fence->GetCompletedValue());
+
+				return 0;
+			}
+
+			int InitDirect3D()
+			{
+				UINT dxgi_flag = 0;
+				IDXGIFactory5* factory = nullptr;
+				IDXGIAdapter1* adaptor = nullptr;
+
+#if defined(_DEBUG)
+				{
+					ID3D12Debug* debug = nullptr;
+					if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debug))))
+					{
+						debug->EnableDebugLayer();
+						debug->Release();
+
+						dxgi_flag |= DXGI_CREATE_FACTORY_DEBUG;
+					}
+				}
+#endif
+
+				CHECKED(CreateDXGIFactory2(dxgi_flag, IID_PPV_ARGS(&factory)));
+
+				{
+					IDXGIAdapter1* adpt = nullptr;
+					for (UINT i = 0;
+						SUCCEEDED(factory->EnumAdapters1(i, &adpt));
+						i++)
+					{
+						DXGI_ADAPTER_DESC1 desc;
+						CHECKED(adpt->GetDesc1(&desc));
+
+						if ((desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0)
+						{
+							adaptor = adpt;
+							break;
+						}
+
+						adpt->Release();
+					}
+
+					if (nullptr == adaptor)
+						return false;
+				}
+
+				CHECKED(D3D12CreateDevice(adaptor, D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(&device)));
+				adaptor->Release();
+
+				{
+					D3D12_COMMAND_QUEUE_DESC desc = {};
+					desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+					CHECKED(device->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)));
+				}
+
+				{
+					RECT rect = {};
+					GetClientRect(hWnd, &rect);
+					width = rect.right - rect.left;
+					height = rect.bottom - rect.top;
+				}
+
+				{
+					IDXGISwapChain1* swapChain_ = nullptr;
+					DXGI_SWAP_CHAIN_DESC1 desc = {};
+					desc.BufferCount = 2;
+					desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+					desc.Width = width;
+					desc.Height = height;
+					desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+					desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+					desc.SampleDesc.Count = 1;
+
+					CHECKED(factory->CreateSwapChainForHwnd(cmdQueue, hWnd, &desc, nullptr, nullptr, &swapChain_));
+					CHECKED(swapChain_->QueryInterface(IID_PPV_ARGS(&swapChain)));
+					swapChain_->Release();
+
+				}
+
+				factory->MakeWindowAssociation(hWnd, DXGI_MWA_NO_ALT_ENTER);
+				factory->Release();
+
+				{
+					D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+					desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+					desc.NumDescriptors = RTVHeapSize;
+					CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&rtvHeap)));
+					rtvHeapInc = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+					rtvHeapAlloc.Init(RTVHeapSize);
+				}
+
+				{
+					D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+					desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+					desc.NumDescriptors = DSVHeapSize;
+					CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&dsvHeap)));
+					dsvHeapInc = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+					dsvHeapAlloc.Init(DSVHeapSize);
+				}
+
+				{
+					D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+					desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+					desc.NumDescriptors = SRVHeapSize;
+					desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+					CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&srvHeap)));
+					srvHeapInc = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+					//srvHeapAlloc.Init(SRVHeapSize);
+				}
+
+				{
+					D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+					desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+					desc.NumDescriptors = SamplerHeapSize;
+					desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+					CHECKED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&sampHeap)));
+					sampHeapInc = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+					sampHeapAlloc.Init(SamplerHeapSize);
+				}
+
+				CHECKED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdAlloc)));
+
+				CHECKED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, cmdAlloc, nullptr, IID_PPV_ARGS(&cmdList)));
+
+				//cmdList->Close();
+				ID3D12DescriptorHeap* heaps[] = { srvHeap, sampHeap };
+				cmdList->SetDescriptorHeaps(2, heaps);
+
+				frameIndex = 1;
+				CHECKED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+				fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+				return 0;
+			}
+
+			int InitRenderTargets()
+			{
+				backBufferIndex = swapChain->GetCurrentBackBufferIndex();
+
+				for (UINT i = 0; i < 2; ++i)
+				{
+					ID3D12Resource* res = nullptr;
+					CHECKED(swapChain->GetBuffer(i, IID_PPV_ARGS(&res)));
+					uint32_t handle = InternalCreateTexture(res, BINDING_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+						/*i == backBufferIndex ? D3D12_RESOURCE_STATE_PRESENT :
+						D3D12_RESOURCE_STATE_RENDER_TARGET);*/
+					assert(handle == i);
+				}
+
+				{
+					ID3D12Resource* res = nullptr;
+
+					D3D12_HEAP_PROPERTIES prop = {};
+					prop.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+					D3D12_RESOURCE_DESC desc = {};
+					desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+					desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+					desc.Width = width;
+					desc.Height = height;
+					desc.DepthOrArraySize = 1;
+					desc.MipLevels = 1;
+					desc.SampleDesc.Count = 1;
+					desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+					D3D12_CLEAR_VALUE clearValue[1];
+					clearValue[0].Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+					clearValue[0].DepthStencil.Depth = 1.0f;
+					clearValue[0].DepthStencil.Stencil = 0;
+
+					CHECKED(device->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_DEPTH_WRITE, clearValue, IID_PPV_ARGS(&res)));
+					uint32_t handle = InternalCreateTexture(res, BINDING_DEPTH_STENCIL, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+					assert(handle == 2);
+				}
+
+				return 0;
+			}
+
+			void InitPipelineStates()
+			{
+				currentBindingLayout.id = invalid_handle;
+				currentPipelineState.id = invalid_handle;
+
+				stateCache.Invalidate();
+				memset(&stateCache.stats, 0, sizeof(stateCache.stats));
+			}
+
+
+			inline void TransistResource(ID3D12Resource* res, D3D12_RESOURCE_STATES& current, D3D12_RESOURCE_STATES dest)
+			{
+				if (dest != current)
+				{
+					cmdList->ResourceBarrier(
+						1,
+						&CD3DX12_RESOURCE_BARRIER::Transition(
+							res,
+							current,
+							dest
+						)
+					);
+					current = dest;
+				}
+			}
+
+			// only looks at the resource record when a barrier is needed. The state
+			// wanted is mostly a constant, so its index folds away
+			inline void TransistBuffer(uint32_t index, D3D12_RESOURCE_STATES dest)
+			{
+				BufferDX12& buf = buffers[index];
+				uint16_t destIndex = BufferStateIndex(dest);
+				if (destIndex != buf.state)
+				{
+					D3D12_RESOURCE_STATES state = BufferStateTable[buf.state];
+					TransistResource(bufferResources[index].buffer, state, dest);
+					buf.state = destIndex;
+				}
+			}
+
+			inline void TransistTexture(uint32_t index, D3D12_RESOURCE_STATES dest)
+			{
+				TransistResource(textures[index].texture, textureStates[index], dest);
+			}
+
+			inline void SetRootDescriptor(uint32_t slot, D3D12_GPU_VIRTUAL_ADDRESS address, bool isSRV)
+			{
+				if (!stateCache.Update(STATE_ROOT_DESCRIPTORS,
+					!stateCache.rootArgumentValid[slot] || address != stateCache.rootDescriptors[slot]))
+					return;
+
+				if (isSRV)
+					cmdList->SetGraphicsRootShaderResourceView(slot, address);
+				else
+					cmdList->SetGraphicsRootConstantBufferView(slot, address);
+
+				stateCache.rootDescriptors[slot] = address;
+				stateCache.rootArgumentValid[slot] = true;
+			}
+
+			inline void SetRootDescriptorTable(uint32_t slot, D3D12_GPU_DESCRIPTOR_HANDLE table)
+			{
+				// tables are told apart by where they are in the heaps
+				if (!stateCache.Update(STATE_DESCRIPTOR_TABLES,
+					!stateCache.rootArgumentValid[slot] || table.ptr != stateCache.rootDescriptors[slot]))
+					return;
+
+				cmdList->SetGraphicsRootDescriptorTable(slot, table);
+
+				stateCache.rootDescriptors[slot] = table.ptr;
+				stateCache.rootArgumentValid[slot] = true;
+			}
+
+			inline void ApplyResourceUses(const ResourceUseDX12* uses, uint32_t count)
+			{
+				for (uint32_t k = 0; k < count; k++)
+				{
+					if (uses[k].isTexture)
+						TransistTexture(uses[k].index, uses[k].state);
+					else
+						TransistBuffer(uses[k].index, uses[k].state);
+				}
+			}
+
+			inline void SetRootArgument(const RootArgumentDX12& arg)
+			{
+				switch (arg.type)
+				{
+				case ROOT_ARGUMENT_CBV:
+					SetRootDescriptor(arg.slot, arg.value, false);
+					break;
+				case ROOT_ARGUMENT_SRV:
+					SetRootDescriptor(arg.slot, arg.value, true);
+					break;
+				case ROOT_ARGUMENT_VIEW_TABLE:
+				case ROOT_ARGUMENT_SAMPLER_TABLE:
+					SetRootDescriptorTable(arg.slot, D3D12_GPU_DESCRIPTOR_HANDLE{ arg.value });
+					break;
+				default:
+					break;
+				}
+			}
+
+			// the root argument of the CBV, SRV or table entry i of a layout, from binding
+			// data laid out for it. The buffers and textures it reads are added to uses,
+			// a table is placed in the descriptor cache. For a binding group, the handles
+			// are checked and the table is pinned in the cache, the handles of a draw are
+			// left to the validation layer.
+			bool ResolveRootArgument(const BindingLayoutDX12& layout, size_t i, const uint8_t* pData, bool group, RootArgumentDX12& arg, ResourceUseDX12* uses, uint32_t& useCount)
+			{
+				auto& entry = layout.layout.table[i];
+
+				arg.slot = layout.slotId[i];
+				arg.type = ROOT_ARGUMENT_NONE;
+				arg.tableOffset = 0;
+				arg.value = 0;
+
+				D3D12_RESOURCE_STATES srvState = entry.ShaderVisibility == SHADER_VISIBILITY_PIXEL ?
+					D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE :
+					D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+				switch (entry.Type)
+				{
+				case BINDING_SLOT_TYPE_CBV:
+					(void*)0;
+					{
+						uint32_t handle = *reinterpret_cast<const uint32_t*>((pData + layout.offsets[i]));
+
+						if (invalid_handle != handle)
+						{
+							if (group && !bufHandleAlloc.InUse(handle))
+								return false;
+							uint32_t index = bufHandleAlloc.GetIndex(handle);
+							BufferDX12& buf = buffers[index];
+							if (group && (buf.bindFlags & BINDING_CONSTANT_BUFFER) == 0)
+								return false;
+
+							uses[useCount++] = { index, 0, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER };
+							arg.type = ROOT_ARGUMENT_CBV;
+							arg.value = buf.gpuAddress;
+						}
+					}
+					break;
+				case BINDING_SLOT_TYPE_SRV:
+					(void*)0;
+					{
+						uint32_t data = *reinterpret_cast<const uint32_t*>((pData + layout.offsets[i]));
+						bool isBuffer = invalid_handle != data && (data & binding_buffer_flag) != 0u;
+						uint32_t handle = isBuffer ? (data & ~binding_buffer_flag) : data;
+
+						if (invalid_handle != handle)
+						{
+							// textures can only go in tables
+							if (group && (!isBuffer || !bufHandleAlloc.InUse(handle)))
+								return false;
+							uint32_t index = bufHandleAlloc.GetIndex(handle);
+							BufferDX12& buf = buffers[index];
+							if (group && (buf.bindFlags & BINDING_SHADER_RESOURCE) == 0)
+								return false;
+
+							uses[useCount++] = { index, 0, srvState };
+							arg.type = ROOT_ARGUMENT_SRV;
+							arg.value = buf.gpuAddress;
+						}
+					}
+					break;
+				case BINDING_SLOT_TYPE_TABLE:
+					(void*)0;
+					{
+						bool isSamplerTable = false;
+						bool isCBVSRVTable = false;
+
+						// the descriptors are only written if the cache doesn't have the table
+						uint64_t keys[MaxBindingDataSize];
+						uint32_t handleIdx = 0;
+						for (uint32_t iRange = 0; iRange < entry.Count; iRange++)
+						{
+							auto& subEntry = layout.layout.table[i + iRange + 1];
+
+							if (subEntry.Type == BINDING_SLOT_TYPE_SAMPLER)
+								isSamplerTable = true;
+							else
+								isCBVSRVTable = true;
+
+							for (uint32_t iRangeEntry = 0; iRangeEntry < subEntry.Count; iRangeEntry++)
+							{
+								uint32_t offset = layout.offsets[i + iRange + 1] + 4u * iRangeEntry;
+								uint32_t data = *reinterpret_cast<const uint32_t*>((pData + offset));
+								bool isBuffer = invalid_handle != data && (data & binding_buffer_flag) != 0u;
+								uint32_t handle = isBuffer ? (data & ~binding_buffer_flag) : data;
+
+								if (subEntry.Type == BINDING_SLOT_TYPE_SAMPLER)
+								{
+									if (group && invalid_handle != data && !sampHandleAlloc.InUse(data))
+										return false;
+
+									keys[handleIdx++] = DescriptorKey(DESCRIPTOR_SAMPLER, data);
+								}
+								else if (subEntry.Type == BINDING_SLOT_TYPE_CBV)
+								{
+									if (invalid_handle != handle)
+									{
+										if (group && !bufHandleAlloc.InUse(handle))
+											return false;
+										uint32_t index = bufHandleAlloc.GetIndex(handle);
+										if (group && (buffers[index].bindFlags & BINDING_CONSTANT_BUFFER) == 0)
+											return false;
+
+										uses[useCount++] = { index, 0, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER };
+									}
+
+									keys[handleIdx++] = DescriptorKey(DESCRIPTOR_CBV, handle);
+								}
+								else if (subEntry.Type == BINDING_SLOT_TYPE_SRV)
+								{
+									if (isBuffer)
+									{
+										if (group && !bufHandleAlloc.InUse(handle))
+											return false;
+										uint32_t index = bufHandleAlloc.GetIndex(handle);
+										if (group && (buffers[index].bindFlags & BINDING_SHADER_RESOURCE) == 0)
+											return false;
+
+										uses[useCount++] = { index, 0, srvState };
+										keys[handleIdx++] = DescriptorKey(DESCRIPTOR_SRV_BUFFER, handle);
+									}
+									else
+									{
+										if (invalid_handle != handle)
+										{
+											if (group && !texHandleAlloc.InUse(handle))
+												return false;
+
+											uses[useCount++] = { texHandleAlloc.GetIndex(handle), 1, srvState };
+										}
+
+										keys[handleIdx++] = DescriptorKey(DESCRIPTOR_SRV_TEXTURE, handle);
+									}
+								}
+								else
+								{
+									return false;
+								}
+							} // for loop - iRangeEntry
+
+						} // for loop - iRange
+
+						// a table is either samplers or views, as the heaps are
+						if (group && isSamplerTable == isCBVSRVTable)
+							return false;
+
+						bool created = false;
+						uint32_t tableOffset;
+						ID3D12DescriptorHeap* heap;
+						UINT heapInc;
+
+						if (isSamplerTable)
+						{
+							tableOffset = sampCache.Acquire(keys, handleIdx, created);
+							if (sampCache.invalid_offset == tableOffset)
+								return false;
+							if (group)
+								sampCache.Pin(tableOffset);
+
+							heap = sampHeap;
+							heapInc = sampHeapInc;
+							arg.type = ROOT_ARGUMENT_SAMPLER_TABLE;
+						}
+						else
+						{
+							tableOffset = srvCache.Acquire(keys, handleIdx, created);
+							if (srvCache.invalid_offset == tableOffset)
+								return false;
+							if (group)
+								srvCache.Pin(tableOffset);
+
+							heap = srvHeap;
+							heapInc = srvHeapInc;
+							arg.type = ROOT_ARGUMENT_VIEW_TABLE;
+						}
+
+						if (created)
+						{
+							CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle(heap->GetCPUDescriptorHandleForHeapStart(), tableOffset, heapInc);
+							for (uint32_t k = 0; k < handleIdx; k++, cpuHandle.Offset(1, heapInc))
+								WriteDescriptor(keys[k], cpuHandle);
+						}
+
+						CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(heap->GetGPUDescriptorHandleForHeapStart(), tableOffset, heapInc);
+						arg.tableOffset = tableOffset;
+						arg.value = gpuHandle.ptr;
+					}
+					break;
+				default:
+					break;
+				}
+
+				return true;
+			}
+
+			// writes a descriptor of a table the cache has just placed, the
+			// resource was checked when the key was made
+			void WriteDescriptor(uint64_t key, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle)
+			{
+				uint32_t handle = static_cast<uint32_t>(key);
+
+				switch (static_cast<DescriptorKind>(key >> 32))
+				{
+				case DESCRIPTOR_SAMPLER:
+					if (invalid_handle != handle)
+					{
+						device->CreateSampler(&(samplers[sampHandleAlloc.GetIndex(handle)].desc), cpuHandle);
+					}
+					else
+					{
+						D3D12_SAMPLER_DESC desc = {};
+
+						desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+						desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+						desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+						desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+						desc.MaxLOD = D3D12_FLOAT32_MAX;
+						desc.MaxAnisotropy = 1;
+
+						device->CreateSampler(&desc, cpuHandle);
+					}
+					break;
+				case DESCRIPTOR_CBV:
+					if (invalid_handle != handle)
+					{
+						BufferDX12& buf = buffers[bufHandleAlloc.GetIndex(handle)];
+
+						D3D12_CONSTANT_BUFFER_VIEW_DESC desc = {};
+						desc.BufferLocation = buf.gpuAddress;
+						desc.SizeInBytes = static_cast<UINT>(buf.size);
+
+						device->CreateConstantBufferView(&desc, cpuHandle);
+					}
+					else
+					{
+						device->CreateConstantBufferView(nullptr, cpuHandle);
+					}
+					break;
+				case DESCRIPTOR_SRV_BUFFER:
+					if (invalid_handle != handle)
+					{
+						uint32_t index = bufHandleAlloc.GetIndex(handle);
+						BufferDX12& buf = buffers[index];
+
+						D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+
+						desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+						desc.Format = PixelFormatTable[buf.format];
+						desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+						desc.Buffer.FirstElement = 0;
+						desc.Buffer.NumElements = buf.size / buf.stride;
+						desc.Buffer.StructureByteStride = buf.stride;
+						desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+						device->CreateShaderResourceView(bufferResources[index].buffer, &desc, cpuHandle);
+					}
+					else
+					{
+						D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+						desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+						device->CreateShaderResourceView(nullptr, &desc, cpuHandle);
+					}
+					break;
+				case DESCRIPTOR_SRV_TEXTURE:
+					if (invalid_handle != handle)
+					{
+						uint32_t index = texHandleAlloc.GetIndex(handle);
+						TextureDX12& tex = textures[index];
+
+						if (textureDescs[index].isCubeMap)
+						{
+							auto desc = tex.texture->GetDesc();
+							D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+							srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+							srvDesc.Format = desc.Format;
+							srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+							srvDesc.TextureCube.MipLevels = desc.MipLevels;
+							srvDesc.TextureCube.MostDetailedMip = desc.MipLevels - 1;
+
+							device->CreateShaderResourceView(tex.texture, &srvDesc, cpuHandle);
+						}
+						else
+						{
+							device->CreateShaderResourceView(tex.texture, nullptr, cpuHandle);
+						}
+					}
+					else
+					{
+						D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+						desc.ViewDimension = D3D12_SRV_DIMENSION_UNKNOWN;
+						device->CreateShaderResourceView(nullptr, &desc, cpuHandle);
+					}
+					break;
+				}
+			}
+
+			void SetRenderTargets(uint32_t count, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+			{
+				bool changed = !stateCache.hasRenderTargets ||
+					count != stateCache.renderTargetCount ||
+					(nullptr != dsv ? dsv->ptr : 0) != stateCache.depthStencil.ptr;
+				for (uint32_t i = 0; i < count && !changed; ++i)
+					changed = rtvs[i].ptr != stateCache.renderTargets[i].ptr;
+
+				if (!stateCache.Update(STATE_RENDER_TARGETS, changed))
+					return;
+
+				cmdList->OMSetRenderTargets(count, rtvs, FALSE, dsv);
+
+				for (uint32_t i = 0; i < count; ++i)
+					stateCache.renderTargets[i] = rtvs[i];
+				stateCache.renderTargetCount = count;
+				stateCache.depthStencil.ptr = (nullptr != dsv ? dsv->ptr : 0);
+				stateCache.hasRenderTargets = true;
+			}
+
+			void SetPipelineState(PipelineStateDX12& state)
+			{
+				cmdList->SetPipelineState(state.state);
+
+				if (state.bindingLayout.id != currentBindingLayout.id)
+				{
+					assert(blHandleAlloc.InUse(state.bindingLayout.id));
+
+					BindingLayoutDX12& layout = bindingLayouts[blHandleAlloc.GetIndex(state.bindingLayout.id)];
+					cmdList->SetGraphicsRootSignature(layout.rootSig);
+					currentBindingLayout = state.bindingLayout;
+					stateCache.InvalidateRootArguments();
+				}
+
+				cmdList->IASetPrimitiveTopology(state.topology);
+			}
+
+			// sets the pipeline state if it isn't the current one, returns its binding layout
+			uint32_t BindPipelineState(PipelineStateHandle stateHandle)
+			{
+				if (stateHandle.id != currentPipelineState.id)
+				{
+					assert(psoHandleAlloc.InUse(stateHandle.id));
+
+					PipelineStateDX12& state = pipelineStates[psoHandleAlloc.GetIndex(stateHandle.id)];
+
+					// the draws with it are skipped until its compile is done
+					if (nullptr == state.state && !InternalResolvePipelineState(state))
+						return invalid_handle;
+
+					SetPipelineState(state);
+
+					currentPipelineState = stateHandle;
+				}
+
+				return currentBindingLayout.id;
+			}
+
+			inline void PrefetchDraw(const DrawCall& drawcall) const
+			{
+				for (uint32_t i = 0; i < drawcall.VertexBufferCount; ++i)
+					buffers.Prefetch(bufHandleAlloc.GetIndex(drawcall.VertexBuffers[i].id));
+				if (drawcall.HasIndexBuffer)
+					buffers.Prefetch(bufHandleAlloc.GetIndex(drawcall.IndexBuffer.id));
+				if (drawcall.HasBindingGroup)
+					bindingGroups.Prefetch(bgHandleAlloc.GetIndex(drawcall.BindingGroup.id));
+			}
+
+			inline void IssueDraw(const DrawCall& drawcall)
+			{
+				UINT instanceCount = drawcall.InstanceCount > 0 ? drawcall.InstanceCount : 1;
+				if (drawcall.HasIndexBuffer)
+				{
+					cmdList->DrawIndexedInstanced(drawcall.ElementCount, instanceCount, drawcall.StartIndex, drawcall.BaseVertex, drawcall.FirstInstance);
+				}
+				else
+				{
+					cmdList->DrawInstanced(drawcall.ElementCount, instanceCount, static_cast<UINT>(drawcall.BaseVertex), drawcall.FirstInstance);
+				}
+			}
+
+			// layoutHandle is the one BindPipelineState gave for the draw. The handles and
+			// binding data are not checked, only asserted, it is the validation layer that
+			// catches the mistakes (see GraphicsAPIValidation.h). It fails if there is no
+			// room left for a descriptor table.
+			bool BindResources(uint32_t layoutHandle, const DrawCall& drawcall)
+			{
+				// Input Assembly
+				if (drawcall.VertexBufferCount > 0)
+				{
+					D3D12_VERTEX_BUFFER_VIEW vbvs[MaxVertexBufferBindingSlot];
+
+					for (size_t i = 0; i < drawcall.VertexBufferCount; ++i)
+					{
+						uint32_t handle = drawcall.VertexBuffers[i].id;
+						assert(bufHandleAlloc.InUse(handle));
+						uint32_t index = bufHandleAlloc.GetIndex(handle);
+						auto& buf = buffers[index];
+						uint32_t offset = drawcall.VertexBufferOffsets[i];
+						assert((buf.bindFlags & BINDING_VERTEX_BUFFER) != 0 && offset <= buf.size);
+
+						TransistBuffer(index, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+						vbvs[i].BufferLocation = buf.gpuAddress + offset;
+						vbvs[i].SizeInBytes = buf.size - offset;
+						vbvs[i].StrideInBytes = buf.stride;
+					}
+
+					// only the range of slots that differ
+					uint32_t first = 0, last = drawcall.VertexBufferCount;
+					while (first < last && first < stateCache.vertexBufferCount &&
+						0 == memcmp(&vbvs[first], &stateCache.vertexBuffers[first], sizeof(D3D12_VERTEX_BUFFER_VIEW)))
+						first++;
+					while (last > first && last <= stateCache.vertexBufferCount &&
+						0 == memcmp(&vbvs[last - 1], &stateCache.vertexBuffers[last - 1], sizeof(D3D12_VERTEX_BUFFER_VIEW)))
+						last--;
+
+					if (stateCache.Update(STATE_VERTEX_BUFFERS, first < last))
+					{
+						cmdList->IASetVertexBuffers(first, last - first, vbvs + first);
+						memcpy(stateCache.vertexBuffers + first, vbvs + first, sizeof(D3D12_VERTEX_BUFFER_VIEW) * (last - first));
+						if (stateCache.vertexBufferCount < last)
+							stateCache.vertexBufferCount = last;
+					}
+				}
+
+				if (drawcall.HasIndexBuffer)
+				{
+					uint32_t handle = drawcall.IndexBuffer.id;
+					assert(bufHandleAlloc.InUse(handle));
+					uint32_t index = bufHandleAlloc.GetIndex(handle);
+					auto& buf = buffers[index];
+					assert((buf.bindFlags & BINDING_INDEX_BUFFER) != 0 && drawcall.IndexBufferOffset <= buf.size);
+
+					TransistBuffer(index, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+					D3D12_INDEX_BUFFER_VIEW ibv = {};
+					ibv.BufferLocation = buf.gpuAddress + drawcall.IndexBufferOffset;
+					ibv.SizeInBytes = buf.size - drawcall.IndexBufferOffset;
+					ibv.Format = (buf.stride == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT);
+
+					if (stateCache.Update(STATE_INDEX_BUFFER,
+						!stateCache.hasIndexBuffer || 0 != memcmp(&ibv, &stateCache.indexBuffer, sizeof(ibv))))
+					{
+						cmdList->IASetIndexBuffer(&ibv);
+						stateCache.indexBuffer = ibv;
+						stateCache.hasIndexBuffer = true;
+					}
+				}
+				/////
+
+				// Rasterizer
+				{
+					D3D12_VIEWPORT vp =
+					{
+						drawcall.Viewport.X,
+						drawcall.Viewport.Y,
+						drawcall.Viewport.Width,
+						drawcall.Viewport.Height,
+						drawcall.Viewport.ZMin,
+						drawcall.Viewport.ZMax
+					};
+
+					if (stateCache.Update(STATE_VIEWPORT,
+						!stateCache.hasViewport || 0 != memcmp(&vp, &stateCache.viewport, sizeof(vp))))
+					{
+						cmdList->RSSetViewports(1, &vp);
+						stateCache.viewport = vp;
+						stateCache.hasViewport = true;
+					}
+
+					D3D12_RECT rect = { 0, 0, width, height };
+					if (stateCache.Update(STATE_SCISSOR_RECT,
+						!stateCache.hasScissorRect || 0 != memcmp(&rect, &stateCache.scissorRect, sizeof(rect))))
+					{
+						cmdList->RSSetScissorRects(1, &rect);
+						stateCache.scissorRect = rect;
+						stateCache.hasScissorRect = true;
+					}
+				}
+
+				{
+					uint32_t handle = layoutHandle;
+					BindingLayoutDX12& layout = bindingLayouts[blHandleAlloc.GetIndex(handle)];
+					const uint8_t* pData = reinterpret_cast<const uint8_t*>(drawcall.ResourceBindingData);
+
+					ResourceUseDX12 uses[MaxBindingDataSize];
+
+					for (size_t i = 0; i < layout.entryCount; i++)
+					{
+						auto& entry = layout.layout.table[i];
+						switch (entry.Type)
+						{
+						case BINDING_SLOT_TYPE_CONSTANT:
+							(void*)0;
+							{
+								uint32_t slot = layout.slotId[i];
+								uint32_t* cached = stateCache.rootConstants + layout.offsets[i] / 4u;
+								if (stateCache.Update(STATE_ROOT_CONSTANTS,
+									!stateCache.rootArgumentValid[slot] || 0 != memcmp(cached, pData + layout.offsets[i], entry.Count * 4u)))
+								{
+									cmdList->SetGraphicsRoot32BitConstants(slot, entry.Count, pData + layout.offsets[i], 0);
+									memcpy(cached, pData + layout.offsets[i], entry.Count * 4u);
+									stateCache.rootArgumentValid[slot] = true;
+								}
+							}
+							break;
+						case BINDING_SLOT_TYPE_CBV:
+						case BINDING_SLOT_TYPE_SRV:
+						case BINDING_SLOT_TYPE_TABLE:
+							// taken from the group below
+							if (!drawcall.HasBindingGroup)
+							{
+								RootArgumentDX12 arg;
+								uint32_t useCount = 0;
+								if (!ResolveRootArgument(layout, i, pData, false, arg, uses, useCount))
+									return false;
+
+								ApplyResourceUses(uses, useCount);
+								SetRootArgument(arg);
+							}
+
+							if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+								i += entry.Count;
+							break;
+						default:
+							break;
+						}
+					}
+
+					if (drawcall.HasBindingGroup)
+					{
+						uint32_t groupHandle = drawcall.BindingGroup.id;
+						assert(bgHandleAlloc.InUse(groupHandle));
+
+						BindingGroupDX12& group = bindingGroups[bgHandleAlloc.GetIndex(groupHandle)];
+						assert(group.layout.id == handle);
+
+						ApplyResourceUses(group.uses, group.useCount);
+						for (uint32_t k = 0; k < group.argumentCount; k++)
+							SetRootArgument(group.arguments[k]);
+					}
+				}
+				//cmdList->SetDescriptorHeaps
+				// Render Target
+				if (drawcall.RenderTargetCount > 0 || drawcall.HasDepthStencil)
+				{
+					D3D12_CPU_DESCRIPTOR_HANDLE rtvs[MaxRenderTargetBindingSlot];
+					D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+
+					for (size_t i = 0; i < drawcall.RenderTargetCount; ++i)
+					{
+						uint32_t handle = drawcall.RenderTargets[i].id;
+						assert(texHandleAlloc.InUse(handle));
+						uint32_t index = texHandleAlloc.GetIndex(handle);
+						auto& tex = textures[index];
+						assert(rtvHeapAlloc.InUse(tex.rtv));
+
+						TransistTexture(index, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+						rtvs[i] = CD3DX12_CPU_DESCRIPTOR_HANDLE(rtvHeap->GetCPUDescriptorHandleForHeapStart(), rtvHeapAlloc.GetIndex(tex.rtv), rtvHeapInc);
+					}
+
+					if (drawcall.HasDepthStencil)
+					{
+						uint32_t handle = drawcall.DepthStencil.id;
+						assert(texHandleAlloc.InUse(handle));
+						uint32_t index = texHandleAlloc.GetIndex(handle);
+						auto& tex = textures[index];
+						assert(dsvHeapAlloc.InUse(tex.dsv));
+
+						TransistTexture(index, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+						dsv = CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvHeap->GetCPUDescriptorHandleForHeapStart(), dsvHeapAlloc.GetIndex(tex.dsv), dsvHeapInc);
+					}
+
+					SetRenderTargets(drawcall.RenderTargetCount, rtvs, drawcall.HasDepthStencil ? &dsv : nullptr);
+				}
+				else
+				{
+					TransistTexture(backBufferIndex, D3D12_RESOURCE_STATE_RENDER_TARGET);
+					TransistTexture(2, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+					D3D12_CPU_DESCRIPTOR_HANDLE rtv = CD3DX12_CPU_DESCRIPTOR_HANDLE(rtvHeap->GetCPUDescriptorHandleForHeapStart(), rtvHeapAlloc.GetIndex(textures[backBufferIndex].rtv), rtvHeapInc);
+					D3D12_CPU_DESCRIPTOR_HANDLE dsv = CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvHeap->GetCPUDescriptorHandleForHeapStart(), dsvHeapAlloc.GetIndex(textures[2].dsv), dsvHeapInc);
+
+					SetRenderTargets(1, &rtv, &dsv);
+				}
+
+				return true;
+			}
+
+#pragma region resource creation
+
+			void InternalResetBindingLayout(BindingLayoutDX12& layout)
+			{
+				RELEASE(layout.rootSig);
+				layout.entryCount = 0;
+				layout.layout = {};
+			}
+
+			uint32_t InternalCreateBindingLayout(const BindingLayout& layoutDesc)
+			{
+				uint32_t handle = blHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return invalid_handle;
+
+				BindingLayoutDX12& layout = bindingLayouts.Acquire(blHandleAlloc.GetIndex(handle));
+
+				CD3DX12_DESCRIPTOR_RANGE ranges[MaxBindingLayoutEntry];
+				CD3DX12_ROOT_PARAMETER params[MaxBindingLayoutEntry];
+				uint32_t rangeIdx = 0;
+				uint32_t paramIdx = 0;
+
+				{
+					uint32_t offset = 0, i = 0;
+
+					for (; i < MaxBindingLayoutEntry; ++i)
+					{
+						auto& entry = layoutDesc.table[i];
+						if (entry.Type == BINDING_SLOT_TYPE_NONE)
+						{
+							layout.entryCount = i;
+							break;
+						}
+
+						layout.offsets[i] = offset;
+						layout.slotId[i] = paramIdx;
+
+						uint32_t count = (
+							entry.Type == BINDING_SLOT_TYPE_TABLE ?
+							0 : (entry.Count == 0 ? 1 : entry.Count));
+						uint32_t size = 4 * count;
+						offset += size;
+
+						auto& par = params[paramIdx];
+
+						if (entry.Type == BINDING_SLOT_TYPE_CONSTANT)
+						{
+							par.InitAsConstants(
+								entry.Count,
+								entry.Register,
+								entry.Space,
+								ShaderVisibilityTable[entry.ShaderVisibility]
+							);
+						}
+						else if (entry.Type == BINDING_SLOT_TYPE_CBV)
+						{
+							par.InitAsConstantBufferView(
+								entry.Register,
+								entry.Space,
+								ShaderVisibilityTable[entry.ShaderVisibility]
+							);
+						}
+						else if (entry.Type == BINDING_SLOT_TYPE_SRV)
+						{
+							par.InitAsShaderResourceView(
+								entry.Register,
+								entry.Space,
+								ShaderVisibilityTable[entry.ShaderVisibility]
+							);
+						}
+						else if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+						{
+							for (uint32_t j = 0; j < entry.Count; j++)
+							{
+								auto& range = ranges[rangeIdx + j];
+								auto& subEntry = layoutDesc.table[i + j + 1];
+
+								layout.offsets[i + j + 1] = offset;
+								offset += subEntry.Count * 4u;
+								//layout.slotId[i + j + 1] = paramIdx;
+
+								if (subEntry.Type == BINDING_SLOT_TYPE_CBV)
+								{
+									range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
+										subEntry.Count,
+										subEntry.Register,
+										subEntry.Space);
+								}
+								else if (subEntry.Type == BINDING_SLOT_TYPE_SRV)
+								{
+									range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+										subEntry.Count,
+										subEntry.Register,
+										subEntry.Space);
+								}
+								else if (subEntry.Type == BINDING_SLOT_TYPE_SAMPLER)
+								{
+									range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER,
+										subEntry.Count,
+										subEntry.Register,
+										subEntry.Space);
+								}
+								else
+								{
+									InternalResetBindingLayout(layout);
+									blHandleAlloc.Free(handle);
+									return invalid_handle;
+								}
+							}
+
+							par.InitAsDescriptorTable(
+								entry.Count,
+								&ranges[rangeIdx],
+								ShaderVisibilityTable[entry.ShaderVisibility]
+							);
+
+							rangeIdx += entry.Count;
+							i += entry.Count;
+						}
+
+						paramIdx++;
+					}
+
+					if (i == MaxBindingLayoutEntry)
+					{
+						layout.entryCount = MaxBindingLayoutEntry;
+					}
+				}
+
+
+				CD3DX12_ROOT_SIGNATURE_DESC desc;
+				desc.Init(paramIdx, params, 0U, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+				ID3DBlob* blob = nullptr;
+				if (FAILED(D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, &blob, nullptr)) ||
+					FAILED(device->CreateRootSignature(0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&layout.rootSig))))
+				{
+					InternalResetBindingLayout(layout);
+					blHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+				layout.layout = layoutDesc;
+
+				return handle;
+			}
+
+			void InternalDestroyBindingLayout(uint32_t handle)
+			{
+				if (!blHandleAlloc.InUse(handle))
+					return;
+
+				blHandleAlloc.Retire(handle);
+				releaseQueue.Push(frameIndex, DeferredReleaseDX12{ DEFERRED_BINDING_LAYOUT, blHandleAlloc.GetIndex(handle) });
+			}
+
+			void InternalResetBindingGroup(BindingGroupDX12& group)
+			{
+				for (uint32_t k = 0; k < group.argumentCount; k++)
+				{
+					RootArgumentDX12& arg = group.arguments[k];
+					if (ROOT_ARGUMENT_VIEW_TABLE == arg.type)
+						srvCache.Unpin(arg.tableOffset);
+					else if (ROOT_ARGUMENT_SAMPLER_TABLE == arg.type)
+						sampCache.Unpin(arg.tableOffset);
+				}
+
+				group.layout.id = invalid_handle;
+				group.argumentCount = 0;
+				group.useCount = 0;
+			}
+
+			uint32_t InternalCreateBindingGroup(uint32_t layoutHandle, const uint32_t* bindingData)
+			{
+				if (!blHandleAlloc.InUse(layoutHandle) || nullptr == bindingData)
+					return invalid_handle;
+
+				uint32_t handle = bgHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return handle;
+
+				BindingGroupDX12& group = bindingGroups.Acquire(bgHandleAlloc.GetIndex(handle));
+				group.layout.id = layoutHandle;
+				group.argumentCount = 0;
+				group.useCount = 0;
+
+				const BindingLayoutDX12& layout = bindingLayouts[blHandleAlloc.GetIndex(layoutHandle)];
+				const uint8_t* pData = reinterpret_cast<const uint8_t*>(bindingData);
+
+				for (size_t i = 0; i < layout.entryCount; i++)
+				{
+					auto& entry = layout.layout.table[i];
+					if (entry.Type != BINDING_SLOT_TYPE_CBV &&
+						entry.Type != BINDING_SLOT_TYPE_SRV &&
+						entry.Type != BINDING_SLOT_TYPE_TABLE)
+						continue;
+
+					RootArgumentDX12 arg;
+					if (group.argumentCount >= MaxRootArgumentCount ||
+						!ResolveRootArgument(layout, i, pData, true, arg, group.uses, group.useCount))
+					{
+						InternalResetBindingGroup(group);
+						bgHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+
+					if (ROOT_ARGUMENT_NONE != arg.type)
+						group.arguments[group.argumentCount++] = arg;
+
+					if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+						i += entry.Count;
+				}
+
+				return handle;
+			}
+
+			void InternalDestroyBindingGroup(uint32_t handle)
+			{
+				if (!bgHandleAlloc.InUse(handle))
+					return;
+
+				InternalResetBindingGroup(bindingGroups[bgHandleAlloc.GetIndex(handle)]);
+				bgHandleAlloc.Free(handle);
+			}
+
+			void InternalResetPipelineState(PipelineStateDX12& state)
+			{
+				// the last handle of a description takes the shared object along
+				if (PipelineCache<PipelineCompileDX12>::invalid_entry != state.shared && pipelineCache.Release(state.shared))
+					pipelineCache.Free(state.shared);
+
+				state.state = nullptr;
+				state.shared = PipelineCache<PipelineCompileDX12>::invalid_entry;
+				state.bindingLayout.id = invalid_handle;
+			}
+
+			uint32_t InternalCreatePipelineState(const PipelineState& stateDesc)
+			{
+				if (!blHandleAlloc.InUse(stateDesc.BindingLayout.id))
+					return invalid_handle;
+
+				uint32_t handle = psoHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return invalid_handle;
+
+				PipelineStateDX12& state = pipelineStates.Acquire(psoHandleAlloc.GetIndex(handle));
+				state.state = nullptr;
+				state.bindingLayout = stateDesc.BindingLayout;
+				state.topology = TopologyTable[stateDesc.PrimitiveType];
+
+				uint32_t vsHandle = stateDesc.VertexShader.id;
+				uint32_t psHandle = stateDesc.PixelShader.id;
+				uint64_t vsHash = vsHandleAlloc.InUse(vsHandle) ? vertexShaders[vsHandleAlloc.GetIndex(vsHandle)].hash : 0;
+				uint64_t psHash = psHandleAlloc.InUse(psHandle) ? pixelShaders[psHandleAlloc.GetIndex(psHandle)].hash : 0;
+
+				bool created = false;
+				state.shared = pipelineCache.Acquire(stateDesc, vsHash, psHash, created);
+				if (PipelineCache<PipelineCompileDX12>::invalid_entry == state.shared)
+				{
+					InternalResetPipelineState(state);
+					psoHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+				// otherwise an identical description is compiled, or compiling, already
+				if (created)
+				{
+					InternalPreparePipelineCompile(stateDesc, pipelineCache.GetJob(state.shared));
+					pipelineCache.Compile(state.shared);
+				}
+
+				return handle;
+			}
+
+			void InternalPreparePipelineCompile(const PipelineState& stateDesc, PipelineCompileDX12& job)
+			{
+				D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = job.desc;
+				desc = {};
+
+				job.device = device;
+				job.state = nullptr;
+
+				// held by the job, the binding layout may go before the compile is done
+				desc.pRootSignature = bindingLayouts[blHandleAlloc.GetIndex(stateDesc.BindingLayout.id)].rootSig;
+				desc.pRootSignature->AddRef();
+
+				uint32_t vsHandle = stateDesc.VertexShader.id;
+				if (vsHandleAlloc.InUse(vsHandle))
+				{
+					ShaderDX12& vs = vertexShaders[vsHandleAlloc.GetIndex(vsHandle)];
+					job.vs.assign(vs.data, vs.data + vs.size);
+					desc.VS = CD3DX12_SHADER_BYTECODE(
+						job.vs.data(),
+						job.vs.size()
+					);
+
+					uint16_t elementCount = stateDesc.VertexLayout.ElementCount;
+
+					UINT offset = 0;
+					UINT lastSlot = 0;
+
+					for (size_t i = 0; i < elementCount; ++i)
+					{
+						const VertexInputElement& elem = stateDesc.VertexLayout.Elements[i];
+						D3D12_INPUT_ELEMENT_DESC& desc = job.elements[i];
+
+						size_t size = InputSlotSizeTable[elem.ComponentType] * (elem.ComponentCount + 1);
+
+						if (elem.BindingSlot != lastSlot)
+							offset = 0;
+
+						desc.AlignedByteOffset = offset;
+						desc.Format = InputSlotTypeTable[elem.ComponentType][elem.ComponentCount];
+						desc.InputSlot = elem.BindingSlot;
+						desc.InputSlotClass = elem.InstanceStepRate > 0 ?
+							D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA :
+							D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+						desc.InstanceDataStepRate = elem.InstanceStepRate;
+						desc.SemanticIndex = InputSemanticsIndex[elem.SemanticId];
+						desc.SemanticName = InputSemanticsTable[elem.SemanticId];
+
+						offset += static_cast<UINT>(size);
+						lastSlot = elem.BindingSlot;
+					}
+
+					desc.InputLayout = { job.elements, stateDesc.VertexLayout.ElementCount };
+				}
+				else
+				{
+					desc.VS = CD3DX12_SHADER_BYTECODE();
+				}
+
+				uint32_t psHandle = stateDesc.PixelShader.id;
+				if (psHandleAlloc.InUse(psHandle))
+				{
+					ShaderDX12& ps = pixelShaders[psHandleAlloc.GetIndex(psHandle)];
+					job.ps.assign(ps.data, ps.data + ps.size);
+					desc.PS = CD3DX12_SHADER_BYTECODE(
+						job.ps.data(),
+						job.ps.size()
+					);
+				}
+				else
+				{
+					desc.PS = CD3DX12_SHADER_BYTECODE();
+				}
+
+				desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+				desc.SampleMask = UINT_MAX;
+				desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+				desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+				desc.PrimitiveTopologyType = TopologyTypeTable[stateDesc.PrimitiveType];
+				desc.NumRenderTargets = stateDesc.RenderTargetCount;
+				for (size_t i = 0; i < desc.NumRenderTargets; i++)
+				{
+					desc.RTVFormats[i] = PixelFormatTable[stateDesc.RenderTargetFormats[i]];
+				}
+				desc.DSVFormat = PixelFormatTable[stateDesc.DepthStencilFormat];
+				desc.SampleDesc.Count = 1;
+
+				{
+					desc.RasterizerState.CullMode = static_cast<D3D12_CULL_MODE>(stateDesc.CullMode + 1);
+
+					desc.DepthStencilState.DepthEnable = stateDesc.DepthEnable;
+					desc.DepthStencilState.DepthWriteMask = static_cast<D3D12_DEPTH_WRITE_MASK>(stateDesc.DepthWrite);
+					desc.DepthStencilState.DepthFunc = static_cast<D3D12_COMPARISON_FUNC>(stateDesc.DepthFunc + 1);
+				}
+			}
+
+			// takes the object of the shared entry once it is compiled
+			bool InternalResolvePipelineState(PipelineStateDX12& state)
+			{
+				if (!pipelineCache.Ready(state.shared))
+				{
+					pipelineCache.CountSkippedDraw();
+					return false;
+				}
+
+				state.state = pipelineCache.GetJob(state.shared).state;
+				return true;
+			}
+
+			void InternalDestroyPipelineState(uint32_t handle)
+			{
+				if (!psoHandleAlloc.InUse(handle))
+					return;
+
+				psoHandleAlloc.Retire(handle);
+				releaseQueue.Push(frameIndex, DeferredReleaseDX12{ DEFERRED_PIPELINE_STATE, psoHandleAlloc.GetIndex(handle) });
+			}
+
+			void InternalResetBuffer(BufferResourceDX12& buf)
+			{
+				RELEASE(buf.buffer);
+				//FREE_HANDLE(buf.cbv, srvHeapAlloc);
+				//FREE_HANDLE(buf.srv, srvHeapAlloc);
+			}
+
+			uint32_t InternalCreateBuffer(uint32_t bindFlags, size_t size)
+			{
+				// BufferDX12::size is 32 bits, constant buffers are rounded up to 256 bytes
+				if (size > UINT32_MAX - 255)
+					return invalid_handle;
+
+				uint32_t handle = bufHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return handle;
+
+				uint32_t index = bufHandleAlloc.GetIndex(handle);
+				BufferDX12& buf = buffers.Acquire(index);
+				BufferResourceDX12& res = bufferResources.Acquire(index);
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				buf.state = BUFFER_STATE_COPY_DEST;
+#else
+				buf.state = BUFFER_STATE_COMMON;
+#endif
+
+				buf.bindFlags = static_cast<uint8_t>(bindFlags);
+
+				D3D12_RESOURCE_FLAGS resFlags = D3D12_RESOURCE_FLAG_NONE;
+				D3D12_HEAP_FLAGS heapFlags = D3D12_HEAP_FLAG_NONE;// D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+				if (bindFlags & BINDING_CONSTANT_BUFFER)
+				{
+					size = (static_cast<UINT>(size) + 255) & ~255;
+				}
+
+				if (FAILED(device->CreateCommittedResource(
+					&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+					heapFlags,
+					&CD3DX12_RESOURCE_DESC::Buffer(size, resFlags),
+					D3D12_RESOURCE_STATE_COPY_DEST,
+					nullptr,
+					IID_PPV_ARGS(&(res.buffer))
+				)))
+				{
+					InternalResetBuffer(res);
+					bufHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+
+				/*if (bindFlags & BINDING_CONSTANT_BUFFER)
+				{
+					buf.cbv = srvHeapAlloc.Alloc();
+					if (invalid_handle == buf.cbv)
+					{
+						InternalResetBuffer(buf);
+						bufHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+
+					CD3DX12_CPU_DESCRIPTOR_HANDLE cbvHandle(
+						srvHeap->GetCPUDescriptorHandleForHeapStart(),
+						buf.cbv,
+						srvHeapInc);
+
+					D3D12_CONSTANT_BUFFER_VIEW_DESC desc = {};
+					desc.BufferLocation = buf.buffer->GetGPUVirtualAddress();
+					desc.SizeInBytes = static_cast<UINT>(size);
+
+					device->CreateConstantBufferView(&desc, cbvHandle);
+				}*/
+
+				/*if (bindFlags & BINDING_SHADER_RESOURCE)
+				{
+					buf.srv = srvHeapAlloc.Alloc();
+					if (invalid_handle == buf.srv)
+					{
+						InternalResetBuffer(buf);
+						bufHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}*/
+
+				buf.gpuAddress = res.buffer->GetGPUVirtualAddress();
+				buf.size = static_cast<uint32_t>(size);
+				buf.stride = 0;
+				buf.format = FORMAT_AUTO;
+
+				return handle;
+			}
+
+			void InternalDestroyBuffer(uint32_t handle)
+			{
+				if (!bufHandleAlloc.InUse(handle))
+					return;
+
+				srvCache.Invalidate(DescriptorKey(DESCRIPTOR_CBV, handle));
+				srvCache.Invalidate(DescriptorKey(DESCRIPTOR_SRV_BUFFER, handle));
+
+				bufHandleAlloc.Retire(handle);
+				releaseQueue.Push(frameIndex, DeferredReleaseDX12{ DEFERRED_BUFFER, bufHandleAlloc.GetIndex(handle) });
+			}
+
+			bool InternalSetBufferLayout(uint32_t handle, BufferDX12& buf, uint32_t stride, PixelFormat format)
+			{
+				if (stride > MaxBufferStride)
+					return false;
+
+				if (stride == 0)
+				{
+					if (format == FORMAT_AUTO)
+					{
+						stride = 4;
+						format = FORMAT_R8G8B8A8_UNORM;
+					}
+					else
+					{
+						stride = PixelFormatSizeTable[format];
+					}
+				}
+				else
+				{
+					format = FORMAT_AUTO;
+				}
+				// views of the old layout are stale
+				if (stride != buf.stride || format != buf.format)
+					srvCache.Invalidate(DescriptorKey(DESCRIPTOR_SRV_BUFFER, handle));
+
+				buf.stride = static_cast<uint16_t>(stride);
+				buf.format = static_cast<uint8_t>(format);
+				return true;
+			}
+
+			bool InternalUpdateBufferRegion(uint32_t handle, uint32_t offset, uint32_t size, const void* data, uint32_t stride, PixelFormat format)
+			{
+				if (!bufHandleAlloc.InUse(handle))
+					return false;
+
+				uint32_t index = bufHandleAlloc.GetIndex(handle);
+				BufferDX12& buf = buffers[index];
+				ID3D12Resource* res = bufferResources[index].buffer;
+
+				// constant buffers can only be updated as a whole
+				if (offset > buf.size || size > buf.size - offset || (buf.bindFlags & BINDING_CONSTANT_BUFFER) != 0)
+					return false;
+
+				if (!InternalSetBufferLayout(handle, buf, stride, format))
+					return false;
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				TransistBuffer(index, D3D12_RESOURCE_STATE_COPY_DEST);
+				return uploadHeap.UploadBuffer(res, data, size, offset);
+#else
+				TransistBuffer(index, D3D12_RESOURCE_STATE_COMMON);
+				return uploadHeap.UploadResource(res, size, data, 0, offset);
+#endif
+			}
+
+			void InternalUpdateBuffer(uint32_t handle, uint32_t size, const void* data, uint32_t stride, PixelFormat format)
+			{
+				if (!bufHandleAlloc.InUse(handle))
+					return;
+
+				uint32_t index = bufHandleAlloc.GetIndex(handle);
+				BufferDX12& buf = buffers[index];
+				ID3D12Resource* res = bufferResources[index].buffer;
+
+				// update resource buffer view if needed
+				//if (invalid_handle != buf.srv)
+				{
+					if (!InternalSetBufferLayout(handle, buf, stride, format))
+						return;
+				}
+				/*if (stride != buf.stride || format != buf.format)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(
+						srvHeap->GetCPUDescriptorHandleForHeapStart(),
+						buf.srv,
+						srvHeapInc
+					);
+
+					D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+
+					desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+					desc.Format = PixelFormatTable[format];
+					desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+					desc.Buffer.FirstElement = 0;
+					desc.Buffer.NumElements = size / stride;
+					desc.Buffer.StructureByteStride = stride;
+					desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+					device->CreateShaderResourceView(buf.buffer, nullptr, srvHandle);
+				}
+			}*/
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				TransistBuffer(index, D3D12_RESOURCE_STATE_COPY_DEST);
+#else
+				TransistBuffer(index, D3D12_RESOURCE_STATE_COMMON);
+#endif
+
+				//uploadHeap.UploadResource(buf.buffer, size, data, 0);
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				uploadHeap.UploadBuffer(res, data, size);
+#else
+				D3D12_SUBRESOURCE_DATA dataDesc = {};
+				dataDesc.pData = data;
+				dataDesc.RowPitch = size;
+				dataDesc.SlicePitch = size;
+				uploadHeap.UploadResource(res, 0, 1, &dataDesc);
+#endif
+			}
+
+			void InternalResetTexture(TextureDX12& tex)
+			{
+				RELEASE(tex.texture);
+				//FREE_HANDLE(tex.srv, srvHeapAlloc);
+				FREE_HANDLE(tex.rtv, rtvHeapAlloc);
+				FREE_HANDLE(tex.dsv, dsvHeapAlloc);
+			}
+
+			uint32_t InternalCreateTexture(ID3D12Resource* res, uint32_t bindFlags, D3D12_RESOURCE_STATES initialState)
+			{
+				uint32_t handle = texHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return handle;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle);
+				TextureDX12& tex = textures.Acquire(index);
+				TextureDescDX12& info = textureDescs.Acquire(index);
+				textureStates.Acquire(index) = initialState;
+
+				tex.texture = res;
+				info.isCubeMap = false;
+
+				/*if ((bindFlags & BINDING_SHADER_RESOURCE))
+				{
+					tex.srv = srvHeapAlloc.Alloc();
+					if (invalid_handle == tex.srv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}*/
+				if (bindFlags & BINDING_RENDER_TARGET)
+				{
+					tex.rtv = rtvHeapAlloc.Alloc();
+					if (invalid_handle == tex.rtv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}
+				if (bindFlags & BINDING_DEPTH_STENCIL)
+				{
+					tex.dsv = dsvHeapAlloc.Alloc();
+					if (invalid_handle == tex.dsv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}
+
+				D3D12_RESOURCE_DESC desc = res->GetDesc();
+
+				PixelFormat format = PixelFormatFromDXGI(desc.Format);
+				if (format == FORMAT_AUTO)
+				{
+					InternalResetTexture(tex);
+					texHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+				info.format = format;
+
+				switch (desc.Dimension)
+				{
+				case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+					info.type = TEXTURE_1D;
+					info.width = static_cast<uint32_t>(desc.Width);
+					info.height = static_cast<uint32_t>(desc.Height);
+					info.depth = 1u;
+					info.arraySize = desc.DepthOrArraySize;
+					info.mipLevels = desc.MipLevels;
+					break;
+				case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+					// TODO
+					info.type = (desc.DepthOrArraySize == 6 ? TEXTURE_CUBE : TEXTURE_2D);
+					info.width = static_cast<uint32_t>(desc.Width);
+					info.height = static_cast<uint32_t>(desc.Height);
+					info.depth = 1;
+					info.arraySize = desc.DepthOrArraySize;
+					info.mipLevels = desc.MipLevels;
+					break;
+				case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+					info.type = TEXTURE_3D;
+					info.width = static_cast<uint32_t>(desc.Width);
+					info.height = static_cast<uint32_t>(desc.Height);
+					info.depth = desc.DepthOrArraySize;
+					info.arraySize = 1;
+					info.mipLevels = desc.MipLevels;
+					break;
+				default:
+					InternalResetTexture(tex);
+					texHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+				/*if (invalid_handle != tex.srv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(srvHeap->GetCPUDescriptorHandleForHeapStart(), tex.srv, srvHeapInc);
+					device->CreateShaderResourceView(tex.texture, nullptr, srvHandle);
+				}*/
+
+				if (invalid_handle != tex.rtv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(rtvHeap->GetCPUDescriptorHandleForHeapStart(), rtvHeapAlloc.GetIndex(tex.rtv), rtvHeapInc);
+					device->CreateRenderTargetView(tex.texture, nullptr, rtvHandle);
+				}
+
+				if (invalid_handle != tex.dsv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(dsvHeap->GetCPUDescriptorHandleForHeapStart(), dsvHeapAlloc.GetIndex(tex.dsv), dsvHeapInc);
+					device->CreateDepthStencilView(tex.texture, nullptr, dsvHandle);
+				}
+
+				return handle;
+			}
+
+			uint32_t InternalCreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels)
+			{
+				uint32_t handle = texHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return handle;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle);
+				TextureDX12& tex = textures.Acquire(index);
+				TextureDescDX12& info = textureDescs.Acquire(index);
+
+				CD3DX12_HEAP_PROPERTIES heapProp(D3D12_HEAP_TYPE_DEFAULT);
+
+				D3D12_RESOURCE_FLAGS resFlag = D3D12_RESOURCE_FLAG_NONE;
+				if (!(bindFlags & BINDING_SHADER_RESOURCE))
+				{
+					//tex.srv = invalid_handle;
+					resFlag |= D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+				}
+				/*else
+				{
+					tex.srv = srvHeapAlloc.Alloc();
+					if (invalid_handle == tex.srv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}*/
+				if (bindFlags & BINDING_RENDER_TARGET)
+				{
+					resFlag |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+					tex.rtv = rtvHeapAlloc.Alloc();
+					if (invalid_handle == tex.rtv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}
+				else
+				{
+					tex.rtv = invalid_handle;
+				}
+				if (bindFlags & BINDING_DEPTH_STENCIL)
+				{
+					resFlag |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+					tex.dsv = dsvHeapAlloc.Alloc();
+					if (invalid_handle == tex.dsv)
+					{
+						InternalResetTexture(tex);
+						texHandleAlloc.Free(handle);
+						return invalid_handle;
+					}
+				}
+				else
+				{
+					tex.dsv = invalid_handle;
+				}
+
+				CD3DX12_RESOURCE_DESC resDesc;
+				DXGI_FORMAT dxgiFormat = PixelFormatTable[format];
+
+				if (type == TEXTURE_1D)
+				{
+					resDesc = CD3DX12_RESOURCE_DESC::Tex1D(
+						dxgiFormat,
+						width,
+						arraySize,
+						mipLevels,
+						resFlag
+					);
+				}
+				else if (type == TEXTURE_2D || type == TEXTURE_CUBE)
+				{
+					resDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+						dxgiFormat,
+						width, height,
+						(type == TEXTURE_CUBE ? arraySize * 6 : arraySize),
+						mipLevels,
+						1, 0,
+						resFlag
+					);
+				}
+				else if (type == TEXTURE_3D)
+				{
+					resDesc = CD3DX12_RESOURCE_DESC::Tex3D(
+						dxgiFormat,
+						width, height, depth,
+						mipLevels,
+						resFlag
+					);
+				}
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COPY_DEST;
+#else
+				D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON;
+#endif
+
+				if (FAILED(device->CreateCommittedResource(&heapProp,
+					D3D12_HEAP_FLAG_DENY_BUFFERS,
+					&resDesc,
+					initialState,
+					nullptr,
+					IID_PPV_ARGS(&tex.texture))))
+				{
+					InternalResetTexture(tex);
+					texHandleAlloc.Free(handle);
+					return invalid_handle;
+				}
+
+				/*if (invalid_handle != tex.srv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(srvHeap->GetCPUDescriptorHandleForHeapStart(), tex.srv, srvHeapInc);
+					device->CreateShaderResourceView(tex.texture, nullptr, srvHandle);
+				}*/
+
+				if (invalid_handle != tex.rtv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(rtvHeap->GetCPUDescriptorHandleForHeapStart(), rtvHeapAlloc.GetIndex(tex.rtv), rtvHeapInc);
+					device->CreateRenderTargetView(tex.texture, nullptr, rtvHandle);
+				}
+
+				if (invalid_handle != tex.dsv)
+				{
+					CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(dsvHeap->GetCPUDescriptorHandleForHeapStart(), dsvHeapAlloc.GetIndex(tex.dsv), dsvHeapInc);
+					device->CreateDepthStencilView(tex.texture, nullptr, dsvHandle);
+				}
+
+				textureStates.Acquire(index) = initialState;
+
+				info.type = type;
+				info.format = format;
+				info.width = width;
+				info.height = height;
+				info.depth = depth;
+				info.arraySize = arraySize;
+				info.mipLevels = mipLevels;
+				info.isCubeMap = false;
+
+				return handle;
+			}
+
+			uint32_t InternalCreateTexture(const wchar_t* filename)
+			{
+				ID3D12Resource* res = nullptr;
+				std::vector<D3D12_SUBRESOURCE_DATA> data;
+				std::unique_ptr<uint8_t[]> ptr;
+
+				bool isCubeMap = false;
+
+				size_t fnLen = wcslen(filename);
+				if (filename[fnLen - 4] == L'.' &&
+					filename[fnLen - 3] == L'd' &&
+					filename[fnLen - 2] == L'd' &&
+					filename[fnLen - 1] == L's')
+				{
+					if (FAILED(DirectX::LoadDDSTextureFromFile(device, filename, &res, ptr, data, 0Ui64, nullptr, &isCubeMap)))
+					{
+						return invalid_handle;
+					}
+				}
+				else
+				{
+					data.resize(1);
+
+					if (FAILED(DirectX::LoadWICTextureFromFile(
+						device,
+						filename,
+						&res,
+						ptr,
+						data[0])))
+					{
+						return invalid_handle;
+					}
+				}
+
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				uint32_t handle = InternalCreateTexture(res, BINDING_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+#else
+
+				uint32_t handle = InternalCreateTexture(res, BINDING_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON);
+
+				if (invalid_handle == handle)
+				{
+					return invalid_handle;
+				}
+
+
+				cmdList->ResourceBarrier(1,
+					&CD3DX12_RESOURCE_BARRIER::Transition(res, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON)
+				);
+#endif
+				textureDescs[texHandleAlloc.GetIndex(handle)].isCubeMap = isCubeMap;
+				uploadHeap.UploadResource(res, 0, data.size(), &data[0]);
+
+				return handle;
+			}
+
+			void InternalDestroyTexture(uint32_t handle)
+			{
+				if (!texHandleAlloc.InUse(handle))
+					return;
+
+				srvCache.Invalidate(DescriptorKey(DESCRIPTOR_SRV_TEXTURE, handle));
+
+				texHandleAlloc.Retire(handle);
+				releaseQueue.Push(frameIndex, DeferredReleaseDX12{ DEFERRED_TEXTURE, texHandleAlloc.GetIndex(handle) });
+			}
+
+			// the GPU is done with the frame the object was destroyed in
+			void InternalReleaseObject(const DeferredReleaseDX12& obj)
+			{
+				switch (obj.type)
+				{
+				case DEFERRED_BINDING_LAYOUT:
+					InternalResetBindingLayout(bindingLayouts[obj.index]);
+					blHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_PIPELINE_STATE:
+					InternalResetPipelineState(pipelineStates[obj.index]);
+					psoHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_BUFFER:
+					InternalResetBuffer(bufferResources[obj.index]);
+					bufHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_TEXTURE:
+					InternalResetTexture(textures[obj.index]);
+					texHandleAlloc.Recycle(obj.index);
+					break;
+				}
+			}
+
+			void InternalUpdateTexture(uint32_t handle, const void* data, uint32_t rowPitch)
+			{
+				if (!texHandleAlloc.InUse(handle))
+					return;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle);
+				TextureDX12& tex = textures[index];
+
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				TransistTexture(index, D3D12_RESOURCE_STATE_COPY_DEST);
+#else
+				TransistTexture(index, D3D12_RESOURCE_STATE_COMMON);
+#endif
+				D3D12_SUBRESOURCE_DATA dataDesc = {};
+				dataDesc.pData = data;
+				dataDesc.RowPitch = rowPitch;
+				// TODO
+
+				uploadHeap.UploadResource(tex.texture, 0, 1, &dataDesc);
+			}
+
+			void InternalResetSampler(SamplerDX12& samp)
+			{
+				//FREE_HANDLE(samp.sampler, sampHeapAlloc);
+				samp.desc = {};
+			}
+
+			uint32_t InternalCreateSampler()
+			{
+				uint32_t handle = sampHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return invalid_handle;
+
+				SamplerDX12& samp = samplers.Acquire(sampHandleAlloc.GetIndex(handle));
+				/*samp.sampler = sampHeapAlloc.Alloc();
+				if (invalid_handle == samp.sampler)
+				{
+					InternalResetSampler(samp);
+					sampHandleAlloc.Free(handle);
+					return invalid_handle;
+				}*/
+
+				samp.desc = {};
+				samp.desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+				samp.desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+				samp.desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+				samp.desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+				samp.desc.MaxLOD = D3D12_FLOAT32_MAX;
+				samp.desc.MaxAnisotropy = 1;
+
+				/*CD3DX12_CPU_DESCRIPTOR_HANDLE sampHandle(
+					sampHeap->GetCPUDescriptorHandleForHeapStart(),
+					samp.sampler,
+					sampHeapInc
+				);
+
+				device->CreateSampler(&samp.desc, sampHandle);*/
+				return handle;
+			}
+
+			void InternalDestroySampler(uint32_t handle)
+			{
+				if (!sampHandleAlloc.InUse(handle))
+					return;
+
+				SamplerDX12& samp = samplers[sampHandleAlloc.GetIndex(handle)];
+
+				sampCache.Invalidate(DescriptorKey(DESCRIPTOR_SAMPLER, handle));
+
+				InternalResetSampler(samp);
+				sampHandleAlloc.Free(handle);
+			}
+
+			void InternalResetShader(ShaderDX12& shader)
+			{
+				delete[] shader.data;
+				shader.data = nullptr;
+				shader.size = 0;
+				shader.hash = 0;
+			}
+
+			uint32_t InternalCreateVertexShader(const void* data, size_t size)
+			{
+				uint32_t handle = vsHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return invalid_handle;
+
+				ShaderDX12& vs = vertexShaders.Acquire(vsHandleAlloc.GetIndex(handle));
+				vs.data = new uint8_t[size];
+				memcpy(vs.data, data, size);
+				vs.size = size;
+				vs.hash = HashShaderBytecode(data, size);
+
+				return handle;
+			}
+
+			void InternalDestroyVertexShader(uint32_t handle)
+			{
+				if (!vsHandleAlloc.InUse(handle))
+					return;
+
+				ShaderDX12& vs = vertexShaders[vsHandleAlloc.GetIndex(handle)];
+				InternalResetShader(vs);
+				vsHandleAlloc.Free(handle);
+			}
+
+			uint32_t InternalCreatePixelShader(const void* data, size_t size)
+			{
+				uint32_t handle = psHandleAlloc.Alloc();
+				if (invalid_handle == handle)
+					return invalid_handle;
+
+				ShaderDX12& ps = pixelShaders.Acquire(psHandleAlloc.GetIndex(handle));
+				ps.data = new uint8_t[size];
+				memcpy(ps.data, data, size);
+				ps.size = size;
+				ps.hash = HashShaderBytecode(data, size);
+
+				return handle;
+			}
+
+			void InternalDestroyPixelShader(uint32_t handle)
+			{
+				if (!psHandleAlloc.InUse(handle))
+					return;
+
+				ShaderDX12& ps = pixelShaders[psHandleAlloc.GetIndex(handle)];
+				InternalResetShader(ps);
+				psHandleAlloc.Free(handle);
+			}
+
+#pragma endregion
+
+
+			// interface implementation
+#pragma region interface implementation
+
+			// Binding Layout
+			BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) override
+			{
+				return BindingLayoutHandle{ InternalCreateBindingLayout(layout) };
+			}
+
+			void DestroyBindingLayout(BindingLayoutHandle handle) override
+			{
+				InternalDestroyBindingLayout(handle.id);
+			}
+
+			// Binding Groups
+			BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) override
+			{
+				return BindingGroupHandle{ InternalCreateBindingGroup(layout.id, bindingData) };
+			}
+
+			void DestroyBindingGroup(BindingGroupHandle handle) override
+			{
+				InternalDestroyBindingGroup(handle.id);
+			}
+
+			// Pipeline States
+			PipelineStateHandle CreatePipelineState(const PipelineState& state) override
+			{
+				return PipelineStateHandle{ InternalCreatePipelineState(state) };
+			}
+
+			void DestroyPipelineState(PipelineStateHandle handle) override
+			{
+				InternalDestroyPipelineState(handle.id);
+			}
+
+
+			// Buffers
+			BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic = false) override
+			{
+				return BufferHandle{
+					InternalCreateBuffer(bindingFlags, size)
+				};
+			}
+
+			void DestroyBuffer(BufferHandle handle) override
+			{
+				InternalDestroyBuffer(handle.id);
+			}
+
+			void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) override
+			{
+				// the record can't hold more, don't let the casts truncate
+				if (size > UINT32_MAX || stride > MaxBufferStride)
+					return;
+
+				InternalUpdateBuffer(handle.id, static_cast<uint32_t>(size), data, static_cast<uint32_t>(stride), format);
+			}
+
+			bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO) override
+			{
+				if (offset > UINT32_MAX || size > UINT32_MAX || stride > MaxBufferStride)
+					return false;
+
+				return InternalUpdateBufferRegion(handle.id, static_cast<uint32_t>(offset), static_cast<uint32_t>(size), data, static_cast<uint32_t>(stride), format);
+			}
+
+
+			// Textures
+			TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height = 1, uint32_t depth = 1, uint32_t arraySize = 1, uint32_t mipLevels = 1, bool dynamic = false) override
+			{
+				return TextureHandle{
+					InternalCreateTexture(
+						type,
+						format,
+						bindFlags,
+						width,
+						height,
+						depth,
+						arraySize,
+						mipLevels)
+				};
+			}
+
+			TextureHandle CreateTexture(const wchar_t* filename) override
+			{
+				return TextureHandle{
+					InternalCreateTexture(filename)
+				};
+			}
+
+			void DestroyTexture(TextureHandle handle) override
+			{
+				InternalDestroyTexture(handle.id);
+			}
+
+			void UpdateTexture(TextureHandle handle, size_t pitch, const void* data) override
+			{
+				InternalUpdateTexture(handle.id, data, static_cast<uint32_t>(pitch));
+			}
+
+
+			void Clear(TextureHandle handle, float color[4]) override
+			{
+				if (handle.id == invalid_handle)
+					handle.id = backBufferIndex;
+				if (!texHandleAlloc.InUse(handle.id))
+					return;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle.id);
+				TextureDX12& tex = textures[index];
+
+				if (invalid_handle == tex.rtv)
+					return;
+
+				TransistTexture(index, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+				CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(
+					rtvHeap->GetCPUDescriptorHandleForHeapStart(),
+					rtvHeapAlloc.GetIndex(tex.rtv),
+					rtvHeapInc);
+
+				cmdList->ClearRenderTargetView(rtvHandle, color, 0, nullptr);
+			}
+
+			void ClearDepth(TextureHandle handle, float depth) override
+			{
+				if (handle.id == invalid_handle)
+					handle.id = 2; // TODO default depth buffer index
+				if (!texHandleAlloc.InUse(handle.id))
+					return;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle.id);
+				TextureDX12& tex = textures[index];
+
+				if (invalid_handle == tex.dsv)
+					return;
+
+				TransistTexture(index, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+				CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(
+					dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+					dsvHeapAlloc.GetIndex(tex.dsv),
+					dsvHeapInc);
+
+				cmdList->ClearDepthStencilView(
+					dsvHandle,
+					D3D12_CLEAR_FLAG_DEPTH,
+					depth,
+					0, 0, nullptr);
+			}
+
+			void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil) override
+			{
+				if (handle.id == invalid_handle)
+					handle.id = 2; // TODO default depth buffer index
+				if (!texHandleAlloc.InUse(handle.id))
+					return;
+
+				uint32_t index = texHandleAlloc.GetIndex(handle.id);
+				TextureDX12& tex = textures[index];
+
+				if (invalid_handle == tex.dsv)
+					return;
+
+				TransistTexture(index, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+				CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(
+					dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+					dsvHeapAlloc.GetIndex(tex.dsv),
+					dsvHeapInc);
+
+				cmdList->ClearDepthStencilView(
+					dsvHandle,
+					D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+					depth, stencil, 0, nullptr);
+			}
+
+
+			// Samplers
+			SamplerHandle CreateSampler() override
+			{
+				return SamplerHandle{ InternalCreateSampler() };
+			}
+
+			void DestroySampler(SamplerHandle handle) override
+			{
+				InternalDestroySampler(handle.id);
+			}
+
+
+			// Shaders
+			VertexShaderHandle CreateVertexShader(const void* bytecode, size_t size) override
+			{
+				return VertexShaderHandle{ InternalCreateVertexShader(bytecode, size) };
+			}
+
+			void DestroyVertexShader(VertexShaderHandle handle) override
+			{
+				InternalDestroyVertexShader(handle.id);
+			}
+
+
+			PixelShaderHandle CreatePixelShader(const void* bytecode, size_t size) override
+			{
+				return PixelShaderHandle{ InternalCreatePixelShader(bytecode, size) };
+			}
+
+			void DestroyPixelShader(PixelShaderHandle handle) override
+			{
+				InternalDestroyPixelShader(handle.id);
+			}
+
+
+			// Draw Functions
+			void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) override
+			{
+				uint32_t layoutHandle = BindPipelineState(stateHandle);
+				if (invalid_handle == layoutHandle)
+				{
+					return; // TODO error !
+				}
+
+				if (BindResources(layoutHandle, drawcall))
+					IssueDraw(drawcall);
+			}
+
+			void Submit(const DrawItem* items, size_t count) override
+			{
+				PipelineStateHandle stateHandle = { invalid_handle };
+				uint32_t layoutHandle = invalid_handle;
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					// the draw after next is brought in, then the records of the next one
+					if (i + 2 < count)
+						BAMBOO_PREFETCH(items[i + 2].Call);
+					if (i + 1 < count)
+						PrefetchDraw(*items[i + 1].Call);
+
+					const DrawCall& drawcall = *items[i].Call;
+
+					if (items[i].PipelineState.id != stateHandle.id || invalid_handle == layoutHandle)
+					{
+						stateHandle = items[i].PipelineState;
+						layoutHandle = BindPipelineState(stateHandle);
+					}
+
+					if (invalid_handle != layoutHandle && BindResources(layoutHandle, drawcall))
+						IssueDraw(drawcall);
+				}
+			}
+
+
+			// Swap Chains
+			void Present() override
+			{
+				TransistTexture(backBufferIndex, D3D12_RESOURCE_STATE_PRESENT);
+
+				cmdList->Close();
+
+				ID3D12CommandList* cmdLists[] = { cmdList };
+
+				cmdQueue->ExecuteCommandLists(1, cmdLists);
+				cmdQueue->Signal(fence, frameIndex);
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				// all the frames the ring keeps are in flight, the oldest one has to finish
+				while (!uploadHeap.FinishFrame(frameIndex))
+				{
+					WaitForFence(uploadHeap.GetOldestFrameFence());
+					uploadHeap.Retire(fence->GetCompletedValue());
+				}
+#endif
+
+				swapChain->Present(0, 0);
+
+				WaitForFence(frameIndex);
+				frameIndex++;
+
+				// what was destroyed in the frames the GPU has finished goes away now
+				releaseQueue.Retire(fence->GetCompletedValue(), [this](const DeferredReleaseDX12& obj) { InternalReleaseObject(obj); });
+
+				// so the statistics count the compiles no draw has asked for yet
+				pipelineCache.Poll();
+
+				uploadHeap.Clear();
+#if defined(USING_SYNC_UPLOAD_HEAP)
+				uploadHeap.Retire(fence->GetCompletedValue());
+#endif
+
+				backBufferIndex = swapChain->GetCurrentBackBufferIndex();
+
+				// tables used before the completed frame can be overwritten
+				srvCache.SetFrame(frameIndex, fence->GetCompletedValue());
+				sampCache.SetFrame(frameIndex, fence->GetCompletedValue());
+
+				cmdAlloc->Reset();
+				cmdList->Reset(cmdAlloc, nullptr);
+				ID3D12DescriptorHeap* heaps[] = { srvHeap, sampHeap };
+				cmdList->SetDescriptorHeaps(2, heaps);
+
+				currentBindingLayout.id = invalid_handle;
+				currentPipelineState.id = invalid_handle;
+				stateCache.Invalidate();
+			}
+
+
+			void WaitForFence(UINT64 value)
+			{
+				if (fence->GetCompletedValue() < value)
+				{
+					fence->SetEventOnCompletion(value, fenceEvent);
+					WaitForSingleObject(fenceEvent, INFINITE);
+				}
+			}
+
+
+			// Clean up
+			void Shutdown() override
+			{
+				// the commands recorded since the last Present are never executed
+				WaitForFence(frameIndex - 1);
+				releaseQueue.Flush([this](const DeferredReleaseDX12& obj) { InternalReleaseObject(obj); });
+
+#define CLEAR_ARRAY(arr, alloc, func) \
+				for (uint32_t index = 0; index < alloc.Size(); ++index) \
+					if (alloc.IndexInUse(index)) func(arr[index]); \
+				arr.Release();
+
+				CLEAR_ARRAY(bindingGroups, bgHandleAlloc, InternalResetBindingGroup);
+				CLEAR_ARRAY(bindingLayouts, blHandleAlloc, InternalResetBindingLayout);
+				CLEAR_ARRAY(pipelineStates, psoHandleAlloc, InternalResetPipelineState);
+				CLEAR_ARRAY(bufferResources, bufHandleAlloc, InternalResetBuffer);
+				CLEAR_ARRAY(textures, texHandleAlloc, InternalResetTexture);
+				CLEAR_ARRAY(samplers, sampHandleAlloc, InternalResetSampler);
+				CLEAR_ARRAY(vertexShaders, vsHandleAlloc, InternalResetShader);
+				CLEAR_ARRAY(pixelShaders, psHandleAlloc, InternalResetShader);
+
+#undef CLEAR_ARRAY
+
+				pipelineCache.Shutdown();
+
+				buffers.Release();
+				textureStates.Release();
+				textureDescs.Release();
+
+				CloseHandle(fenceEvent);
+
+				uploadHeap.Release();
+
+				sampHeap->Release();
+				rtvHeap->Release();
+				dsvHeap->Release();
+				srvHeap->Release();
+
+				fence->Release();
+
+				cmdList->Release();
+				cmdAlloc->Release();
+
+				swapChain->Release();
+				cmdQueue->Release();
+				device->Release();
+			}
+
+
+			// Statistics
+			void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const override
+			{
+				usage.BindingLayouts = blHandleAlloc.MemoryUsage() + bindingLayouts.MemoryUsage();
+				usage.BindingGroups = bgHandleAlloc.MemoryUsage() + bindingGroups.MemoryUsage();
+				usage.PipelineStates = psoHandleAlloc.MemoryUsage() + pipelineStates.MemoryUsage();
+				usage.Buffers = bufHandleAlloc.MemoryUsage() + buffers.MemoryUsage() + bufferResources.MemoryUsage();
+				usage.Textures = texHandleAlloc.MemoryUsage() + textures.MemoryUsage() + textureStates.MemoryUsage() + textureDescs.MemoryUsage();
+				usage.Samplers = sampHandleAlloc.MemoryUsage() + samplers.MemoryUsage();
+				usage.VertexShaders = vsHandleAlloc.MemoryUsage() + vertexShaders.MemoryUsage();
+				usage.PixelShaders = psHandleAlloc.MemoryUsage() + pixelShaders.MemoryUsage();
+			}
+
+#pragma endregion
+			// interface end
+
+		};
+	}
+}
+
+#undef RELEASE
+#undef FREE_HANDLE
+#undef CE
+#undef CHECKED
@@ -0,0 +1,35 @@
+#include "GraphicsAPINullImpl.h"
+
+namespace bamboo
+{
+	namespace null
+	{
+		GraphicsAPI * InitGraphicsAPINull(void* windowHandle, const ResourceLimits& limits)
+		{
+			GraphicsAPINull* api = new GraphicsAPINull();
+
+			if (0 != api->Init(windowHandle, limits))
+			{
+				delete api;
+				return nullptr;
+			}
+
+			return api;
+		}
+
+		void GetStatistics(const GraphicsAPI* api, Statistics& stats)
+		{
+			stats = static_cast<const GraphicsAPINull*>(api->GetBackendAPI())->stats;
+		}
+
+		void ResetStatistics(GraphicsAPI* api)
+		{
+			static_cast<GraphicsAPINull*>(api->GetBackendAPI())->ResetStatistics();
+		}
+
+		void GetPipelineCacheStatistics(const GraphicsAPI* api, PipelineCacheStatistics& stats)
+		{
+			stats = static_cast<const GraphicsAPINull*>(api->GetBackendAPI())->pipelineCache.GetStatistics();
+		}
+	}
+}
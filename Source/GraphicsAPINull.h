@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+#include "PipelineCache.h"
+
+
+namespace bamboo
+{
+	namespace null
+	{
+		// what the null backend has seen since the last ResetStatistics
+		struct Statistics
+		{
+			uint32_t					DrawCalls;
+			uint32_t					DroppedDrawCalls;		// invalid handle or binding
+			uint64_t					Instances;				// drawn by the draw calls, 1 for a draw that isn't instanced
+			uint32_t					PipelineStateChanges;
+			uint32_t					VertexBufferChanges;
+			uint32_t					IndexBufferChanges;
+			uint32_t					RenderTargetChanges;
+			uint32_t					ConstantUpdates;		// root constants, in 32-bit values
+			uint32_t					ConstantBufferBindings;
+			uint32_t					ShaderResourceBindings;
+			uint32_t					SamplerBindings;
+			uint32_t					BindingGroupChanges;	// the descriptors of a group count once per change
+			uint32_t					Clears;
+			uint32_t					Presents;
+			uint64_t					BufferBytesUpdated;
+			uint32_t					TextureUpdates;
+			uint32_t					DeferredReleases;		// destroyed objects queued for the simulated fence
+			uint32_t					RetiredReleases;		// queued objects the fence has released
+		};
+
+		// A backend without a device. Every resource is a record in the same
+		// handle allocators and pools the real backends use, draw calls are
+		// validated and their binding layouts walked the same way, but the only
+		// output is the counters above. The window handle is ignored.
+		GraphicsAPI* InitGraphicsAPINull(void* windowHandle, const ResourceLimits& limits);
+
+		// api must have been created by InitGraphicsAPINull, or be a layer over
+		// one, as InitGraphicsAPI(Null) may return
+		void GetStatistics(const GraphicsAPI* api, Statistics& stats);
+		void ResetStatistics(GraphicsAPI* api);		// the pipeline cache ones too
+
+		// pipeline states shared between identical descriptions, compiled
+		// right away as there is no compile thread
+		void GetPipelineCacheStatistics(const GraphicsAPI* api, PipelineCacheStatistics& stats);
+
+		// the backend class is in GraphicsAPINullImpl.h, for GraphicsDevice
+		struct GraphicsAPINull;
+	}
+}
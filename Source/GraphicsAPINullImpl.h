@@ -0,0 +1,1023 @@
+#pragma once
+
+// The null backend itself, in a header so GraphicsDevice can call its final
+// class directly, see StaticBackend. Only GraphicsAPINull.cpp and
+// GraphicsDevice.h include it.
+
+#include "GraphicsAPINull.h"
+
+#include <cstring>
+
+#include "ResourcePool.h"
+#include "DeferredRelease.h"
+#include "PipelineCache.h"
+
+namespace bamboo
+{
+	namespace null
+	{
+		// size of the default render targets, there is no window to take it from
+		constexpr uint32_t DefaultWidth = 1280;
+		constexpr uint32_t DefaultHeight = 720;
+
+		const size_t PixelFormatSizeTable[] =
+		{
+			0,	// FORMAT_AUTO
+			4,	// FORMAT_R8G8B8A8_UNORM
+			4,	// FORMAT_R8G8B8A8_SNORM
+			8,	// FORMAT_R16G16B16B16_UNORM
+			8,	// FORMAT_R16G16B16B16_SNORM
+			16,	// FORMAT_R32G32B32A32_FLOAT
+			2,	// FORMAT_R16_SINT
+			4,	// FORMAT_R32_SINT
+			2,	// FORMAT_R16_UINT
+			4,	// FORMAT_R32_UINT
+			4,	// FORMAT_D24_UNORM_S8_UINT
+		};
+
+		struct BindingLayoutNull
+		{
+			uint32_t					entryCount;
+			BindingLayout				layout;
+			uint32_t					offsets[MaxBindingLayoutEntry];
+
+			// same data layout as the other backends, a table takes no space
+			// itself, its sub entries follow it
+			bool Reset(const BindingLayout& layout)
+			{
+				uint32_t offset = 0, i = 0;
+				entryCount = MaxBindingLayoutEntry;
+
+				for (; i < MaxBindingLayoutEntry; ++i)
+				{
+					auto& entry = layout.table[i];
+					if (entry.Type == BINDING_SLOT_TYPE_NONE)
+					{
+						entryCount = i;
+						break;
+					}
+
+					offsets[i] = offset;
+
+					if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+					{
+						if (i + entry.Count >= MaxBindingLayoutEntry)
+							return false;
+
+						for (uint32_t j = 0; j < entry.Count; j++)
+						{
+							auto& subEntry = layout.table[i + j + 1];
+							if (subEntry.Type != BINDING_SLOT_TYPE_CBV &&
+								subEntry.Type != BINDING_SLOT_TYPE_SRV &&
+								subEntry.Type != BINDING_SLOT_TYPE_SAMPLER)
+								return false;
+
+							offsets[i + j + 1] = offset;
+							offset += subEntry.Count * 4u;
+						}
+
+						i += entry.Count;
+					}
+					else
+					{
+						offset += 4u * (entry.Count == 0 ? 1 : entry.Count);
+					}
+				}
+
+				if (offset > sizeof(DrawCall::ResourceBindingData))
+					return false;
+
+				this->layout = layout;
+
+				return true;
+			}
+		};
+
+		struct DescriptorCountNull
+		{
+			uint32_t					constantBuffers;
+			uint32_t					shaderResources;
+			uint32_t					samplers;
+		};
+
+		struct BindingGroupNull
+		{
+			BindingLayoutHandle			layout;
+			DescriptorCountNull			descriptors;
+		};
+
+		// nothing to compile, CreatePipelineState has checked the description
+		struct PipelineCompileNull
+		{
+			bool Compile() { return true; }
+
+			void Reset() {}
+		};
+
+		struct PipelineStateNull
+		{
+			uint32_t					shared;			// entry in the pipeline cache
+			BindingLayoutHandle			bindingLayout;
+			VertexShaderHandle			vs;
+			PixelShaderHandle			ps;
+			PrimitiveType				primitiveType;
+		};
+
+		struct BufferNull
+		{
+			uint32_t					bindFlags;
+			uint32_t					size;
+			uint32_t					stride;
+			PixelFormat					format;
+			bool						dynamic;
+
+			void Reset(uint32_t size, uint32_t bindFlags, bool dynamic)
+			{
+				this->bindFlags = bindFlags;
+				this->size = size;
+				this->stride = 0;
+				this->format = FORMAT_AUTO;
+				this->dynamic = dynamic;
+			}
+		};
+
+		struct TextureNull
+		{
+			TextureType					type;
+			PixelFormat					format;
+			uint32_t					bindFlags;
+			uint32_t					width;
+			uint32_t					height;
+			uint32_t					depth;
+			uint32_t					arraySize;
+			uint32_t					mipLevels;
+			bool						dynamic;
+
+			void Reset(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height = 1, uint32_t depth = 1, uint32_t arraySize = 1, uint32_t mipLevels = 1, bool dynamic = false)
+			{
+				this->type = type;
+				this->format = format;
+				this->bindFlags = bindFlags;
+				this->width = width;
+				this->height = height;
+				this->depth = depth;
+				this->arraySize = arraySize;
+				this->mipLevels = mipLevels;
+				this->dynamic = dynamic;
+			}
+		};
+
+		struct ShaderNull
+		{
+			size_t						size;
+			uint64_t					hash;			// of the bytecode, for the pipeline cache
+		};
+
+		// presents the simulated GPU is behind, what is destroyed in a frame is
+		// released once that many more frames have been presented
+		constexpr uint64_t SimulatedFrameLatency = 2;
+
+		// the same objects the D3D12 backend can't release before the GPU is done
+		enum DeferredObjectNull
+		{
+			DEFERRED_BINDING_LAYOUT,
+			DEFERRED_PIPELINE_STATE,
+			DEFERRED_BUFFER,
+			DEFERRED_TEXTURE,
+		};
+
+		struct DeferredReleaseNull
+		{
+			DeferredObjectNull			type;
+			uint32_t					index;		// slot of the retired handle
+		};
+
+		// the elements of a vertex buffer slot are either all per vertex or all
+		// per instance with the same step rate, as the input assemblers want
+		inline bool CheckVertexLayout(const VertexLayout& layout)
+		{
+			if (layout.ElementCount > MaxVertexInputElement)
+				return false;
+
+			int stepRates[MaxVertexBufferBindingSlot];
+			for (size_t i = 0; i < MaxVertexBufferBindingSlot; ++i)
+				stepRates[i] = -1;
+
+			for (size_t i = 0; i < layout.ElementCount; ++i)
+			{
+				const VertexInputElement& elem = layout.Elements[i];
+				if (elem.BindingSlot >= MaxVertexBufferBindingSlot)
+					return false;
+
+				int& stepRate = stepRates[elem.BindingSlot];
+				if (stepRate >= 0 && stepRate != elem.InstanceStepRate)
+					return false;
+				stepRate = elem.InstanceStepRate;
+			}
+
+			return true;
+		}
+
+
+		struct GraphicsAPINull final : public GraphicsAPI
+		{
+			ResourcePool<BindingLayoutNull, 2>	bindingLayouts;
+			ResourcePool<BindingGroupNull>		bindingGroups;
+			ResourcePool<PipelineStateNull>		pipelineStates;
+			ResourcePool<BufferNull>			buffers;
+			ResourcePool<TextureNull>			textures;
+			ResourcePool<ShaderNull>			vertexShaders;
+			ResourcePool<ShaderNull>			pixelShaders;
+
+			// without compile threads, the jobs run in CreatePipelineState and
+			// the statistics are the same from one run to the next
+			PipelineCache<PipelineCompileNull>	pipelineCache;
+
+			TextureHandle				defaultColorBuffer;
+			TextureHandle				defaultDepthStencilBuffer;
+
+			// what the last draw call left bound
+			PipelineStateHandle			currentPipelineState;
+			BindingGroupHandle			currentBindingGroup;
+			BufferHandle				currentVertexBuffers[MaxVertexBufferBindingSlot];
+			uint32_t					currentVertexBufferOffsets[MaxVertexBufferBindingSlot];
+			uint32_t					currentVertexBufferCount;
+			BufferHandle				currentIndexBuffer;
+			uint32_t					currentIndexBufferOffset;
+			TextureHandle				currentRenderTargets[MaxRenderTargetBindingSlot];
+			uint32_t					currentRenderTargetCount;
+			TextureHandle				currentDepthStencil;
+
+			// fence value of the frame being recorded, a frame is complete when
+			// the one SimulatedFrameLatency after it is presented
+			uint64_t					frameIndex;
+			DeferredReleaseQueue<DeferredReleaseNull>	releaseQueue;
+
+			Statistics					stats;
+
+			int Init(void* windowHandle, const ResourceLimits& limits)
+			{
+				InitHandleAllocs(limits);
+				bindingLayouts.Init(limits.BindingLayoutCount);
+				bindingGroups.Init(limits.BindingGroupCount);
+				pipelineStates.Init(limits.PipelineStateCount);
+				pipelineCache.Init(limits.PipelineStateCount, 0);
+				buffers.Init(limits.BufferCount);
+				textures.Init(limits.TextureCount);
+				vertexShaders.Init(limits.VertexShaderCount);
+				pixelShaders.Init(limits.PixelShaderCount);
+
+				int result = 0;
+
+				if (0 != (result = InitRenderTargets()))
+					return result;
+
+				ResetBindings();
+				ResetStatistics();
+
+				frameIndex = 1;
+
+				return 0;
+			}
+
+			int InitRenderTargets()
+			{
+				defaultColorBuffer.id = texHandleAlloc.Alloc();
+				if (0 != defaultColorBuffer.id)
+					return -1;
+
+				TextureNull& rt = textures.Acquire(texHandleAlloc.GetIndex(defaultColorBuffer.id));
+				rt.Reset(TEXTURE_2D, FORMAT_R8G8B8A8_UNORM, BINDING_RENDER_TARGET, DefaultWidth, DefaultHeight);
+
+				defaultDepthStencilBuffer.id = texHandleAlloc.Alloc();
+				if (1 != defaultDepthStencilBuffer.id)
+					return -1;
+
+				TextureNull& ds = textures.Acquire(texHandleAlloc.GetIndex(defaultDepthStencilBuffer.id));
+				ds.Reset(TEXTURE_2D, FORMAT_D24_UNORM_S8_UINT, BINDING_DEPTH_STENCIL, DefaultWidth, DefaultHeight);
+
+				return 0;
+			}
+
+			void ResetBindings()
+			{
+				currentPipelineState.id = invalid_handle;
+				currentBindingGroup.id = invalid_handle;
+				currentVertexBufferCount = 0;
+				currentIndexBuffer.id = invalid_handle;
+				currentIndexBufferOffset = 0;
+				currentRenderTargetCount = 0;
+				currentDepthStencil.id = invalid_handle;
+			}
+
+			void ResetStatistics()
+			{
+				memset(&stats, 0, sizeof(stats));
+				pipelineCache.ResetStatistics();
+			}
+
+			// a single descriptor of a CBV, SRV or sampler slot
+			bool CheckDescriptor(uint32_t type, uint32_t data, DescriptorCountNull& count)
+			{
+				if (invalid_handle == data)
+					return true;
+
+				if (type == BINDING_SLOT_TYPE_CBV)
+				{
+					if (!bufHandleAlloc.InUse(data))
+						return false;
+					if ((buffers[bufHandleAlloc.GetIndex(data)].bindFlags & BINDING_CONSTANT_BUFFER) == 0)
+						return false;
+
+					count.constantBuffers++;
+				}
+				else if (type == BINDING_SLOT_TYPE_SRV)
+				{
+					if ((data & binding_buffer_flag) != 0u)
+					{
+						uint32_t handle = data & ~binding_buffer_flag;
+						if (!bufHandleAlloc.InUse(handle))
+							return false;
+						if ((buffers[bufHandleAlloc.GetIndex(handle)].bindFlags & BINDING_SHADER_RESOURCE) == 0)
+							return false;
+					}
+					else
+					{
+						if (!texHandleAlloc.InUse(data))
+							return false;
+						if ((textures[texHandleAlloc.GetIndex(data)].bindFlags & BINDING_SHADER_RESOURCE) == 0)
+							return false;
+					}
+
+					count.shaderResources++;
+				}
+				else if (type == BINDING_SLOT_TYPE_SAMPLER)
+				{
+					if (!sampHandleAlloc.InUse(data))
+						return false;
+
+					count.samplers++;
+				}
+				else
+				{
+					return false;
+				}
+
+				return true;
+			}
+
+			// the CBV, SRV and sampler slots of a layout, root constants are skipped
+			bool CheckDescriptors(const BindingLayoutNull& layout, const uint32_t* bindingData, DescriptorCountNull& count)
+			{
+				const uint8_t* pData = reinterpret_cast<const uint8_t*>(bindingData);
+
+				for (uint32_t i = 0; i < layout.entryCount; i++)
+				{
+					auto& entry = layout.layout.table[i];
+					uint32_t entryCount = (entry.Count == 0 ? 1 : entry.Count);
+
+					switch (entry.Type)
+					{
+					case BINDING_SLOT_TYPE_CBV:
+					case BINDING_SLOT_TYPE_SRV:
+					case BINDING_SLOT_TYPE_SAMPLER:
+						for (uint32_t j = 0; j < entryCount; j++)
+						{
+							uint32_t offset = layout.offsets[i] + 4u * j;
+							uint32_t data = *reinterpret_cast<const uint32_t*>((pData + offset));
+							if (!CheckDescriptor(entry.Type, data, count))
+								return false;
+						}
+						break;
+					case BINDING_SLOT_TYPE_TABLE:
+						for (uint32_t iRange = 0; iRange < entry.Count; iRange++)
+						{
+							auto& subEntry = layout.layout.table[i + iRange + 1];
+
+							for (uint32_t iRangeEntry = 0; iRangeEntry < subEntry.Count; iRangeEntry++)
+							{
+								uint32_t offset = layout.offsets[i + iRange + 1] + 4u * iRangeEntry;
+								uint32_t data = *reinterpret_cast<const uint32_t*>((pData + offset));
+								if (!CheckDescriptor(subEntry.Type, data, count))
+									return false;
+							}
+						}
+						i += entry.Count;
+						break;
+					default:
+						break;
+					}
+				}
+
+				return true;
+			}
+
+			// the binding layout of a pipeline state, invalid_handle if either is gone
+			uint32_t BindPipelineState(PipelineStateHandle stateHandle)
+			{
+				if (!psoHandleAlloc.InUse(stateHandle.id))
+					return invalid_handle;
+
+				const PipelineStateNull& pso = pipelineStates[psoHandleAlloc.GetIndex(stateHandle.id)];
+
+				// the draws are skipped while it compiles, as in the D3D12 backend
+				if (!pipelineCache.Ready(pso.shared))
+				{
+					pipelineCache.CountSkippedDraw();
+					return invalid_handle;
+				}
+
+				if (stateHandle.id != currentPipelineState.id)
+				{
+					currentPipelineState = stateHandle;
+					stats.PipelineStateChanges++;
+				}
+
+				uint32_t layoutHandle = pso.bindingLayout.id;
+				return blHandleAlloc.InUse(layoutHandle) ? layoutHandle : invalid_handle;
+			}
+
+			inline void PrefetchDraw(const DrawCall& drawcall) const
+			{
+				for (uint32_t i = 0; i < drawcall.VertexBufferCount; ++i)
+					buffers.Prefetch(bufHandleAlloc.GetIndex(drawcall.VertexBuffers[i].id));
+				if (drawcall.HasIndexBuffer)
+					buffers.Prefetch(bufHandleAlloc.GetIndex(drawcall.IndexBuffer.id));
+				if (drawcall.HasBindingGroup)
+					bindingGroups.Prefetch(bgHandleAlloc.GetIndex(drawcall.BindingGroup.id));
+			}
+
+			// layoutHandle is the one BindPipelineState gave for the draw
+			bool BindResources(uint32_t layoutHandle, const DrawCall& drawcall)
+			{
+				// Input Assembly
+				for (uint32_t i = 0; i < drawcall.VertexBufferCount; ++i)
+				{
+					uint32_t handle = drawcall.VertexBuffers[i].id;
+					uint32_t offset = drawcall.VertexBufferOffsets[i];
+					if (!bufHandleAlloc.InUse(handle))
+						return false;
+					BufferNull& buf = buffers[bufHandleAlloc.GetIndex(handle)];
+					if ((buf.bindFlags & BINDING_VERTEX_BUFFER) == 0 || offset > buf.size)
+						return false;
+
+					// drawing another part of the same buffer needs no rebinding
+					if (i >= currentVertexBufferCount || currentVertexBuffers[i].id != handle ||
+						currentVertexBufferOffsets[i] != offset)
+					{
+						currentVertexBuffers[i].id = handle;
+						currentVertexBufferOffsets[i] = offset;
+						stats.VertexBufferChanges++;
+					}
+				}
+				currentVertexBufferCount = drawcall.VertexBufferCount;
+
+				if (drawcall.HasIndexBuffer)
+				{
+					uint32_t handle = drawcall.IndexBuffer.id;
+					uint32_t offset = drawcall.IndexBufferOffset;
+					if (!bufHandleAlloc.InUse(handle))
+						return false;
+					BufferNull& buf = buffers[bufHandleAlloc.GetIndex(handle)];
+					if ((buf.bindFlags & BINDING_INDEX_BUFFER) == 0 || offset > buf.size)
+						return false;
+
+					if (currentIndexBuffer.id != handle || currentIndexBufferOffset != offset)
+					{
+						currentIndexBuffer.id = handle;
+						currentIndexBufferOffset = offset;
+						stats.IndexBufferChanges++;
+					}
+				}
+				else if (drawcall.BaseVertex < 0)
+				{
+					return false;
+				}
+
+				// Resources
+				{
+					uint32_t handle = layoutHandle;
+					BindingLayoutNull& layout = bindingLayouts[blHandleAlloc.GetIndex(handle)];
+
+					for (uint32_t i = 0; i < layout.entryCount; i++)
+					{
+						auto& entry = layout.layout.table[i];
+						if (entry.Type == BINDING_SLOT_TYPE_CONSTANT)
+							stats.ConstantUpdates += (entry.Count == 0 ? 1 : entry.Count);
+						else if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+							i += entry.Count;
+					}
+
+					DescriptorCountNull count = {};
+
+					if (drawcall.HasBindingGroup)
+					{
+						uint32_t groupHandle = drawcall.BindingGroup.id;
+						if (!bgHandleAlloc.InUse(groupHandle))
+							return false;
+
+						BindingGroupNull& group = bindingGroups[bgHandleAlloc.GetIndex(groupHandle)];
+						if (group.layout.id != handle)
+							return false;
+
+						// a group already bound costs nothing
+						if (currentBindingGroup.id != groupHandle)
+						{
+							currentBindingGroup.id = groupHandle;
+							count = group.descriptors;
+							stats.BindingGroupChanges++;
+						}
+					}
+					else
+					{
+						currentBindingGroup.id = invalid_handle;
+						if (!CheckDescriptors(layout, drawcall.ResourceBindingData, count))
+							return false;
+					}
+
+					stats.ConstantBufferBindings += count.constantBuffers;
+					stats.ShaderResourceBindings += count.shaderResources;
+					stats.SamplerBindings += count.samplers;
+				}
+
+				// Render Target
+				{
+					TextureHandle rts[MaxRenderTargetBindingSlot];
+					uint32_t rtCount = drawcall.RenderTargetCount;
+					TextureHandle ds = { invalid_handle };
+
+					if (drawcall.RenderTargetCount > 0 || drawcall.HasDepthStencil)
+					{
+						if (rtCount > MaxRenderTargetBindingSlot)
+							return false;
+
+						for (uint32_t i = 0; i < rtCount; ++i)
+						{
+							uint32_t handle = drawcall.RenderTargets[i].id;
+							if (!texHandleAlloc.InUse(handle))
+								return false;
+							if ((textures[texHandleAlloc.GetIndex(handle)].bindFlags & BINDING_RENDER_TARGET) == 0)
+								return false;
+
+							rts[i].id = handle;
+						}
+
+						if (drawcall.HasDepthStencil)
+						{
+							uint32_t handle = drawcall.DepthStencil.id;
+							if (!texHandleAlloc.InUse(handle))
+								return false;
+							if ((textures[texHandleAlloc.GetIndex(handle)].bindFlags & BINDING_DEPTH_STENCIL) == 0)
+								return false;
+
+							ds.id = handle;
+						}
+					}
+					else
+					{
+						rts[0] = defaultColorBuffer;
+						rtCount = 1;
+						ds = defaultDepthStencilBuffer;
+					}
+
+					bool changed = (rtCount != currentRenderTargetCount || ds.id != currentDepthStencil.id);
+					for (uint32_t i = 0; i < rtCount && !changed; ++i)
+						changed = (rts[i].id != currentRenderTargets[i].id);
+
+					if (changed)
+					{
+						for (uint32_t i = 0; i < rtCount; ++i)
+							currentRenderTargets[i] = rts[i];
+						currentRenderTargetCount = rtCount;
+						currentDepthStencil = ds;
+						stats.RenderTargetChanges++;
+					}
+				}
+
+				return true;
+			}
+
+			// interface implementation
+#pragma region interface implementation
+
+			BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) override
+			{
+				uint32_t handle = blHandleAlloc.Alloc();
+
+				if (invalid_handle == handle)
+					return BindingLayoutHandle{ invalid_handle };
+
+				BindingLayoutNull& bl = bindingLayouts.Acquire(blHandleAlloc.GetIndex(handle));
+				if (!bl.Reset(layout))
+				{
+					blHandleAlloc.Free(handle);
+					return BindingLayoutHandle{ invalid_handle };
+				}
+
+				return BindingLayoutHandle{ handle };
+			}
+
+			void DestroyBindingLayout(BindingLayoutHandle handle) override
+			{
+				if (!blHandleAlloc.InUse(handle.id)) return;
+				DeferRelease(DEFERRED_BINDING_LAYOUT, blHandleAlloc, handle.id);
+			}
+
+			BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) override
+			{
+				if (!blHandleAlloc.InUse(layout.id) || nullptr == bindingData)
+					return BindingGroupHandle{ invalid_handle };
+
+				DescriptorCountNull count = {};
+				if (!CheckDescriptors(bindingLayouts[blHandleAlloc.GetIndex(layout.id)], bindingData, count))
+					return BindingGroupHandle{ invalid_handle };
+
+				uint32_t handle = bgHandleAlloc.Alloc();
+
+				if (invalid_handle == handle)
+					return BindingGroupHandle{ invalid_handle };
+
+				BindingGroupNull& group = bindingGroups.Acquire(bgHandleAlloc.GetIndex(handle));
+				group.layout = layout;
+				group.descriptors = count;
+
+				return BindingGroupHandle{ handle };
+			}
+
+			void DestroyBindingGroup(BindingGroupHandle handle) override
+			{
+				if (!bgHandleAlloc.InUse(handle.id)) return;
+				if (currentBindingGroup.id == handle.id)
+					currentBindingGroup.id = invalid_handle;
+				bgHandleAlloc.Free(handle.id);
+			}
+
+			PipelineStateHandle CreatePipelineState(const PipelineState& state) override
+			{
+				if (!blHandleAlloc.InUse(state.BindingLayout.id) ||
+					!vsHandleAlloc.InUse(state.VertexShader.id) ||
+					(invalid_handle != state.PixelShader.id && !psHandleAlloc.InUse(state.PixelShader.id)) ||
+					state.PrimitiveType >= NUM_PRIMITIVE_TYPE ||
+					!CheckVertexLayout(state.VertexLayout))
+				{
+					return PipelineStateHandle{ invalid_handle };
+				}
+
+				uint32_t handle = psoHandleAlloc.Alloc();
+
+				if (invalid_handle == handle) return PipelineStateHandle{ invalid_handle };
+
+				uint64_t vsHash = vertexShaders[vsHandleAlloc.GetIndex(state.VertexShader.id)].hash;
+				uint64_t psHash = invalid_handle != state.PixelShader.id ? pixelShaders[psHandleAlloc.GetIndex(state.PixelShader.id)].hash : 0;
+
+				bool created = false;
+				uint32_t shared = pipelineCache.Acquire(state, vsHash, psHash, created);
+				if (PipelineCache<PipelineCompileNull>::invalid_entry == shared)
+				{
+					psoHandleAlloc.Free(handle);
+					return PipelineStateHandle{ invalid_handle };
+				}
+
+				if (created)
+					pipelineCache.Compile(shared);
+
+				PipelineStateNull& pso = pipelineStates.Acquire(psoHandleAlloc.GetIndex(handle));
+				pso.shared = shared;
+				pso.bindingLayout = state.BindingLayout;
+				pso.vs = state.VertexShader;
+				pso.ps = state.PixelShader;
+				pso.primitiveType = state.PrimitiveType;
+
+				return PipelineStateHandle{ handle };
+			}
+
+			void DestroyPipelineState(PipelineStateHandle handle) override
+			{
+				if (!psoHandleAlloc.InUse(handle.id)) return;
+				if (currentPipelineState.id == handle.id)
+					currentPipelineState.id = invalid_handle;
+				DeferRelease(DEFERRED_PIPELINE_STATE, psoHandleAlloc, handle.id);
+			}
+
+			BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic) override
+			{
+				uint32_t handle = bufHandleAlloc.Alloc();
+
+				if (handle != invalid_handle)
+				{
+					BufferNull& buf = buffers.Acquire(bufHandleAlloc.GetIndex(handle));
+					buf.Reset(static_cast<uint32_t>(size), bindingFlags, dynamic);
+				}
+
+				return BufferHandle{ handle };
+			}
+
+			void DestroyBuffer(BufferHandle handle) override
+			{
+				if (!bufHandleAlloc.InUse(handle.id)) return;
+				DeferRelease(DEFERRED_BUFFER, bufHandleAlloc, handle.id);
+			}
+
+			void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				if (!bufHandleAlloc.InUse(handle.id)) return;
+				BufferNull& buf = buffers[bufHandleAlloc.GetIndex(handle.id)];
+
+				if (size > buf.size || nullptr == data)
+					return;
+
+				// same rules as the real backends for the view of the buffer
+				if (stride == 0)
+				{
+					if (format == FORMAT_AUTO)
+					{
+						stride = 4;
+						format = FORMAT_R8G8B8A8_UNORM;
+					}
+					else
+					{
+						stride = PixelFormatSizeTable[format];
+					}
+				}
+				else
+				{
+					format = FORMAT_AUTO;
+				}
+
+				buf.stride = static_cast<uint32_t>(stride);
+				buf.format = format;
+
+				stats.BufferBytesUpdated += size;
+			}
+
+			bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				if (!bufHandleAlloc.InUse(handle.id)) return false;
+				BufferNull& buf = buffers[bufHandleAlloc.GetIndex(handle.id)];
+
+				if (offset > buf.size || size > buf.size - offset || nullptr == data ||
+					(buf.bindFlags & BINDING_CONSTANT_BUFFER) != 0)
+					return false;
+
+				if (stride == 0)
+				{
+					if (format == FORMAT_AUTO)
+					{
+						stride = 4;
+						format = FORMAT_R8G8B8A8_UNORM;
+					}
+					else
+					{
+						stride = PixelFormatSizeTable[format];
+					}
+				}
+				else
+				{
+					format = FORMAT_AUTO;
+				}
+
+				buf.stride = static_cast<uint32_t>(stride);
+				buf.format = format;
+
+				stats.BufferBytesUpdated += size;
+
+				return true;
+			}
+
+			TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, bool dynamic) override
+			{
+				uint32_t handle = texHandleAlloc.Alloc();
+
+				if (handle != invalid_handle)
+				{
+					TextureNull& tex = textures.Acquire(texHandleAlloc.GetIndex(handle));
+					tex.Reset(type, format, bindFlags, width, height, depth, arraySize, mipLevels, dynamic);
+				}
+
+				return TextureHandle{ handle };
+			}
+
+			TextureHandle CreateTexture(const wchar_t* filename) override
+			{
+				if (nullptr == filename)
+					return TextureHandle{ invalid_handle };
+
+				// nothing is loaded, it stands for a 1x1 texture
+				return CreateTexture(TEXTURE_2D, FORMAT_R8G8B8A8_UNORM, BINDING_SHADER_RESOURCE, 1, 1, 1, 1, 1, false);
+			}
+
+			void DestroyTexture(TextureHandle handle) override
+			{
+				if (!texHandleAlloc.InUse(handle.id)) return;
+				DeferRelease(DEFERRED_TEXTURE, texHandleAlloc, handle.id);
+			}
+
+			// the handle is stale from now on, its slot waits for the simulated fence
+			template<typename Alloc>
+			void DeferRelease(DeferredObjectNull type, Alloc& alloc, uint32_t handle)
+			{
+				alloc.Retire(handle);
+				releaseQueue.Push(frameIndex, DeferredReleaseNull{ type, alloc.GetIndex(handle) });
+				stats.DeferredReleases++;
+			}
+
+			void ReleaseObject(const DeferredReleaseNull& obj)
+			{
+				switch (obj.type)
+				{
+				case DEFERRED_BINDING_LAYOUT:
+					blHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_PIPELINE_STATE:
+					if (pipelineCache.Release(pipelineStates[obj.index].shared))
+						pipelineCache.Free(pipelineStates[obj.index].shared);
+					psoHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_BUFFER:
+					bufHandleAlloc.Recycle(obj.index);
+					break;
+				case DEFERRED_TEXTURE:
+					texHandleAlloc.Recycle(obj.index);
+					break;
+				}
+				stats.RetiredReleases++;
+			}
+
+			void UpdateTexture(TextureHandle handle, size_t pitch, const void* data) override
+			{
+				if (!texHandleAlloc.InUse(handle.id) || nullptr == data) return;
+				stats.TextureUpdates++;
+			}
+
+			void Clear(TextureHandle handle, float color[4]) override
+			{
+				if (handle.id == invalid_handle)
+					handle = defaultColorBuffer;
+				if (!texHandleAlloc.InUse(handle.id))
+					return;
+				if ((textures[texHandleAlloc.GetIndex(handle.id)].bindFlags & BINDING_RENDER_TARGET) == 0)
+					return;
+
+				stats.Clears++;
+			}
+
+			void ClearDepth(TextureHandle handle, float depth) override
+			{
+				ClearDepthStencil(handle, depth, 0);
+			}
+
+			void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil) override
+			{
+				if (handle.id == invalid_handle)
+					handle = defaultDepthStencilBuffer;
+				if (!texHandleAlloc.InUse(handle.id))
+					return;
+				if ((textures[texHandleAlloc.GetIndex(handle.id)].bindFlags & BINDING_DEPTH_STENCIL) == 0)
+					return;
+
+				stats.Clears++;
+			}
+
+			SamplerHandle CreateSampler() override
+			{
+				return SamplerHandle{ sampHandleAlloc.Alloc() };
+			}
+
+			void DestroySampler(SamplerHandle handle) override
+			{
+				if (!sampHandleAlloc.InUse(handle.id)) return;
+				sampHandleAlloc.Free(handle.id);
+			}
+
+			VertexShaderHandle CreateVertexShader(const void* bytecode, size_t size) override
+			{
+				if (nullptr == bytecode || 0 == size)
+					return VertexShaderHandle{ invalid_handle };
+
+				uint32_t handle = vsHandleAlloc.Alloc();
+
+				if (handle != invalid_handle)
+				{
+					ShaderNull& shader = vertexShaders.Acquire(vsHandleAlloc.GetIndex(handle));
+					shader.size = size;
+					shader.hash = HashShaderBytecode(bytecode, size);
+				}
+
+				return VertexShaderHandle{ handle };
+			}
+
+			void DestroyVertexShader(VertexShaderHandle handle) override
+			{
+				if (!vsHandleAlloc.InUse(handle.id)) return;
+				vsHandleAlloc.Free(handle.id);
+			}
+
+			PixelShaderHandle CreatePixelShader(const void* bytecode, size_t size) override
+			{
+				if (nullptr == bytecode || 0 == size)
+					return PixelShaderHandle{ invalid_handle };
+
+				uint32_t handle = psHandleAlloc.Alloc();
+
+				if (handle != invalid_handle)
+				{
+					ShaderNull& shader = pixelShaders.Acquire(psHandleAlloc.GetIndex(handle));
+					shader.size = size;
+					shader.hash = HashShaderBytecode(bytecode, size);
+				}
+
+				return PixelShaderHandle{ handle };
+			}
+
+			void DestroyPixelShader(PixelShaderHandle handle) override
+			{
+				if (!psHandleAlloc.InUse(handle.id)) return;
+				psHandleAlloc.Free(handle.id);
+			}
+
+			void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) override
+			{
+				uint32_t layoutHandle = BindPipelineState(stateHandle);
+				if (invalid_handle == layoutHandle || !BindResources(layoutHandle, drawcall))
+				{
+					stats.DroppedDrawCalls++;
+					return;
+				}
+
+				stats.DrawCalls++;
+				stats.Instances += drawcall.InstanceCount > 0 ? drawcall.InstanceCount : 1;
+			}
+
+			void Submit(const DrawItem* items, size_t count) override
+			{
+				PipelineStateHandle stateHandle = { invalid_handle };
+				uint32_t layoutHandle = invalid_handle;
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					// the draw after next is brought in, then the records of the next one
+					if (i + 2 < count)
+						BAMBOO_PREFETCH(items[i + 2].Call);
+					if (i + 1 < count)
+						PrefetchDraw(*items[i + 1].Call);
+
+					const DrawCall& drawcall = *items[i].Call;
+
+					if (items[i].PipelineState.id != stateHandle.id || invalid_handle == layoutHandle)
+					{
+						stateHandle = items[i].PipelineState;
+						layoutHandle = BindPipelineState(stateHandle);
+					}
+
+					if (invalid_handle == layoutHandle || !BindResources(layoutHandle, drawcall))
+					{
+						stats.DroppedDrawCalls++;
+						continue;
+					}
+
+					stats.DrawCalls++;
+					stats.Instances += drawcall.InstanceCount > 0 ? drawcall.InstanceCount : 1;
+				}
+			}
+
+			void Present() override
+			{
+				stats.Presents++;
+
+				uint64_t completed = frameIndex > SimulatedFrameLatency ? frameIndex - SimulatedFrameLatency : 0;
+				frameIndex++;
+
+				releaseQueue.Retire(completed, [this](const DeferredReleaseNull& obj) { ReleaseObject(obj); });
+			}
+
+			void Shutdown() override
+			{
+				releaseQueue.Flush([this](const DeferredReleaseNull& obj) { ReleaseObject(obj); });
+
+				bindingLayouts.Release();
+				bindingGroups.Release();
+				pipelineStates.Release();
+				buffers.Release();
+				textures.Release();
+				vertexShaders.Release();
+				pixelShaders.Release();
+			}
+
+			// Statistics
+			void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const override
+			{
+				usage.BindingLayouts = blHandleAlloc.MemoryUsage() + bindingLayouts.MemoryUsage();
+				usage.BindingGroups = bgHandleAlloc.MemoryUsage() + bindingGroups.MemoryUsage();
+				usage.PipelineStates = psoHandleAlloc.MemoryUsage() + pipelineStates.MemoryUsage();
+				usage.Buffers = bufHandleAlloc.MemoryUsage() + buffers.MemoryUsage();
+				usage.Textures = texHandleAlloc.MemoryUsage() + textures.MemoryUsage();
+				usage.Samplers = sampHandleAlloc.MemoryUsage();
+				usage.VertexShaders = vsHandleAlloc.MemoryUsage() + vertexShaders.MemoryUsage();
+				usage.PixelShaders = psHandleAlloc.MemoryUsage() + pixelShaders.MemoryUsage();
+			}
+
+#pragma endregion
+			// interface end
+		};
+	}
+}
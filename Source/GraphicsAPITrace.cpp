@@ -0,0 +1,1113 @@
+#include "GraphicsAPITrace.h"
+#include "CommandStream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace bamboo
+{
+	namespace trace
+	{
+		// The file is a header and then the calls back to back. A call is its
+		// op, the size of what follows in bytes, then that, padded to 4 bytes.
+		// Everything is made of 32-bit words, in the byte order of the machine
+		// that recorded it. The draws are CommandStream words.
+		constexpr uint32_t TraceMagic = 0x43525442;		// "BTRC"
+		constexpr uint32_t TraceVersion = 1;
+
+		// written out when this much has piled up between two presents
+		constexpr size_t FlushSize = 16 * 1024 * 1024;
+
+		enum Op : uint32_t
+		{
+			OP_CREATE_BINDING_LAYOUT,		// handle, entries
+			OP_DESTROY_BINDING_LAYOUT,		// handle
+			OP_CREATE_BINDING_GROUP,		// handle, layout, binding data
+			OP_DESTROY_BINDING_GROUP,		// handle
+			OP_CREATE_PIPELINE_STATE,		// handle, PipelineState
+			OP_DESTROY_PIPELINE_STATE,		// handle
+			OP_CREATE_BUFFER,				// handle, size, binding flags, dynamic
+			OP_DESTROY_BUFFER,				// handle
+			OP_UPDATE_BUFFER,				// handle, stride, format, size, data
+			OP_UPDATE_BUFFER_REGION,		// handle, stride, format, offset, size, data
+			OP_CREATE_TEXTURE,				// handle, type, format, binding flags, width, height, depth, array size, mip levels, dynamic
+			OP_CREATE_TEXTURE_FROM_FILE,	// handle, length, file name in UTF-16
+			OP_DESTROY_TEXTURE,				// handle
+			OP_UPDATE_TEXTURE,				// handle, pitch, size, data
+			OP_CLEAR,						// handle, color
+			OP_CLEAR_DEPTH,					// handle, depth
+			OP_CLEAR_DEPTH_STENCIL,			// handle, depth, stencil
+			OP_CREATE_SAMPLER,				// handle
+			OP_DESTROY_SAMPLER,				// handle
+			OP_CREATE_VERTEX_SHADER,		// handle, size, bytecode
+			OP_DESTROY_VERTEX_SHADER,		// handle
+			OP_CREATE_PIXEL_SHADER,			// handle, size, bytecode
+			OP_DESTROY_PIXEL_SHADER,		// handle
+			OP_DRAW,						// one draw of a CommandStream
+			OP_SUBMIT,						// draw count, the draws of a CommandStream
+			OP_PRESENT,
+			NUM_OP
+		};
+
+		constexpr uint32_t HeaderWords = 2;		// magic, version
+		constexpr uint32_t CallHeaderWords = 2;	// op, size
+
+		inline uint32_t Words(size_t bytes)
+		{
+			return static_cast<uint32_t>((bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+		}
+
+		// whether the payload of a call has all the words its op reads
+		bool CheckCall(uint32_t op, const uint32_t* payload, uint32_t words)
+		{
+			auto has = [&](uint32_t fixed, uint32_t sizeIndex, uint32_t sizeScale)
+			{
+				if (words < fixed)
+					return false;
+				return invalid_handle == sizeIndex || words - fixed >= Words(static_cast<size_t>(payload[sizeIndex]) * sizeScale);
+			};
+
+			switch (op)
+			{
+			case OP_CREATE_BINDING_LAYOUT:
+			case OP_DESTROY_BINDING_LAYOUT:
+			case OP_DESTROY_BINDING_GROUP:
+			case OP_DESTROY_PIPELINE_STATE:
+			case OP_DESTROY_BUFFER:
+			case OP_DESTROY_TEXTURE:
+			case OP_CREATE_SAMPLER:
+			case OP_DESTROY_SAMPLER:
+			case OP_DESTROY_VERTEX_SHADER:
+			case OP_DESTROY_PIXEL_SHADER:
+				return has(1, invalid_handle, 0);
+			case OP_CREATE_BINDING_GROUP:
+				return has(2, invalid_handle, 0);
+			case OP_CREATE_PIPELINE_STATE:
+				return has(1 + Words(sizeof(PipelineState)), invalid_handle, 0);
+			case OP_CREATE_BUFFER:
+				return has(4, invalid_handle, 0);
+			case OP_UPDATE_BUFFER:
+				return has(4, 3, 1);
+			case OP_UPDATE_BUFFER_REGION:
+				return has(5, 4, 1);
+			case OP_CREATE_TEXTURE:
+				return has(10, invalid_handle, 0);
+			case OP_CREATE_TEXTURE_FROM_FILE:
+				return has(2, 1, sizeof(uint16_t));
+			case OP_UPDATE_TEXTURE:
+				return has(3, 2, 1);
+			case OP_CLEAR:
+				return has(5, invalid_handle, 0);
+			case OP_CLEAR_DEPTH:
+				return has(2, invalid_handle, 0);
+			case OP_CLEAR_DEPTH_STENCIL:
+				return has(3, invalid_handle, 0);
+			case OP_CREATE_VERTEX_SHADER:
+			case OP_CREATE_PIXEL_SHADER:
+				return has(2, 1, 1);
+			case OP_SUBMIT:
+				return has(1, invalid_handle, 0);
+			case OP_DRAW:
+			case OP_PRESENT:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// the binding data words of a layout, the same as in the backends: a
+		// table takes no space itself, its sub entries follow it. If slots isn't
+		// null it gets the CBV, SRV and sampler words, as offset | type << 16.
+		// entryCount gets the number of entries the layout is made of.
+		uint32_t WalkBindingLayout(const BindingLayout::Entry* entries, uint32_t maxEntryCount, uint32_t& entryCount, std::vector<uint32_t>* slots)
+		{
+			uint32_t offset = 0, i = 0;
+
+			auto addSlots = [&](uint32_t type, uint32_t count)
+			{
+				for (uint32_t j = 0; j < count; j++)
+				{
+					if (nullptr != slots && offset + j < MaxBindingDataSize)
+						slots->push_back((offset + j) | (type << 16));
+				}
+				offset += count;
+			};
+
+			for (; i < maxEntryCount; ++i)
+			{
+				auto& entry = entries[i];
+				if (entry.Type == BINDING_SLOT_TYPE_NONE)
+					break;
+
+				if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+				{
+					uint32_t count = entry.Count;
+					if (i + count >= maxEntryCount)
+						count = maxEntryCount - i - 1;
+
+					for (uint32_t j = 0; j < count; j++)
+					{
+						auto& subEntry = entries[i + j + 1];
+						addSlots(subEntry.Type, subEntry.Count);
+					}
+
+					i += count;
+				}
+				else if (entry.Type == BINDING_SLOT_TYPE_CONSTANT)
+				{
+					offset += (entry.Count == 0 ? 1 : entry.Count);
+				}
+				else
+				{
+					addSlots(entry.Type, entry.Count == 0 ? 1 : entry.Count);
+				}
+			}
+
+			entryCount = i;
+
+			return offset < MaxBindingDataSize ? offset : static_cast<uint32_t>(MaxBindingDataSize);
+		}
+
+
+		struct GraphicsAPITrace final : public GraphicsAPI
+		{
+			// what the recording needs to know of the objects created, by the
+			// slot index of their handle
+			struct BindingLayoutInfo
+			{
+				uint32_t				handle;
+				uint32_t				dataSize;		// in 32-bit words
+			};
+
+			struct TextureInfo
+			{
+				uint32_t				handle;
+				uint32_t				rows;			// in the data of UpdateTexture, 0 if not known
+			};
+
+			GraphicsAPI*				backend;
+			FILE*						file;
+			uint64_t					written;		// to the file
+
+			std::vector<uint32_t>		buffer;
+			size_t						callStart;
+
+			CommandStream				draws;
+
+			std::vector<BindingLayoutInfo>	bindingLayouts;
+			std::vector<TextureInfo>	textures;
+
+			GraphicsAPITrace()
+				:
+				backend(nullptr),
+				file(nullptr),
+				written(0),
+				callStart(0),
+				draws(false)
+			{
+			}
+
+			bool Init(GraphicsAPI* backend, const char* filename)
+			{
+				this->backend = backend;
+
+				file = fopen(filename, "wb");
+				if (nullptr == file)
+					return false;
+
+				buffer.reserve(FlushSize / sizeof(uint32_t));
+				buffer.push_back(TraceMagic);
+				buffer.push_back(TraceVersion);
+
+				return true;
+			}
+
+			void Flush()
+			{
+				if (nullptr == file || buffer.empty())
+					return;
+
+				fwrite(buffer.data(), sizeof(uint32_t), buffer.size(), file);
+				fflush(file);
+
+				written += buffer.size() * sizeof(uint32_t);
+				buffer.clear();
+			}
+
+			void Begin(Op op)
+			{
+				callStart = buffer.size();
+				buffer.push_back(op);
+				buffer.push_back(0);
+			}
+
+			void Write(uint32_t value)
+			{
+				buffer.push_back(value);
+			}
+
+			void Write(const void* data, size_t bytes)
+			{
+				size_t start = buffer.size();
+				buffer.resize(start + Words(bytes), 0);
+				if (bytes > 0)
+					memcpy(buffer.data() + start, data, bytes);
+			}
+
+			void End()
+			{
+				buffer[callStart + 1] = static_cast<uint32_t>((buffer.size() - callStart - CallHeaderWords) * sizeof(uint32_t));
+
+				if (buffer.size() * sizeof(uint32_t) >= FlushSize)
+					Flush();
+			}
+
+			void Record(Op op, uint32_t handle)
+			{
+				Begin(op);
+				Write(handle);
+				End();
+			}
+
+			template<typename T>
+			static T& Slot(std::vector<T>& infos, uint32_t handle)
+			{
+				uint32_t index = handle & HandleAlloc<>::indexMask;
+				if (index >= infos.size())
+					infos.resize(index + 1, T{ invalid_handle, 0 });
+				return infos[index];
+			}
+
+			template<typename T>
+			static const T* Find(const std::vector<T>& infos, uint32_t handle)
+			{
+				uint32_t index = handle & HandleAlloc<>::indexMask;
+				if (invalid_handle == handle || index >= infos.size() || infos[index].handle != handle)
+					return nullptr;
+				return &infos[index];
+			}
+
+			// interface begin
+#pragma region interface implementation
+
+			// Binding Layout
+			BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) override
+			{
+				BindingLayoutHandle handle = backend->CreateBindingLayout(layout);
+
+				uint32_t entryCount = 0;
+				uint32_t dataSize = WalkBindingLayout(layout.table, MaxBindingLayoutEntry, entryCount, nullptr);
+
+				Begin(OP_CREATE_BINDING_LAYOUT);
+				Write(handle.id);
+				Write(layout.table, entryCount * sizeof(BindingLayout::Entry));
+				End();
+
+				if (invalid_handle != handle.id)
+					Slot(bindingLayouts, handle.id) = BindingLayoutInfo{ handle.id, dataSize };
+
+				return handle;
+			}
+
+			void DestroyBindingLayout(BindingLayoutHandle handle) override
+			{
+				backend->DestroyBindingLayout(handle);
+				Record(OP_DESTROY_BINDING_LAYOUT, handle.id);
+			}
+
+			// Binding Groups
+			BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) override
+			{
+				BindingGroupHandle handle = backend->CreateBindingGroup(layout, bindingData);
+
+				const BindingLayoutInfo* info = Find(bindingLayouts, layout.id);
+
+				Begin(OP_CREATE_BINDING_GROUP);
+				Write(handle.id);
+				Write(layout.id);
+				if (nullptr != info && nullptr != bindingData)
+					Write(bindingData, info->dataSize * sizeof(uint32_t));
+				End();
+
+				return handle;
+			}
+
+			void DestroyBindingGroup(BindingGroupHandle handle) override
+			{
+				backend->DestroyBindingGroup(handle);
+				Record(OP_DESTROY_BINDING_GROUP, handle.id);
+			}
+
+			// Pipeline States
+			PipelineStateHandle CreatePipelineState(const PipelineState& state) override
+			{
+				PipelineStateHandle handle = backend->CreatePipelineState(state);
+
+				Begin(OP_CREATE_PIPELINE_STATE);
+				Write(handle.id);
+				Write(&state, sizeof(PipelineState));
+				End();
+
+				return handle;
+			}
+
+			void DestroyPipelineState(PipelineStateHandle handle) override
+			{
+				backend->DestroyPipelineState(handle);
+				Record(OP_DESTROY_PIPELINE_STATE, handle.id);
+			}
+
+			// Buffers
+			BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic) override
+			{
+				BufferHandle handle = backend->CreateBuffer(size, bindingFlags, dynamic);
+
+				Begin(OP_CREATE_BUFFER);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(size));
+				Write(bindingFlags);
+				Write(dynamic ? 1 : 0);
+				End();
+
+				return handle;
+			}
+
+			void DestroyBuffer(BufferHandle handle) override
+			{
+				backend->DestroyBuffer(handle);
+				Record(OP_DESTROY_BUFFER, handle.id);
+			}
+
+			void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				backend->UpdateBuffer(handle, size, data, stride, format);
+
+				if (nullptr == data)
+					size = 0;
+
+				Begin(OP_UPDATE_BUFFER);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(stride));
+				Write(format);
+				Write(static_cast<uint32_t>(size));
+				Write(data, size);
+				End();
+			}
+
+			bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				bool written = backend->UpdateBufferRegion(handle, offset, size, data, stride, format);
+
+				if (nullptr == data)
+					size = 0;
+
+				Begin(OP_UPDATE_BUFFER_REGION);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(stride));
+				Write(format);
+				Write(static_cast<uint32_t>(offset));
+				Write(static_cast<uint32_t>(size));
+				Write(data, size);
+				End();
+
+				return written;
+			}
+
+			// Textures
+			TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, bool dynamic) override
+			{
+				TextureHandle handle = backend->CreateTexture(type, format, bindFlags, width, height, depth, arraySize, mipLevels, dynamic);
+
+				Begin(OP_CREATE_TEXTURE);
+				Write(handle.id);
+				Write(type);
+				Write(format);
+				Write(bindFlags);
+				Write(width);
+				Write(height);
+				Write(depth);
+				Write(arraySize);
+				Write(mipLevels);
+				Write(dynamic ? 1 : 0);
+				End();
+
+				// UpdateTexture writes the first mip level of the first slice, or the whole volume
+				if (invalid_handle != handle.id)
+					Slot(textures, handle.id) = TextureInfo{ handle.id, type == TEXTURE_3D ? height * depth : height };
+
+				return handle;
+			}
+
+			TextureHandle CreateTexture(const wchar_t* filename) override
+			{
+				TextureHandle handle = backend->CreateTexture(filename);
+
+				uint32_t length = 0;
+				while (nullptr != filename && 0 != filename[length])
+					length++;
+
+				Begin(OP_CREATE_TEXTURE_FROM_FILE);
+				Write(handle.id);
+				Write(length);
+				for (uint32_t i = 0; i < length; i += 2)
+				{
+					uint32_t low = static_cast<uint16_t>(filename[i]);
+					uint32_t high = i + 1 < length ? static_cast<uint16_t>(filename[i + 1]) : 0;
+					Write(low | (high << 16));
+				}
+				End();
+
+				// the size isn't known here, its updates are recorded without data
+				if (invalid_handle != handle.id)
+					Slot(textures, handle.id) = TextureInfo{ handle.id, 0 };
+
+				return handle;
+			}
+
+			void DestroyTexture(TextureHandle handle) override
+			{
+				backend->DestroyTexture(handle);
+				Record(OP_DESTROY_TEXTURE, handle.id);
+			}
+
+			void UpdateTexture(TextureHandle handle, size_t pitch, const void* data) override
+			{
+				backend->UpdateTexture(handle, pitch, data);
+
+				const TextureInfo* info = Find(textures, handle.id);
+				size_t size = (nullptr != info && nullptr != data) ? pitch * info->rows : 0;
+
+				Begin(OP_UPDATE_TEXTURE);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(pitch));
+				Write(static_cast<uint32_t>(size));
+				Write(data, size);
+				End();
+			}
+
+			void Clear(TextureHandle handle, float color[4]) override
+			{
+				backend->Clear(handle, color);
+
+				Begin(OP_CLEAR);
+				Write(handle.id);
+				Write(color, sizeof(float) * 4);
+				End();
+			}
+
+			void ClearDepth(TextureHandle handle, float depth) override
+			{
+				backend->ClearDepth(handle, depth);
+
+				Begin(OP_CLEAR_DEPTH);
+				Write(handle.id);
+				Write(&depth, sizeof(float));
+				End();
+			}
+
+			void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil) override
+			{
+				backend->ClearDepthStencil(handle, depth, stencil);
+
+				Begin(OP_CLEAR_DEPTH_STENCIL);
+				Write(handle.id);
+				Write(&depth, sizeof(float));
+				Write(stencil);
+				End();
+			}
+
+			// Samplers
+			SamplerHandle CreateSampler() override
+			{
+				SamplerHandle handle = backend->CreateSampler();
+				Record(OP_CREATE_SAMPLER, handle.id);
+				return handle;
+			}
+
+			void DestroySampler(SamplerHandle handle) override
+			{
+				backend->DestroySampler(handle);
+				Record(OP_DESTROY_SAMPLER, handle.id);
+			}
+
+			// Shaders
+			VertexShaderHandle CreateVertexShader(const void* bytecode, size_t size) override
+			{
+				VertexShaderHandle handle = backend->CreateVertexShader(bytecode, size);
+
+				if (nullptr == bytecode)
+					size = 0;
+
+				Begin(OP_CREATE_VERTEX_SHADER);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(size));
+				Write(bytecode, size);
+				End();
+
+				return handle;
+			}
+
+			void DestroyVertexShader(VertexShaderHandle handle) override
+			{
+				backend->DestroyVertexShader(handle);
+				Record(OP_DESTROY_VERTEX_SHADER, handle.id);
+			}
+
+			PixelShaderHandle CreatePixelShader(const void* bytecode, size_t size) override
+			{
+				PixelShaderHandle handle = backend->CreatePixelShader(bytecode, size);
+
+				if (nullptr == bytecode)
+					size = 0;
+
+				Begin(OP_CREATE_PIXEL_SHADER);
+				Write(handle.id);
+				Write(static_cast<uint32_t>(size));
+				Write(bytecode, size);
+				End();
+
+				return handle;
+			}
+
+			void DestroyPixelShader(PixelShaderHandle handle) override
+			{
+				backend->DestroyPixelShader(handle);
+				Record(OP_DESTROY_PIXEL_SHADER, handle.id);
+			}
+
+			// Draw Functions
+			void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) override
+			{
+				backend->Draw(stateHandle, drawcall);
+
+				draws.Clear();
+				draws.Draw(stateHandle, drawcall);
+
+				Begin(OP_DRAW);
+				Write(draws.Data(), draws.Size());
+				End();
+			}
+
+			void Submit(const DrawItem* items, size_t count) override
+			{
+				backend->Submit(items, count);
+
+				draws.Clear();
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (nullptr != items[i].Call)
+						draws.Draw(items[i].PipelineState, *items[i].Call);
+				}
+
+				Begin(OP_SUBMIT);
+				Write(draws.DrawCount());
+				Write(draws.Data(), draws.Size());
+				End();
+			}
+
+			void Present() override
+			{
+				backend->Present();
+
+				Begin(OP_PRESENT);
+				End();
+
+				Flush();
+			}
+
+			void Shutdown() override
+			{
+				backend->Shutdown();
+
+				Flush();
+				if (nullptr != file)
+				{
+					fclose(file);
+					file = nullptr;
+				}
+
+				bindingLayouts.clear();
+				textures.clear();
+			}
+
+			// Statistics
+			void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const override
+			{
+				backend->GetResourceMemoryUsage(usage);
+			}
+
+			const GraphicsAPI* GetBackendAPI() const override
+			{
+				return static_cast<const GraphicsAPI*>(backend)->GetBackendAPI();
+			}
+
+#pragma endregion
+			// interface end
+		};
+
+
+		GraphicsAPI* InitGraphicsAPITrace(GraphicsAPI* backend, const char* filename)
+		{
+			if (nullptr == backend || nullptr == filename)
+				return nullptr;
+
+			GraphicsAPITrace* api = new GraphicsAPITrace();
+			if (!api->Init(backend, filename))
+			{
+				delete api;
+				return nullptr;
+			}
+
+			return api;
+		}
+
+		GraphicsAPI* GetBackend(GraphicsAPI* api)
+		{
+			return static_cast<GraphicsAPITrace*>(api)->backend;
+		}
+
+		uint64_t GetTraceSize(const GraphicsAPI* api)
+		{
+			const GraphicsAPITrace* trace = static_cast<const GraphicsAPITrace*>(api);
+			return trace->written + trace->buffer.size() * sizeof(uint32_t);
+		}
+
+
+		void Replay::HandleMap::Clear()
+		{
+			recorded.clear();
+			replayed.clear();
+		}
+
+		void Replay::HandleMap::Add(uint32_t recordedHandle, uint32_t replayedHandle)
+		{
+			uint32_t index = recordedHandle & HandleAlloc<>::indexMask;
+			if (index >= recorded.size())
+			{
+				recorded.resize(index + 1, invalid_handle);
+				replayed.resize(index + 1, invalid_handle);
+			}
+
+			recorded[index] = recordedHandle;
+			replayed[index] = replayedHandle;
+		}
+
+		void Replay::HandleMap::Remove(uint32_t recordedHandle)
+		{
+			uint32_t index = recordedHandle & HandleAlloc<>::indexMask;
+			if (invalid_handle == recordedHandle || index >= recorded.size() || recorded[index] != recordedHandle)
+				return;
+
+			recorded[index] = invalid_handle;
+			replayed[index] = invalid_handle;
+		}
+
+		uint32_t Replay::HandleMap::Find(uint32_t recordedHandle) const
+		{
+			uint32_t index = recordedHandle & HandleAlloc<>::indexMask;
+			if (invalid_handle == recordedHandle || index >= recorded.size() || recorded[index] != recordedHandle)
+				return invalid_handle;
+
+			return replayed[index];
+		}
+
+		Replay::Replay()
+			:
+			begin(nullptr),
+			cursor(nullptr),
+			end(nullptr),
+			frame(0),
+			api(nullptr),
+			drawcall{}
+		{
+		}
+
+		bool Replay::Load(const void* data, size_t size)
+		{
+			begin = cursor = end = nullptr;
+			frames.clear();
+
+			if (nullptr == data || size < HeaderWords * sizeof(uint32_t) || size % sizeof(uint32_t) != 0)
+				return false;
+
+			const uint32_t* words = reinterpret_cast<const uint32_t*>(data);
+			const uint32_t* last = words + size / sizeof(uint32_t);
+
+			if (words[0] != TraceMagic || words[1] != TraceVersion)
+				return false;
+
+			const uint32_t* p = words + HeaderWords;
+			bool frameStart = true;
+
+			while (p < last)
+			{
+				if (last - p < CallHeaderWords ||
+					static_cast<size_t>(last - p - CallHeaderWords) < Words(p[1]) ||
+					!CheckCall(p[0], p + CallHeaderWords, Words(p[1])))
+					return false;
+
+				if (frameStart)
+				{
+					frames.push_back(static_cast<uint32_t>(p - words));
+					frameStart = false;
+				}
+
+				frameStart = (p[0] == OP_PRESENT);
+				p += CallHeaderWords + Words(p[1]);
+			}
+
+			begin = words;
+			end = last;
+
+			return true;
+		}
+
+		void Replay::Begin(GraphicsAPI* api)
+		{
+			this->api = api;
+
+			cursor = frames.empty() ? end : begin + frames[0];
+			frame = 0;
+
+			bindingLayouts.Clear();
+			bindingGroups.Clear();
+			pipelineStates.Clear();
+			buffers.Clear();
+			textures.Clear();
+			samplers.Clear();
+			vertexShaders.Clear();
+			pixelShaders.Clear();
+
+			layoutSlots.clear();
+			stateLayouts.clear();
+		}
+
+		bool Replay::RunFrame(double& cpuTime)
+		{
+			if (nullptr == api || frame >= frames.size())
+				return false;
+
+			auto start = std::chrono::steady_clock::now();
+
+			while (cursor < end)
+			{
+				uint32_t op = cursor[0];
+				uint32_t size = cursor[1];
+
+				Execute(op, cursor + CallHeaderWords, size);
+				cursor += CallHeaderWords + Words(size);
+
+				if (op == OP_PRESENT)
+					break;
+			}
+
+			auto stop = std::chrono::steady_clock::now();
+			cpuTime = std::chrono::duration<double, std::milli>(stop - start).count();
+
+			frame++;
+
+			return true;
+		}
+
+		void Replay::DestroyAll(HandleMap& map, void(*destroy)(GraphicsAPI*, uint32_t))
+		{
+			for (uint32_t handle : map.replayed)
+			{
+				if (invalid_handle != handle)
+					destroy(api, handle);
+			}
+			map.Clear();
+		}
+
+		void Replay::End()
+		{
+			if (nullptr == api)
+				return;
+
+			// the users first, groups and pipeline states before what they refer to
+			DestroyAll(bindingGroups, [](GraphicsAPI* api, uint32_t handle) { api->DestroyBindingGroup(BindingGroupHandle{ handle }); });
+			DestroyAll(pipelineStates, [](GraphicsAPI* api, uint32_t handle) { api->DestroyPipelineState(PipelineStateHandle{ handle }); });
+			DestroyAll(bindingLayouts, [](GraphicsAPI* api, uint32_t handle) { api->DestroyBindingLayout(BindingLayoutHandle{ handle }); });
+			DestroyAll(vertexShaders, [](GraphicsAPI* api, uint32_t handle) { api->DestroyVertexShader(VertexShaderHandle{ handle }); });
+			DestroyAll(pixelShaders, [](GraphicsAPI* api, uint32_t handle) { api->DestroyPixelShader(PixelShaderHandle{ handle }); });
+			DestroyAll(samplers, [](GraphicsAPI* api, uint32_t handle) { api->DestroySampler(SamplerHandle{ handle }); });
+			DestroyAll(textures, [](GraphicsAPI* api, uint32_t handle) { api->DestroyTexture(TextureHandle{ handle }); });
+			DestroyAll(buffers, [](GraphicsAPI* api, uint32_t handle) { api->DestroyBuffer(BufferHandle{ handle }); });
+
+			layoutSlots.clear();
+			stateLayouts.clear();
+
+			api = nullptr;
+		}
+
+		void Replay::TranslateBindingData(uint32_t layout, uint32_t* data) const
+		{
+			uint32_t index = layout & HandleAlloc<>::indexMask;
+			if (invalid_handle == bindingLayouts.Find(layout) || index >= layoutSlots.size())
+				return;
+
+			for (uint32_t slot : layoutSlots[index])
+			{
+				uint32_t& word = data[slot & 0xffff];
+				uint32_t type = slot >> 16;
+
+				if (type == BINDING_SLOT_TYPE_CBV)
+				{
+					word = buffers.Find(word);
+				}
+				else if (type == BINDING_SLOT_TYPE_SRV)
+				{
+					if (invalid_handle != word && (word & binding_buffer_flag) != 0u)
+					{
+						uint32_t handle = buffers.Find(word & ~binding_buffer_flag);
+						word = invalid_handle != handle ? (handle | binding_buffer_flag) : invalid_handle;
+					}
+					else
+					{
+						word = textures.Find(word);
+					}
+				}
+				else if (type == BINDING_SLOT_TYPE_SAMPLER)
+				{
+					word = samplers.Find(word);
+				}
+			}
+		}
+
+		void Replay::TranslateDrawCall(uint32_t stateHandle, DrawCall& drawcall) const
+		{
+			for (uint32_t i = 0; i < drawcall.VertexBufferCount; ++i)
+				drawcall.VertexBuffers[i].id = buffers.Find(drawcall.VertexBuffers[i].id);
+
+			if (drawcall.HasIndexBuffer)
+				drawcall.IndexBuffer.id = buffers.Find(drawcall.IndexBuffer.id);
+
+			for (uint32_t i = 0; i < drawcall.RenderTargetCount; ++i)
+				drawcall.RenderTargets[i].id = textures.Find(drawcall.RenderTargets[i].id);
+
+			if (drawcall.HasDepthStencil)
+				drawcall.DepthStencil.id = textures.Find(drawcall.DepthStencil.id);
+
+			if (drawcall.HasBindingGroup)
+			{
+				drawcall.BindingGroup.id = bindingGroups.Find(drawcall.BindingGroup.id);
+			}
+			else if (invalid_handle != pipelineStates.Find(stateHandle))
+			{
+				TranslateBindingData(stateLayouts[stateHandle & HandleAlloc<>::indexMask], drawcall.ResourceBindingData);
+			}
+		}
+
+		void Replay::Execute(uint32_t op, const uint32_t* payload, uint32_t size)
+		{
+			// a creation that failed when recorded is not made again
+			uint32_t recorded = size >= sizeof(uint32_t) ? payload[0] : invalid_handle;
+			const uint32_t* p = payload + 1;
+
+			switch (op)
+			{
+			case OP_CREATE_BINDING_LAYOUT:
+				if (invalid_handle != recorded)
+				{
+					BindingLayout layout = {};
+					uint32_t entryCount = (size - sizeof(uint32_t)) / sizeof(BindingLayout::Entry);
+					if (entryCount > MaxBindingLayoutEntry)
+						entryCount = MaxBindingLayoutEntry;
+					memcpy(layout.table, p, entryCount * sizeof(BindingLayout::Entry));
+
+					uint32_t index = recorded & HandleAlloc<>::indexMask;
+					if (index >= layoutSlots.size())
+						layoutSlots.resize(index + 1);
+					layoutSlots[index].clear();
+					uint32_t layoutEntryCount = 0;
+					WalkBindingLayout(layout.table, entryCount, layoutEntryCount, &layoutSlots[index]);
+
+					bindingLayouts.Add(recorded, api->CreateBindingLayout(layout).id);
+				}
+				break;
+			case OP_DESTROY_BINDING_LAYOUT:
+				api->DestroyBindingLayout(BindingLayoutHandle{ bindingLayouts.Find(recorded) });
+				bindingLayouts.Remove(recorded);
+				break;
+			case OP_CREATE_BINDING_GROUP:
+				if (invalid_handle != recorded)
+				{
+					uint32_t layout = p[0];
+					uint32_t data[MaxBindingDataSize] = {};
+					uint32_t dataSize = (size - 2 * sizeof(uint32_t)) / sizeof(uint32_t);
+					if (dataSize > MaxBindingDataSize)
+						dataSize = MaxBindingDataSize;
+					memcpy(data, p + 1, dataSize * sizeof(uint32_t));
+
+					TranslateBindingData(layout, data);
+
+					BindingLayoutHandle layoutHandle = { bindingLayouts.Find(layout) };
+					bindingGroups.Add(recorded, api->CreateBindingGroup(layoutHandle, data).id);
+				}
+				break;
+			case OP_DESTROY_BINDING_GROUP:
+				api->DestroyBindingGroup(BindingGroupHandle{ bindingGroups.Find(recorded) });
+				bindingGroups.Remove(recorded);
+				break;
+			case OP_CREATE_PIPELINE_STATE:
+				if (invalid_handle != recorded)
+				{
+					PipelineState state;
+					memcpy(&state, p, sizeof(PipelineState));
+
+					uint32_t index = recorded & HandleAlloc<>::indexMask;
+					if (index >= stateLayouts.size())
+						stateLayouts.resize(index + 1, invalid_handle);
+					stateLayouts[index] = state.BindingLayout.id;
+
+					state.BindingLayout.id = bindingLayouts.Find(state.BindingLayout.id);
+					state.VertexShader.id = vertexShaders.Find(state.VertexShader.id);
+					state.PixelShader.id = pixelShaders.Find(state.PixelShader.id);
+
+					pipelineStates.Add(recorded, api->CreatePipelineState(state).id);
+				}
+				break;
+			case OP_DESTROY_PIPELINE_STATE:
+				api->DestroyPipelineState(PipelineStateHandle{ pipelineStates.Find(recorded) });
+				pipelineStates.Remove(recorded);
+				break;
+			case OP_CREATE_BUFFER:
+				if (invalid_handle != recorded)
+					buffers.Add(recorded, api->CreateBuffer(p[0], p[1], 0 != p[2]).id);
+				break;
+			case OP_DESTROY_BUFFER:
+				api->DestroyBuffer(BufferHandle{ buffers.Find(recorded) });
+				buffers.Remove(recorded);
+				break;
+			case OP_UPDATE_BUFFER:
+				if (0 != p[2])
+					api->UpdateBuffer(BufferHandle{ buffers.Find(recorded) }, p[2], p + 3, p[0], static_cast<PixelFormat>(p[1]));
+				break;
+			case OP_UPDATE_BUFFER_REGION:
+				if (0 != p[3])
+					api->UpdateBufferRegion(BufferHandle{ buffers.Find(recorded) }, p[2], p[3], p + 4, p[0], static_cast<PixelFormat>(p[1]));
+				break;
+			case OP_CREATE_TEXTURE:
+				if (invalid_handle != recorded)
+				{
+					TextureHandle handle = api->CreateTexture(static_cast<TextureType>(p[0]), static_cast<PixelFormat>(p[1]),
+						p[2], p[3], p[4], p[5], p[6], p[7], 0 != p[8]);
+					textures.Add(recorded, handle.id);
+				}
+				break;
+			case OP_CREATE_TEXTURE_FROM_FILE:
+				if (invalid_handle != recorded)
+				{
+					uint32_t length = p[0];
+					std::vector<wchar_t> filename(length + 1, 0);
+					for (uint32_t i = 0; i < length; ++i)
+						filename[i] = static_cast<wchar_t>((p[1 + i / 2] >> ((i % 2) * 16)) & 0xffff);
+
+					textures.Add(recorded, api->CreateTexture(filename.data()).id);
+				}
+				break;
+			case OP_DESTROY_TEXTURE:
+				api->DestroyTexture(TextureHandle{ textures.Find(recorded) });
+				textures.Remove(recorded);
+				break;
+			case OP_UPDATE_TEXTURE:
+				// the updates of textures loaded from files were recorded without their data
+				if (0 != p[1])
+					api->UpdateTexture(TextureHandle{ textures.Find(recorded) }, p[0], p + 2);
+				break;
+			case OP_CLEAR:
+				{
+					float color[4];
+					memcpy(color, p, sizeof(color));
+					api->Clear(TextureHandle{ textures.Find(recorded) }, color);
+				}
+				break;
+			case OP_CLEAR_DEPTH:
+				{
+					float depth;
+					memcpy(&depth, p, sizeof(float));
+					api->ClearDepth(TextureHandle{ textures.Find(recorded) }, depth);
+				}
+				break;
+			case OP_CLEAR_DEPTH_STENCIL:
+				{
+					float depth;
+					memcpy(&depth, p, sizeof(float));
+					api->ClearDepthStencil(TextureHandle{ textures.Find(recorded) }, depth, static_cast<uint8_t>(p[1]));
+				}
+				break;
+			case OP_CREATE_SAMPLER:
+				if (invalid_handle != recorded)
+					samplers.Add(recorded, api->CreateSampler().id);
+				break;
+			case OP_DESTROY_SAMPLER:
+				api->DestroySampler(SamplerHandle{ samplers.Find(recorded) });
+				samplers.Remove(recorded);
+				break;
+			case OP_CREATE_VERTEX_SHADER:
+				if (invalid_handle != recorded)
+					vertexShaders.Add(recorded, api->CreateVertexShader(p + 1, p[0]).id);
+				break;
+			case OP_DESTROY_VERTEX_SHADER:
+				api->DestroyVertexShader(VertexShaderHandle{ vertexShaders.Find(recorded) });
+				vertexShaders.Remove(recorded);
+				break;
+			case OP_CREATE_PIXEL_SHADER:
+				if (invalid_handle != recorded)
+					pixelShaders.Add(recorded, api->CreatePixelShader(p + 1, p[0]).id);
+				break;
+			case OP_DESTROY_PIXEL_SHADER:
+				api->DestroyPixelShader(PixelShaderHandle{ pixelShaders.Find(recorded) });
+				pixelShaders.Remove(recorded);
+				break;
+			case OP_DRAW:
+				{
+					CommandStreamReader reader(payload, size / sizeof(uint32_t));
+					PipelineStateHandle stateHandle;
+					if (const DrawCall* recordedCall = reader.Next(stateHandle))
+					{
+						drawcall = *recordedCall;
+						TranslateDrawCall(stateHandle.id, drawcall);
+						api->Draw(PipelineStateHandle{ pipelineStates.Find(stateHandle.id) }, drawcall);
+					}
+				}
+				break;
+			case OP_SUBMIT:
+				{
+					uint32_t count = payload[0];
+					if (batchCalls.size() < count)
+					{
+						batchCalls.resize(count);
+						batchItems.resize(count);
+					}
+
+					CommandStreamReader reader(payload + 1, size / sizeof(uint32_t) - 1);
+					PipelineStateHandle stateHandle;
+					for (uint32_t i = 0; i < count; ++i)
+					{
+						const DrawCall* recordedCall = reader.Next(stateHandle);
+						if (nullptr == recordedCall)
+						{
+							count = i;
+							break;
+						}
+
+						batchCalls[i] = *recordedCall;
+						TranslateDrawCall(stateHandle.id, batchCalls[i]);
+						batchItems[i].PipelineState.id = pipelineStates.Find(stateHandle.id);
+						batchItems[i].Call = &batchCalls[i];
+					}
+
+					api->Submit(batchItems.data(), count);
+				}
+				break;
+			case OP_PRESENT:
+				api->Present();
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+
+#include <vector>
+
+
+namespace bamboo
+{
+	namespace trace
+	{
+		// A GraphicsAPI forwarding to another one, the backend, after writing
+		// the call to a trace file: the creations with their descriptions and
+		// the handles the backend returned, the updates with their data, the
+		// clears, the draws encoded as in a CommandStream, and the presents.
+		// Submit of a CommandStream goes through Draw, as in the backends, so
+		// it is recorded draw by draw. The file is flushed at every Present and
+		// closed by Shutdown. Returns nullptr if the file can't be opened, the
+		// backend stays owned by the caller.
+		GraphicsAPI* InitGraphicsAPITrace(GraphicsAPI* backend, const char* filename);
+
+		// api must have been created by InitGraphicsAPITrace
+		GraphicsAPI* GetBackend(GraphicsAPI* api);
+		uint64_t GetTraceSize(const GraphicsAPI* api);		// in bytes, written so far
+
+		// Plays a trace back on a GraphicsAPI, a frame at a time, as fast as
+		// the backend takes the calls. The handles in the trace are replaced by
+		// the ones the creations return during the replay, so it can run on
+		// any backend, the null one included. A frame ends with a Present, the
+		// calls after the last one make a frame of their own.
+		class Replay
+		{
+		public:
+			Replay();
+
+			Replay(const Replay&) = delete;
+			Replay& operator=(const Replay&) = delete;
+
+			// checks how the trace is cut into calls and finds its frames, false if
+			// it isn't a trace or is cut short. data must be 4 byte aligned and
+			// outlive the replay.
+			bool Load(const void* data, size_t size);
+
+			uint32_t GetFrameCount() const { return static_cast<uint32_t>(frames.size()); }
+
+			// starts over from the first frame
+			void Begin(GraphicsAPI* api);
+
+			// makes the calls of the next frame, false at the end of the trace.
+			// cpuTime is what they took, in milliseconds, decoding the draws
+			// and replacing their handles included.
+			bool RunFrame(double& cpuTime);
+
+			// destroys what the trace left alive, so it can be played again on
+			// the same GraphicsAPI
+			void End();
+
+		private:
+			// recorded handle to replayed handle, by the slot index of the recorded one
+			struct HandleMap
+			{
+				std::vector<uint32_t>	recorded;
+				std::vector<uint32_t>	replayed;
+
+				void Clear();
+				void Add(uint32_t recordedHandle, uint32_t replayedHandle);
+				void Remove(uint32_t recordedHandle);
+				uint32_t Find(uint32_t recordedHandle) const;
+			};
+
+			void Execute(uint32_t op, const uint32_t* payload, uint32_t size);
+			void TranslateBindingData(uint32_t layout, uint32_t* data) const;
+			void TranslateDrawCall(uint32_t stateHandle, DrawCall& drawcall) const;
+			void DestroyAll(HandleMap& map, void(*destroy)(GraphicsAPI*, uint32_t));
+
+			const uint32_t*				begin;
+			const uint32_t*				cursor;
+			const uint32_t*				end;
+			std::vector<uint32_t>		frames;		// offset of the first call of each frame, in words
+			uint32_t					frame;
+
+			GraphicsAPI*				api;
+
+			HandleMap					bindingLayouts;
+			HandleMap					bindingGroups;
+			HandleMap					pipelineStates;
+			HandleMap					buffers;
+			HandleMap					textures;
+			HandleMap					samplers;
+			HandleMap					vertexShaders;
+			HandleMap					pixelShaders;
+
+			// by the slot index of the recorded handles. The CBV, SRV and sampler
+			// words of the binding data of each layout, as offset | type << 16.
+			std::vector<std::vector<uint32_t>>	layoutSlots;
+			std::vector<uint32_t>		stateLayouts;		// recorded binding layout of each pipeline state
+
+			DrawCall					drawcall;
+			std::vector<DrawCall>		batchCalls;
+			std::vector<DrawItem>		batchItems;
+		};
+	}
+}
@@ -0,0 +1,998 @@
+#include "GraphicsAPIValidation.h"
+
+#include <cstring>
+#include <vector>
+
+namespace bamboo
+{
+	namespace validation
+	{
+		// the objects of a type the backend has created, by the slot index of their handle
+		template<typename T>
+		struct RecordTable
+		{
+			std::vector<T>				records;
+
+			void Init(size_t capacity)
+			{
+				records.clear();
+				records.resize(capacity);
+			}
+
+			T* Find(uint32_t handle)
+			{
+				if (invalid_handle == handle)
+					return nullptr;
+
+				uint32_t index = handle & HandleAlloc<>::indexMask;
+				if (index >= records.size() || records[index].handle != handle)
+					return nullptr;
+
+				return &records[index];
+			}
+
+			T& Add(uint32_t handle)
+			{
+				uint32_t index = handle & HandleAlloc<>::indexMask;
+				if (index >= records.size())
+					records.resize(index + 1);
+
+				records[index] = T();
+				records[index].handle = handle;
+				return records[index];
+			}
+
+			void Remove(uint32_t handle)
+			{
+				if (T* record = Find(handle))
+					*record = T();
+			}
+		};
+
+		// what a binding group holds, to find the groups using a resource
+		enum ResourceKind
+		{
+			RESOURCE_BUFFER,
+			RESOURCE_TEXTURE,
+			RESOURCE_SAMPLER,
+		};
+
+		inline uint64_t ResourceKey(ResourceKind kind, uint32_t handle)
+		{
+			return (static_cast<uint64_t>(kind) << 32) | handle;
+		}
+
+		struct BindingLayoutRecord
+		{
+			uint32_t					handle = invalid_handle;
+			uint32_t					entryCount;
+			uint32_t					dataSize;		// in bytes
+			BindingLayout				layout;
+			uint32_t					offsets[MaxBindingLayoutEntry];
+		};
+
+		struct BindingGroupRecord
+		{
+			uint32_t					handle = invalid_handle;
+			BindingLayoutHandle			layout;
+			bool						stale;			// something in it was destroyed
+			std::vector<uint64_t>		resources;
+		};
+
+		struct PipelineStateRecord
+		{
+			uint32_t					handle = invalid_handle;
+			BindingLayoutHandle			layout;
+			VertexShaderHandle			vs;
+			PixelShaderHandle			ps;
+			uint32_t					vertexBufferCount;	// slots read by the vertex layout
+			bool						stale;
+		};
+
+		struct BufferRecord
+		{
+			uint32_t					handle = invalid_handle;
+			size_t						size;
+			uint32_t					bindFlags;
+		};
+
+		struct TextureRecord
+		{
+			uint32_t					handle = invalid_handle;
+			uint32_t					bindFlags;
+		};
+
+		// samplers and shaders, only their lifetime is checked
+		struct ObjectRecord
+		{
+			uint32_t					handle = invalid_handle;
+		};
+
+
+		struct GraphicsAPIValidation final : public GraphicsAPI
+		{
+			GraphicsAPI*				backend;
+
+			RecordTable<BindingLayoutRecord>	bindingLayouts;
+			RecordTable<BindingGroupRecord>		bindingGroups;
+			RecordTable<PipelineStateRecord>	pipelineStates;
+			RecordTable<BufferRecord>			buffers;
+			RecordTable<TextureRecord>			textures;
+			RecordTable<ObjectRecord>			samplers;
+			RecordTable<ObjectRecord>			vertexShaders;
+			RecordTable<ObjectRecord>			pixelShaders;
+
+			// the draws of a Submit that pass, handed to the backend in one batch
+			std::vector<DrawItem>		validItems;
+
+			ErrorCallback				callback;
+			void*						userData;
+
+			Statistics					stats;
+
+			void Init(GraphicsAPI* backend, const ResourceLimits& limits)
+			{
+				this->backend = backend;
+
+				bindingLayouts.Init(limits.BindingLayoutCount);
+				bindingGroups.Init(limits.BindingGroupCount);
+				pipelineStates.Init(limits.PipelineStateCount);
+				buffers.Init(limits.BufferCount);
+				textures.Init(limits.TextureCount);
+				samplers.Init(limits.SamplerCount);
+				vertexShaders.Init(limits.VertexShaderCount);
+				pixelShaders.Init(limits.PixelShaderCount);
+
+				callback = nullptr;
+				userData = nullptr;
+
+				ResetStatistics();
+			}
+
+			void ResetStatistics()
+			{
+				memset(&stats, 0, sizeof(stats));
+			}
+
+			// always false, for returning from the checks
+			bool Fail(Error error, const char* function)
+			{
+				stats.Errors[error]++;
+				if (nullptr != callback)
+					callback(error, function, userData);
+				return false;
+			}
+
+			bool CheckBuffer(uint32_t handle, uint32_t bindFlag, const char* function)
+			{
+				const BufferRecord* buf = buffers.Find(handle);
+				if (nullptr == buf)
+					return Fail(ERROR_INVALID_HANDLE, function);
+				if ((buf->bindFlags & bindFlag) == 0)
+					return Fail(ERROR_BINDING_FLAGS, function);
+				return true;
+			}
+
+			bool CheckTexture(uint32_t handle, uint32_t bindFlag, const char* function)
+			{
+				const TextureRecord* tex = textures.Find(handle);
+				if (nullptr == tex)
+					return Fail(ERROR_INVALID_HANDLE, function);
+				if ((tex->bindFlags & bindFlag) == 0)
+					return Fail(ERROR_BINDING_FLAGS, function);
+				return true;
+			}
+
+			// same data layout as the backends, a table takes no space itself, its
+			// sub entries follow it. A table is either samplers or views, as the
+			// descriptor heaps of D3D12 are.
+			bool CheckBindingLayout(const BindingLayout& layout, BindingLayoutRecord& record, const char* function)
+			{
+				uint32_t offset = 0, i = 0;
+				record.entryCount = MaxBindingLayoutEntry;
+
+				for (; i < MaxBindingLayoutEntry; ++i)
+				{
+					auto& entry = layout.table[i];
+					if (entry.Type == BINDING_SLOT_TYPE_NONE)
+					{
+						record.entryCount = i;
+						break;
+					}
+
+					if (entry.Type > BINDING_SLOT_TYPE_SAMPLER || entry.ShaderVisibility > SHADER_VISIBILITY_PIXEL)
+						return Fail(ERROR_INVALID_ARGUMENT, function);
+
+					record.offsets[i] = offset;
+
+					if (entry.Type == BINDING_SLOT_TYPE_TABLE)
+					{
+						if (0 == entry.Count || i + entry.Count >= MaxBindingLayoutEntry)
+							return Fail(ERROR_INVALID_ARGUMENT, function);
+
+						bool hasSamplers = false, hasViews = false;
+						for (uint32_t j = 0; j < entry.Count; j++)
+						{
+							auto& subEntry = layout.table[i + j + 1];
+							if (subEntry.Type == BINDING_SLOT_TYPE_SAMPLER)
+								hasSamplers = true;
+							else if (subEntry.Type == BINDING_SLOT_TYPE_CBV || subEntry.Type == BINDING_SLOT_TYPE_SRV)
+								hasViews = true;
+							else
+								return Fail(ERROR_INVALID_ARGUMENT, function);
+
+							record.offsets[i + j + 1] = offset;
+							offset += subEntry.Count * 4u;
+						}
+
+						if (hasSamplers && hasViews)
+							return Fail(ERROR_INVALID_ARGUMENT, function);
+
+						i += entry.Count;
+					}
+					else
+					{
+						offset += 4u * (entry.Count == 0 ? 1 : entry.Count);
+					}
+				}
+
+				if (offset > sizeof(DrawCall::ResourceBindingData))
+					return Fail(ERROR_OUT_OF_RANGE, function);
+
+				record.dataSize = offset;
+				record.layout = layout;
+
+				return true;
+			}
+
+			// a single descriptor of a CBV, SRV or sampler slot, root SRVs outside of
+			// tables take buffers only, as root descriptors of D3D12 do
+			bool CheckDescriptor(uint32_t type, bool inTable, uint32_t data, std::vector<uint64_t>* resources, const char* function)
+			{
+				if (invalid_handle == data)
+					return true;
+
+				if (type == BINDING_SLOT_TYPE_CBV)
+				{
+					if (!CheckBuffer(data, BINDING_CONSTANT_BUFFER, function))
+						return false;
+					if (nullptr != resources)
+						resources->push_back(ResourceKey(RESOURCE_BUFFER, data));
+				}
+				else if (type == BINDING_SLOT_TYPE_SRV)
+				{
+					if ((data & binding_buffer_flag) != 0u)
+					{
+						uint32_t handle = data & ~binding_buffer_flag;
+						if (!CheckBuffer(handle, BINDING_SHADER_RESOURCE, function))
+							return false;
+						if (nullptr != resources)
+							resources->push_back(ResourceKey(RESOURCE_BUFFER, handle));
+					}
+					else
+					{
+						if (!inTable)
+							return Fail(ERROR_BINDING_DATA, function);
+						if (!CheckTexture(data, BINDING_SHADER_RESOURCE, function))
+							return false;
+						if (nullptr != resources)
+							resources->push_back(ResourceKey(RESOURCE_TEXTURE, data));
+					}
+				}
+				else if (type == BINDING_SLOT_TYPE_SAMPLER)
+				{
+					if (nullptr == samplers.Find(data))
+						return Fail(ERROR_INVALID_HANDLE, function);
+					if (nullptr != resources)
+						resources->push_back(ResourceKey(RESOURCE_SAMPLER, data));
+				}
+
+				return true;
+			}
+
+			// the CBV, SRV and sampler slots of a layout, root constants are skipped.
+			// The resources are added to resources if given.
+			bool CheckBindingData(const BindingLayoutRecord& layout, const uint32_t* bindingData, std::vector<uint64_t>* resources, const char* function)
+			{
+				const uint8_t* pData = reinterpret_cast<const uint8_t*>(bindingData);
+
+				for (uint32_t i = 0; i < layout.entryCount; i++)
+				{
+					auto& entry = layout.layout.table[i];
+					uint32_t entryCount = (entry.Count == 0 ? 1 : entry.Count);
+
+					switch (entry.Type)
+					{
+					case BINDING_SLOT_TYPE_CBV:
+					case BINDING_SLOT_TYPE_SRV:
+					case BINDING_SLOT_TYPE_SAMPLER:
+						for (uint32_t j = 0; j < entryCount; j++)
+						{
+							uint32_t offset = layout.offsets[i] + 4u * j;
+							uint32_t data = *reinterpret_cast<const uint32_t*>((pData + offset));
+							if (!CheckDescriptor(entry.Type, false, data, resources, function))
+								return false;
+						}
+						break;
+					case BINDING_SLOT_TYPE_TABLE:
+						for (uint32_t iRange = 0; iRange < entry.Count; iRange++)
+						{
+							auto& subEntry = layout.layout.table[i + iRange + 1];
+
+							for (uint32_t iRangeEntry = 0; iRangeEntry < subEntry.Count; iRangeEntry++)
+							{
+								uint32_t offset = layout.offsets[i + iRange + 1] + 4u * iRangeEntry;
+								uint32_t data = *reinterpret_cast<const uint32_t*>((pData + offset));
+								if (!CheckDescriptor(subEntry.Type, true, data, resources, function))
+									return false;
+							}
+						}
+						i += entry.Count;
+						break;
+					default:
+						break;
+					}
+				}
+
+				return true;
+			}
+
+			// the elements of a vertex buffer slot are either all per vertex or all
+			// per instance with the same step rate, as the input assemblers want
+			bool CheckVertexLayout(const VertexLayout& layout, uint32_t& vertexBufferCount, const char* function)
+			{
+				if (layout.ElementCount > MaxVertexInputElement)
+					return Fail(ERROR_OUT_OF_RANGE, function);
+
+				int stepRates[MaxVertexBufferBindingSlot];
+				for (size_t i = 0; i < MaxVertexBufferBindingSlot; ++i)
+					stepRates[i] = -1;
+
+				vertexBufferCount = 0;
+				for (size_t i = 0; i < layout.ElementCount; ++i)
+				{
+					const VertexInputElement& elem = layout.Elements[i];
+					if (elem.BindingSlot >= MaxVertexBufferBindingSlot)
+						return Fail(ERROR_OUT_OF_RANGE, function);
+
+					int& stepRate = stepRates[elem.BindingSlot];
+					if (stepRate >= 0 && stepRate != elem.InstanceStepRate)
+						return Fail(ERROR_INVALID_ARGUMENT, function);
+					stepRate = elem.InstanceStepRate;
+
+					if (elem.BindingSlot + 1u > vertexBufferCount)
+						vertexBufferCount = elem.BindingSlot + 1u;
+				}
+
+				return true;
+			}
+
+			bool CheckDraw(PipelineStateHandle stateHandle, const DrawCall& drawcall, const char* function)
+			{
+				const PipelineStateRecord* pso = pipelineStates.Find(stateHandle.id);
+				if (nullptr == pso || pso->stale)
+					return Fail(ERROR_INVALID_HANDLE, function);
+
+				// kept alive by the pipeline state, or it would be stale
+				const BindingLayoutRecord& layout = *bindingLayouts.Find(pso->layout.id);
+
+				if (drawcall.VertexBufferCount > MaxVertexBufferBindingSlot ||
+					drawcall.RenderTargetCount > MaxRenderTargetBindingSlot ||
+					drawcall.BindingDataSize > MaxBindingDataSize)
+					return Fail(ERROR_OUT_OF_RANGE, function);
+
+				// Input Assembly
+				if (drawcall.VertexBufferCount < pso->vertexBufferCount)
+					return Fail(ERROR_INVALID_ARGUMENT, function);
+
+				for (uint32_t i = 0; i < drawcall.VertexBufferCount; ++i)
+				{
+					uint32_t handle = drawcall.VertexBuffers[i].id;
+					if (!CheckBuffer(handle, BINDING_VERTEX_BUFFER, function))
+						return false;
+					if (drawcall.VertexBufferOffsets[i] > buffers.Find(handle)->size)
+						return Fail(ERROR_OUT_OF_RANGE, function);
+				}
+
+				if (drawcall.HasIndexBuffer)
+				{
+					uint32_t handle = drawcall.IndexBuffer.id;
+					if (!CheckBuffer(handle, BINDING_INDEX_BUFFER, function))
+						return false;
+					if (drawcall.IndexBufferOffset > buffers.Find(handle)->size)
+						return Fail(ERROR_OUT_OF_RANGE, function);
+				}
+				else if (drawcall.BaseVertex < 0)
+				{
+					return Fail(ERROR_INVALID_ARGUMENT, function);
+				}
+
+				// Resources
+				if (drawcall.BindingDataSize * 4u > layout.dataSize)
+					return Fail(ERROR_BINDING_DATA, function);
+
+				if (drawcall.HasBindingGroup)
+				{
+					const BindingGroupRecord* group = bindingGroups.Find(drawcall.BindingGroup.id);
+					if (nullptr == group || group->stale)
+						return Fail(ERROR_INVALID_HANDLE, function);
+					if (group->layout.id != pso->layout.id)
+						return Fail(ERROR_BINDING_GROUP_LAYOUT, function);
+				}
+				else if (!CheckBindingData(layout, drawcall.ResourceBindingData, nullptr, function))
+				{
+					return false;
+				}
+
+				// Render Target
+				for (uint32_t i = 0; i < drawcall.RenderTargetCount; ++i)
+				{
+					if (!CheckTexture(drawcall.RenderTargets[i].id, BINDING_RENDER_TARGET, function))
+						return false;
+				}
+
+				if (drawcall.HasDepthStencil && !CheckTexture(drawcall.DepthStencil.id, BINDING_DEPTH_STENCIL, function))
+					return false;
+
+				return true;
+			}
+
+			// makes the groups holding the resource stale, true if there were any
+			bool InvalidateGroups(uint64_t key)
+			{
+				bool found = false;
+				for (auto& group : bindingGroups.records)
+				{
+					if (invalid_handle == group.handle)
+						continue;
+
+					for (uint64_t resource : group.resources)
+					{
+						if (resource == key)
+						{
+							group.stale = true;
+							found = true;
+							break;
+						}
+					}
+				}
+				return found;
+			}
+
+			// interface implementation
+#pragma region interface implementation
+
+			BindingLayoutHandle CreateBindingLayout(const BindingLayout& layout) override
+			{
+				BindingLayoutRecord record;
+				if (!CheckBindingLayout(layout, record, "CreateBindingLayout"))
+				{
+					stats.DroppedCalls++;
+					return BindingLayoutHandle{ invalid_handle };
+				}
+
+				BindingLayoutHandle handle = backend->CreateBindingLayout(layout);
+				if (invalid_handle != handle.id)
+				{
+					BindingLayoutRecord& bl = bindingLayouts.Add(handle.id);
+					record.handle = handle.id;
+					bl = record;
+				}
+
+				return handle;
+			}
+
+			void DestroyBindingLayout(BindingLayoutHandle handle) override
+			{
+				if (nullptr == bindingLayouts.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyBindingLayout");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				bool referenced = false;
+				for (auto& pso : pipelineStates.records)
+				{
+					if (invalid_handle != pso.handle && pso.layout.id == handle.id)
+						pso.stale = referenced = true;
+				}
+				for (auto& group : bindingGroups.records)
+				{
+					if (invalid_handle != group.handle && group.layout.id == handle.id)
+						group.stale = referenced = true;
+				}
+				if (referenced)
+					Fail(ERROR_STILL_REFERENCED, "DestroyBindingLayout");
+
+				backend->DestroyBindingLayout(handle);
+				bindingLayouts.Remove(handle.id);
+			}
+
+			BindingGroupHandle CreateBindingGroup(BindingLayoutHandle layout, const uint32_t* bindingData) override
+			{
+				const BindingLayoutRecord* bl = bindingLayouts.Find(layout.id);
+				std::vector<uint64_t> resources;
+
+				bool valid = false;
+				if (nullptr == bl)
+					Fail(ERROR_INVALID_HANDLE, "CreateBindingGroup");
+				else if (nullptr == bindingData)
+					Fail(ERROR_INVALID_ARGUMENT, "CreateBindingGroup");
+				else
+					valid = CheckBindingData(*bl, bindingData, &resources, "CreateBindingGroup");
+
+				if (!valid)
+				{
+					stats.DroppedCalls++;
+					return BindingGroupHandle{ invalid_handle };
+				}
+
+				BindingGroupHandle handle = backend->CreateBindingGroup(layout, bindingData);
+				if (invalid_handle != handle.id)
+				{
+					BindingGroupRecord& group = bindingGroups.Add(handle.id);
+					group.layout = layout;
+					group.stale = false;
+					group.resources.swap(resources);
+				}
+
+				return handle;
+			}
+
+			void DestroyBindingGroup(BindingGroupHandle handle) override
+			{
+				if (nullptr == bindingGroups.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyBindingGroup");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->DestroyBindingGroup(handle);
+				bindingGroups.Remove(handle.id);
+			}
+
+			PipelineStateHandle CreatePipelineState(const PipelineState& state) override
+			{
+				uint32_t vertexBufferCount = 0;
+
+				bool valid = false;
+				if (nullptr == bindingLayouts.Find(state.BindingLayout.id) ||
+					nullptr == vertexShaders.Find(state.VertexShader.id) ||
+					(invalid_handle != state.PixelShader.id && nullptr == pixelShaders.Find(state.PixelShader.id)))
+					Fail(ERROR_INVALID_HANDLE, "CreatePipelineState");
+				else if (state.PrimitiveType >= NUM_PRIMITIVE_TYPE || state.CullMode > CULL_BACK)
+					Fail(ERROR_INVALID_ARGUMENT, "CreatePipelineState");
+				else if (state.RenderTargetCount > MaxRenderTargetBindingSlot)
+					Fail(ERROR_OUT_OF_RANGE, "CreatePipelineState");
+				else
+					valid = CheckVertexLayout(state.VertexLayout, vertexBufferCount, "CreatePipelineState");
+
+				if (!valid)
+				{
+					stats.DroppedCalls++;
+					return PipelineStateHandle{ invalid_handle };
+				}
+
+				PipelineStateHandle handle = backend->CreatePipelineState(state);
+				if (invalid_handle != handle.id)
+				{
+					PipelineStateRecord& pso = pipelineStates.Add(handle.id);
+					pso.layout = state.BindingLayout;
+					pso.vs = state.VertexShader;
+					pso.ps = state.PixelShader;
+					pso.vertexBufferCount = vertexBufferCount;
+					pso.stale = false;
+				}
+
+				return handle;
+			}
+
+			void DestroyPipelineState(PipelineStateHandle handle) override
+			{
+				if (nullptr == pipelineStates.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyPipelineState");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->DestroyPipelineState(handle);
+				pipelineStates.Remove(handle.id);
+			}
+
+			BufferHandle CreateBuffer(size_t size, uint32_t bindingFlags, bool dynamic) override
+			{
+				if (0 == size || size > UINT32_MAX)
+				{
+					Fail(ERROR_OUT_OF_RANGE, "CreateBuffer");
+					stats.DroppedCalls++;
+					return BufferHandle{ invalid_handle };
+				}
+
+				BufferHandle handle = backend->CreateBuffer(size, bindingFlags, dynamic);
+				if (invalid_handle != handle.id)
+				{
+					BufferRecord& buf = buffers.Add(handle.id);
+					buf.size = size;
+					buf.bindFlags = bindingFlags;
+				}
+
+				return handle;
+			}
+
+			void DestroyBuffer(BufferHandle handle) override
+			{
+				if (nullptr == buffers.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyBuffer");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				if (InvalidateGroups(ResourceKey(RESOURCE_BUFFER, handle.id)))
+					Fail(ERROR_STILL_REFERENCED, "DestroyBuffer");
+
+				backend->DestroyBuffer(handle);
+				buffers.Remove(handle.id);
+			}
+
+			void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				const BufferRecord* buf = buffers.Find(handle.id);
+
+				bool valid = false;
+				if (nullptr == buf)
+					Fail(ERROR_INVALID_HANDLE, "UpdateBuffer");
+				else if (nullptr == data || format >= NUM_PIXEL_FORMAT)
+					Fail(ERROR_INVALID_ARGUMENT, "UpdateBuffer");
+				else if (size > buf->size)
+					Fail(ERROR_OUT_OF_RANGE, "UpdateBuffer");
+				else
+					valid = true;
+
+				if (!valid)
+				{
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->UpdateBuffer(handle, size, data, stride, format);
+			}
+
+			bool UpdateBufferRegion(BufferHandle handle, size_t offset, size_t size, const void* data, size_t stride, PixelFormat format) override
+			{
+				const BufferRecord* buf = buffers.Find(handle.id);
+
+				bool valid = false;
+				if (nullptr == buf)
+					Fail(ERROR_INVALID_HANDLE, "UpdateBufferRegion");
+				else if ((buf->bindFlags & BINDING_CONSTANT_BUFFER) != 0)
+					Fail(ERROR_BINDING_FLAGS, "UpdateBufferRegion");
+				else if (nullptr == data || format >= NUM_PIXEL_FORMAT)
+					Fail(ERROR_INVALID_ARGUMENT, "UpdateBufferRegion");
+				else if (offset > buf->size || size > buf->size - offset)
+					Fail(ERROR_OUT_OF_RANGE, "UpdateBufferRegion");
+				else
+					valid = true;
+
+				if (!valid)
+				{
+					stats.DroppedCalls++;
+					return false;
+				}
+
+				return backend->UpdateBufferRegion(handle, offset, size, data, stride, format);
+			}
+
+			TextureHandle CreateTexture(TextureType type, PixelFormat format, uint32_t bindFlags, uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, bool dynamic) override
+			{
+				if (type > TEXTURE_CUBE || format >= NUM_PIXEL_FORMAT ||
+					0 == width || 0 == height || 0 == depth || 0 == arraySize || 0 == mipLevels)
+				{
+					Fail(ERROR_INVALID_ARGUMENT, "CreateTexture");
+					stats.DroppedCalls++;
+					return TextureHandle{ invalid_handle };
+				}
+
+				TextureHandle handle = backend->CreateTexture(type, format, bindFlags, width, height, depth, arraySize, mipLevels, dynamic);
+				if (invalid_handle != handle.id)
+					textures.Add(handle.id).bindFlags = bindFlags;
+
+				return handle;
+			}
+
+			TextureHandle CreateTexture(const wchar_t* filename) override
+			{
+				if (nullptr == filename)
+				{
+					Fail(ERROR_INVALID_ARGUMENT, "CreateTexture");
+					stats.DroppedCalls++;
+					return TextureHandle{ invalid_handle };
+				}
+
+				// loaded textures are only ever read by the shaders
+				TextureHandle handle = backend->CreateTexture(filename);
+				if (invalid_handle != handle.id)
+					textures.Add(handle.id).bindFlags = BINDING_SHADER_RESOURCE;
+
+				return handle;
+			}
+
+			void DestroyTexture(TextureHandle handle) override
+			{
+				if (nullptr == textures.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyTexture");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				if (InvalidateGroups(ResourceKey(RESOURCE_TEXTURE, handle.id)))
+					Fail(ERROR_STILL_REFERENCED, "DestroyTexture");
+
+				backend->DestroyTexture(handle);
+				textures.Remove(handle.id);
+			}
+
+			void UpdateTexture(TextureHandle handle, size_t pitch, const void* data) override
+			{
+				bool valid = false;
+				if (nullptr == textures.Find(handle.id))
+					Fail(ERROR_INVALID_HANDLE, "UpdateTexture");
+				else if (nullptr == data)
+					Fail(ERROR_INVALID_ARGUMENT, "UpdateTexture");
+				else
+					valid = true;
+
+				if (!valid)
+				{
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->UpdateTexture(handle, pitch, data);
+			}
+
+			// invalid_handle stands for the default render targets
+			void Clear(TextureHandle handle, float color[4]) override
+			{
+				if (invalid_handle != handle.id && !CheckTexture(handle.id, BINDING_RENDER_TARGET, "Clear"))
+				{
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->Clear(handle, color);
+			}
+
+			void ClearDepth(TextureHandle handle, float depth) override
+			{
+				if (invalid_handle != handle.id && !CheckTexture(handle.id, BINDING_DEPTH_STENCIL, "ClearDepth"))
+				{
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->ClearDepth(handle, depth);
+			}
+
+			void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil) override
+			{
+				if (invalid_handle != handle.id && !CheckTexture(handle.id, BINDING_DEPTH_STENCIL, "ClearDepthStencil"))
+				{
+					stats.DroppedCalls++;
+					return;
+				}
+
+				backend->ClearDepthStencil(handle, depth, stencil);
+			}
+
+			SamplerHandle CreateSampler() override
+			{
+				SamplerHandle handle = backend->CreateSampler();
+				if (invalid_handle != handle.id)
+					samplers.Add(handle.id);
+
+				return handle;
+			}
+
+			void DestroySampler(SamplerHandle handle) override
+			{
+				if (nullptr == samplers.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroySampler");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				if (InvalidateGroups(ResourceKey(RESOURCE_SAMPLER, handle.id)))
+					Fail(ERROR_STILL_REFERENCED, "DestroySampler");
+
+				backend->DestroySampler(handle);
+				samplers.Remove(handle.id);
+			}
+
+			VertexShaderHandle CreateVertexShader(const void* bytecode, size_t size) override
+			{
+				if (nullptr == bytecode || 0 == size)
+				{
+					Fail(ERROR_INVALID_ARGUMENT, "CreateVertexShader");
+					stats.DroppedCalls++;
+					return VertexShaderHandle{ invalid_handle };
+				}
+
+				VertexShaderHandle handle = backend->CreateVertexShader(bytecode, size);
+				if (invalid_handle != handle.id)
+					vertexShaders.Add(handle.id);
+
+				return handle;
+			}
+
+			void DestroyVertexShader(VertexShaderHandle handle) override
+			{
+				if (nullptr == vertexShaders.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyVertexShader");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				bool referenced = false;
+				for (auto& pso : pipelineStates.records)
+				{
+					if (invalid_handle != pso.handle && pso.vs.id == handle.id)
+						pso.stale = referenced = true;
+				}
+				if (referenced)
+					Fail(ERROR_STILL_REFERENCED, "DestroyVertexShader");
+
+				backend->DestroyVertexShader(handle);
+				vertexShaders.Remove(handle.id);
+			}
+
+			PixelShaderHandle CreatePixelShader(const void* bytecode, size_t size) override
+			{
+				if (nullptr == bytecode || 0 == size)
+				{
+					Fail(ERROR_INVALID_ARGUMENT, "CreatePixelShader");
+					stats.DroppedCalls++;
+					return PixelShaderHandle{ invalid_handle };
+				}
+
+				PixelShaderHandle handle = backend->CreatePixelShader(bytecode, size);
+				if (invalid_handle != handle.id)
+					pixelShaders.Add(handle.id);
+
+				return handle;
+			}
+
+			void DestroyPixelShader(PixelShaderHandle handle) override
+			{
+				if (nullptr == pixelShaders.Find(handle.id))
+				{
+					Fail(ERROR_INVALID_HANDLE, "DestroyPixelShader");
+					stats.DroppedCalls++;
+					return;
+				}
+
+				bool referenced = false;
+				for (auto& pso : pipelineStates.records)
+				{
+					if (invalid_handle != pso.handle && pso.ps.id == handle.id)
+						pso.stale = referenced = true;
+				}
+				if (referenced)
+					Fail(ERROR_STILL_REFERENCED, "DestroyPixelShader");
+
+				backend->DestroyPixelShader(handle);
+				pixelShaders.Remove(handle.id);
+			}
+
+			void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall) override
+			{
+				if (!CheckDraw(stateHandle, drawcall, "Draw"))
+				{
+					stats.DroppedDrawCalls++;
+					return;
+				}
+
+				backend->Draw(stateHandle, drawcall);
+			}
+
+			void Submit(const DrawItem* items, size_t count) override
+			{
+				validItems.clear();
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (nullptr == items[i].Call)
+					{
+						Fail(ERROR_INVALID_ARGUMENT, "Submit");
+						stats.DroppedDrawCalls++;
+						continue;
+					}
+
+					if (!CheckDraw(items[i].PipelineState, *items[i].Call, "Submit"))
+					{
+						stats.DroppedDrawCalls++;
+						continue;
+					}
+
+					validItems.push_back(items[i]);
+				}
+
+				if (!validItems.empty())
+					backend->Submit(validItems.data(), validItems.size());
+			}
+
+			void Present() override
+			{
+				backend->Present();
+			}
+
+			void Shutdown() override
+			{
+				backend->Shutdown();
+
+				bindingLayouts.records.clear();
+				bindingGroups.records.clear();
+				pipelineStates.records.clear();
+				buffers.records.clear();
+				textures.records.clear();
+				samplers.records.clear();
+				vertexShaders.records.clear();
+				pixelShaders.records.clear();
+			}
+
+			// Statistics
+			void GetResourceMemoryUsage(ResourceMemoryUsage& usage) const override
+			{
+				backend->GetResourceMemoryUsage(usage);
+			}
+
+			const GraphicsAPI* GetBackendAPI() const override
+			{
+				return static_cast<const GraphicsAPI*>(backend)->GetBackendAPI();
+			}
+
+#pragma endregion
+			// interface end
+		};
+
+
+		GraphicsAPI* InitGraphicsAPIValidation(GraphicsAPI* backend, const ResourceLimits& limits)
+		{
+			if (nullptr == backend)
+				return nullptr;
+
+			GraphicsAPIValidation* api = new GraphicsAPIValidation();
+			api->Init(backend, limits);
+
+			return api;
+		}
+
+		void GetStatistics(const GraphicsAPI* api, Statistics& stats)
+		{
+			stats = static_cast<const GraphicsAPIValidation*>(api)->stats;
+		}
+
+		void ResetStatistics(GraphicsAPI* api)
+		{
+			static_cast<GraphicsAPIValidation*>(api)->ResetStatistics();
+		}
+
+		void SetErrorCallback(GraphicsAPI* api, ErrorCallback callback, void* userData)
+		{
+			GraphicsAPIValidation* validation = static_cast<GraphicsAPIValidation*>(api);
+			validation->callback = callback;
+			validation->userData = userData;
+		}
+
+		GraphicsAPI* GetBackend(GraphicsAPI* api)
+		{
+			return static_cast<GraphicsAPIValidation*>(api)->backend;
+		}
+	}
+}
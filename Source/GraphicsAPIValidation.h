@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+
+
+namespace bamboo
+{
+	namespace validation
+	{
+		enum Error
+		{
+			ERROR_INVALID_HANDLE,			// never created, destroyed already, or refers to something destroyed
+			ERROR_BINDING_FLAGS,			// the resource was not created for the way it is used
+			ERROR_BINDING_DATA,				// the binding data doesn't agree with the binding layout
+			ERROR_BINDING_GROUP_LAYOUT,		// the group was made for another layout than the pipeline state's
+			ERROR_OUT_OF_RANGE,				// an offset or a size beyond a buffer, a count beyond the limits
+			ERROR_INVALID_ARGUMENT,			// a malformed layout, a null pointer, a missing vertex buffer
+			ERROR_STILL_REFERENCED,			// destroyed while a pipeline state or binding group uses it
+			NUM_VALIDATION_ERROR
+		};
+
+		// what the validation layer has caught since the last ResetStatistics
+		struct Statistics
+		{
+			uint32_t					Errors[NUM_VALIDATION_ERROR];
+			uint32_t					DroppedDrawCalls;
+			uint32_t					DroppedCalls;			// other than draws, not passed to the backend
+		};
+
+		// called for every error, function is the name of the GraphicsAPI entry point
+		typedef void(*ErrorCallback)(Error error, const char* function, void* userData);
+
+		// A GraphicsAPI forwarding to another one, the backend, after checking
+		// every call against its own records of what was created: handle
+		// lifetimes, the binding flags of the resources, the binding data and
+		// groups of the draws against the binding layouts. A call that fails is
+		// counted, reported to the callback and not passed on, except for the
+		// destruction of a resource still in use, which is passed on and makes
+		// the pipeline states and groups using it invalid from then on.
+		//
+		// The backends don't check what a draw binds, only assert it, so this
+		// is what debug and test runs go through. InitGraphicsAPI adds it when
+		// BAMBOO_GRAPHICS_VALIDATION is 1. The backend stays owned by the
+		// caller, its own statistics functions take either, they look through
+		// this with GraphicsAPI::GetBackendAPI.
+		GraphicsAPI* InitGraphicsAPIValidation(GraphicsAPI* backend, const ResourceLimits& limits);
+
+		// api must have been created by InitGraphicsAPIValidation
+		void GetStatistics(const GraphicsAPI* api, Statistics& stats);
+		void ResetStatistics(GraphicsAPI* api);
+		void SetErrorCallback(GraphicsAPI* api, ErrorCallback callback, void* userData);
+		GraphicsAPI* GetBackend(GraphicsAPI* api);
+	}
+}
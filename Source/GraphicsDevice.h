@@ -0,0 +1,166 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+
+#include <cassert>
+
+// A build that only ever runs on one backend can name it here, the draw path
+// then calls into the backend directly instead of through the vtable. It is
+// ignored when the backend is behind the validation layer, and GraphicsDevice
+// asserts when it is behind the trace layer.
+//#define BAMBOO_STATIC_BACKEND Direct3D11
+
+// the backend classes, so their methods can be called and inlined. The
+// Direct3D ones are only pulled in when one of them can be the static backend
+#if defined(_WIN32) && defined(BAMBOO_STATIC_BACKEND)
+#include "GraphicsAPIDX11Impl.h"
+#include "GraphicsAPIDX12Impl.h"
+#endif
+#include "GraphicsAPINullImpl.h"
+
+namespace bamboo
+{
+	// whatever InitGraphicsAPI returned, through the virtual functions
+	struct VirtualBackend
+	{
+		static bool Accepts(const GraphicsAPI* api)
+		{
+			return true;
+		}
+
+		static void Draw(GraphicsAPI* api, PipelineStateHandle stateHandle, const DrawCall& drawcall)
+		{
+			api->Draw(stateHandle, drawcall);
+		}
+
+		static void Submit(GraphicsAPI* api, const DrawItem* items, size_t count)
+		{
+			api->Submit(items, count);
+		}
+
+		static void UpdateBuffer(GraphicsAPI* api, BufferHandle handle, size_t size, const void* data, size_t stride, PixelFormat format)
+		{
+			api->UpdateBuffer(handle, size, data, stride, format);
+		}
+
+		static void Clear(GraphicsAPI* api, TextureHandle handle, float color[4])
+		{
+			api->Clear(handle, color);
+		}
+
+		static void ClearDepthStencil(GraphicsAPI* api, TextureHandle handle, float depth, uint8_t stencil)
+		{
+			api->ClearDepthStencil(handle, depth, stencil);
+		}
+	};
+
+	// one backend known at compile time, api must have been created by its
+	// Init function, not wrapped in the validation or the trace layer. The
+	// calls go straight to the final class, which the compiler can inline.
+	template<GraphicsAPIType type>
+	struct StaticBackend;
+
+#define BAMBOO_STATIC_BACKEND_ENTRIES(cls) \
+		static bool Accepts(const GraphicsAPI* api) \
+		{ \
+			return api->GetBackendAPI() == api; \
+		} \
+		static void Draw(GraphicsAPI* api, PipelineStateHandle stateHandle, const DrawCall& drawcall) \
+		{ \
+			static_cast<cls*>(api)->cls::Draw(stateHandle, drawcall); \
+		} \
+		static void Submit(GraphicsAPI* api, const DrawItem* items, size_t count) \
+		{ \
+			static_cast<cls*>(api)->cls::Submit(items, count); \
+		} \
+		static void UpdateBuffer(GraphicsAPI* api, BufferHandle handle, size_t size, const void* data, size_t stride, PixelFormat format) \
+		{ \
+			static_cast<cls*>(api)->cls::UpdateBuffer(handle, size, data, stride, format); \
+		} \
+		static void Clear(GraphicsAPI* api, TextureHandle handle, float color[4]) \
+		{ \
+			static_cast<cls*>(api)->cls::Clear(handle, color); \
+		} \
+		static void ClearDepthStencil(GraphicsAPI* api, TextureHandle handle, float depth, uint8_t stencil) \
+		{ \
+			static_cast<cls*>(api)->cls::ClearDepthStencil(handle, depth, stencil); \
+		}
+
+#if defined(_WIN32) && defined(BAMBOO_STATIC_BACKEND)
+	template<>
+	struct StaticBackend<Direct3D11>
+	{
+		BAMBOO_STATIC_BACKEND_ENTRIES(dx11::GraphicsAPIDX11)
+	};
+
+	template<>
+	struct StaticBackend<Direct3D12>
+	{
+		BAMBOO_STATIC_BACKEND_ENTRIES(dx12::GraphicsAPIDX12)
+	};
+#endif
+
+	template<>
+	struct StaticBackend<Null>
+	{
+		BAMBOO_STATIC_BACKEND_ENTRIES(null::GraphicsAPINull)
+	};
+
+#undef BAMBOO_STATIC_BACKEND_ENTRIES
+
+	// The GraphicsAPI of a renderer, with the calls made for every draw going
+	// through Backend. Everything else is reached with -> as before.
+	template<typename Backend>
+	class GraphicsDevice
+	{
+	public:
+		GraphicsDevice() : api(nullptr) {}
+
+		// a static backend would skip a layer over the backend and cast it to
+		// the wrong class
+		explicit GraphicsDevice(GraphicsAPI* api) : api(api)
+		{
+			assert(nullptr == api || Backend::Accepts(api));
+		}
+
+		GraphicsAPI* Get() const { return api; }
+
+		GraphicsAPI* operator -> () const { return api; }
+
+		explicit operator bool() const { return nullptr != api; }
+
+		void Draw(PipelineStateHandle stateHandle, const DrawCall& drawcall)
+		{
+			Backend::Draw(api, stateHandle, drawcall);
+		}
+
+		void Submit(const DrawItem* items, size_t count)
+		{
+			Backend::Submit(api, items, count);
+		}
+
+		void UpdateBuffer(BufferHandle handle, size_t size, const void* data, size_t stride = 0, PixelFormat format = FORMAT_AUTO)
+		{
+			Backend::UpdateBuffer(api, handle, size, data, stride, format);
+		}
+
+		void Clear(TextureHandle handle, float color[4])
+		{
+			Backend::Clear(api, handle, color);
+		}
+
+		void ClearDepthStencil(TextureHandle handle, float depth, uint8_t stencil)
+		{
+			Backend::ClearDepthStencil(api, handle, depth, stencil);
+		}
+
+	private:
+		GraphicsAPI*		api;
+	};
+
+#if defined(BAMBOO_STATIC_BACKEND) && !BAMBOO_GRAPHICS_VALIDATION
+	typedef GraphicsDevice<StaticBackend<BAMBOO_STATIC_BACKEND>> Device;
+#else
+	typedef GraphicsDevice<VirtualBackend> Device;
+#endif
+}
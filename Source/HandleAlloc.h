@@ -2,69 +2,333 @@
 
 #include "common.h"
 
+#include <atomic>
+#include <cassert>
+#include <vector>
+
 namespace bamboo
 {
 	// This handle allocator is adopted from bgfx (https://github.com/bkaradzic/bgfx)
-	template<size_t size>
+	//
+	// A handle is 32-bit wide, the lower indexBits bits are the slot index and
+	// the bits above hold the generation of that slot. The generation is bumped
+	// every time a slot is freed, so a handle that outlives its object will never
+	// compare equal to the handle currently owning the same slot. The highest bit
+	// is never set in a valid handle (it is used as a tag in the binding data).
+	//
+	// The capacity is given at run time, slots are added on demand (doubling)
+	// until the capacity is reached. Indices of existing slots never change.
+	template<uint32_t indexBits = 20>
 	class HandleAlloc
 	{
-		const uint16_t invalid = UINT16_MAX;
+		static_assert(indexBits > 0 && indexBits < 31, "index bits must leave room for a generation");
+
 	public:
+		static constexpr uint32_t invalid = UINT32_MAX;
+		static constexpr uint32_t indexMask = (1u << indexBits) - 1u;
+		static constexpr uint32_t generationMask = (1u << (31 - indexBits)) - 1u;
+		static constexpr size_t maxCapacity = size_t(1) << indexBits;
 
-		HandleAlloc()
+		explicit HandleAlloc(size_t capacity = 0)
 		{
-			Reset();
+			Init(capacity);
 		}
 
+		void Init(size_t capacity)
+		{
+			assert(capacity <= maxCapacity);
+			this->capacity = capacity < maxCapacity ? capacity : maxCapacity;
+			handles.clear();
+			generations.clear();
+			freeList.clear();
+			freeCount = 0;
+			retiredCount = 0;
+		}
+
+		// drop all the handles, slots already added are kept
 		void Reset()
 		{
-			for (uint16_t i = 0; i < size; ++i) handles[i] = i;
-			handleCount = 0;
+			size_t size = handles.size();
+			// the free list is a stack, fill it reversely so that slot 0 goes out first
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				freeList[i] = static_cast<uint32_t>(size - 1 - i);
+				handles[i] = invalid;
+				generations[i] = 0;
+			}
+			freeCount = size;
+			retiredCount = 0;
+		}
+
+		uint32_t Alloc()
+		{
+			if (0 == freeCount && !Grow())
+				return invalid;
+
+			--freeCount;
+			uint32_t index = freeList[freeCount];
+			uint32_t handle = (generations[index] << indexBits) | index;
+			handles[index] = handle;
+
+			return handle;
+		}
+
+		void Free(uint32_t handle)
+		{
+			if (!InUse(handle)) return;
+
+			Retire(handle);
+			Recycle(GetIndex(handle));
+		}
+
+		// frees the handle but keeps its slot: the handle is stale from now on,
+		// but the slot isn't handed out again until Recycle, for objects whose
+		// record must outlive them until the GPU is done (DeferredRelease.h)
+		void Retire(uint32_t handle)
+		{
+			if (!InUse(handle)) return;
+
+			uint32_t index = GetIndex(handle);
+			handles[index] = invalid;
+			generations[index] = (generations[index] + 1) & generationMask;
+
+			++retiredCount;
+		}
+
+		// gives back the slot of a retired handle
+		void Recycle(uint32_t index)
+		{
+			assert(retiredCount > 0 && index < handles.size() && handles[index] == invalid);
+
+			freeList[freeCount] = index;
+			++freeCount;
+
+			--retiredCount;
 		}
 
-		uint16_t Alloc()
+		// a stale handle fails here since its generation differs from the slot's.
+		// invalid has the index of the last slot, which holds invalid when free
+		bool InUse(uint32_t handle) const
 		{
-			if (handleCount < size)
+			uint32_t index = GetIndex(handle);
+			return invalid != handle && index < handles.size() && handles[index] == handle;
+		}
+
+		bool IndexInUse(uint32_t index) const
+		{
+			return index < handles.size() && handles[index] != invalid;
+		}
+
+		static uint32_t GetIndex(uint32_t handle)
+		{
+			return handle & indexMask;
+		}
+
+		size_t Count() const
+		{
+			return handles.size() - freeCount - retiredCount;
+		}
+
+		// slots retired and not recycled yet
+		size_t RetiredCount() const
+		{
+			return retiredCount;
+		}
+
+		// number of slots added so far, every index in use is below it
+		size_t Size() const
+		{
+			return handles.size();
+		}
+
+		size_t Capacity() const
+		{
+			return capacity;
+		}
+
+		size_t MemoryUsage() const
+		{
+			return (handles.capacity() + generations.capacity() + freeList.capacity()) * sizeof(uint32_t);
+		}
+
+		// check the free list against the live handles, O(n), for debugging only
+		bool Validate() const
+		{
+			size_t size = handles.size();
+			if (generations.size() != size || freeList.size() != size || size > capacity)
+				return false;
+
+			size_t used = 0;
+			for (uint32_t i = 0; i < size; ++i)
 			{
-				size_t index = handleCount;
-				++handleCount;
+				if (invalid != handles[i])
+				{
+					if (GetIndex(handles[i]) != i || (handles[i] >> indexBits) != generations[i])
+						return false;
+					++used;
+				}
+			}
 
-				uint16_t id = handles[index];
-				indices[id] = static_cast<uint16_t>(index);
+			if (used + freeCount + retiredCount != size)
+				return false;
 
-				return id;
+			for (size_t i = 0; i < freeCount; ++i)
+			{
+				uint32_t index = freeList[i];
+				if (index >= size || invalid != handles[index])
+					return false;
 			}
 
-			return invalid;
+			return true;
 		}
 
-		void Free(uint16_t handle)
+	private:
+		bool Grow()
 		{
-			// switch the handle we are freeing with the last handle allocated;
-			if (handleCount == 0) return;
+			size_t size = handles.size();
+			if (size >= capacity)
+				return false;
+
+			size_t newSize = size < 32 ? 32 : size * 2;
+			if (newSize > capacity)
+				newSize = capacity;
 
-			--handleCount;
-			size_t index = indices[handle];
-			size_t last_index = handleCount;
-			uint16_t last_handle = handles[last_index];
+			handles.resize(newSize, static_cast<uint32_t>(invalid));
+			generations.resize(newSize, 0);
+			freeList.resize(newSize);
 
-			handles[index] = last_handle;
-			indices[last_handle] = static_cast<uint16_t>(index);
+			// the free list is empty here, push the new slots so that the lowest goes out first
+			for (size_t i = 0; i < newSize - size; ++i)
+				freeList[i] = static_cast<uint32_t>(newSize - 1 - i);
+			freeCount = newSize - size;
 
-			handles[last_index] = handle;
+			return true;
 		}
 
-		bool InUse(uint16_t handle) const
+		std::vector<uint32_t>	handles;		// handles[i] - the live handle of slot i, or invalid
+		std::vector<uint32_t>	generations;	// generations[i] - the generation of slot i
+		std::vector<uint32_t>	freeList;		// stack of free slot indices
+		size_t					freeCount;
+		size_t					retiredCount;	// slots neither in use nor in the free list
+		size_t					capacity;
+	};
+
+	// Lock-free variant of HandleAlloc, Alloc / Free / InUse may be called from
+	// any number of threads at the same time. Handles share the layout above.
+	//
+	// The free slots form an intrusive singly linked list (Treiber stack). The
+	// head packs a 32-bit tag together with the top slot index and every
+	// successful CAS increases the tag, so a pop racing with a pop-push of the
+	// same slot sees a different head and retries (no ABA).
+	// Reset() is not thread safe.
+	template<size_t size, uint32_t indexBits = 20>
+	class ConcurrentHandleAlloc
+	{
+		static_assert(indexBits > 0 && indexBits < 31, "index bits must leave room for a generation");
+		static_assert(size <= (size_t(1) << indexBits), "index bits are not enough for the handle count");
+
+	public:
+		static constexpr uint32_t invalid = UINT32_MAX;
+		static constexpr uint32_t indexMask = (1u << indexBits) - 1u;
+		static constexpr uint32_t generationMask = (1u << (31 - indexBits)) - 1u;
+
+		ConcurrentHandleAlloc()
 		{
-			if (handle >= size) return false;
+			Reset();
+		}
 
-			size_t index = indices[handle];
-			return index < handleCount && handles[index] == handle;
+		void Reset()
+		{
+			for (uint32_t i = 0; i < size; ++i)
+			{
+				next[i].store(i + 1 < size ? i + 1 : invalid, std::memory_order_relaxed);
+				handles[i].store(invalid, std::memory_order_relaxed);
+				generations[i] = 0;
+			}
+			head.store(MakeHead(0, size > 0 ? 0 : invalid), std::memory_order_relaxed);
+			liveCount.store(0, std::memory_order_release);
+		}
+
+		uint32_t Alloc()
+		{
+			uint64_t oldHead = head.load(std::memory_order_acquire);
+			uint32_t index;
+			for (;;)
+			{
+				index = static_cast<uint32_t>(oldHead);
+				if (invalid == index)
+					return invalid;
+
+				// next[index] may already be overwritten if the slot was taken
+				// by another thread, the tag check of the CAS below rejects it
+				uint32_t nextIndex = next[index].load(std::memory_order_relaxed);
+				uint64_t newHead = MakeHead(static_cast<uint32_t>(oldHead >> 32) + 1, nextIndex);
+				if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_acquire))
+					break;
+			}
+
+			uint32_t handle = (generations[index] << indexBits) | index;
+			handles[index].store(handle, std::memory_order_release);
+			liveCount.fetch_add(1, std::memory_order_relaxed);
+
+			return handle;
+		}
+
+		void Free(uint32_t handle)
+		{
+			// invalid may have the index of a free slot, the CAS below would take it
+			uint32_t index = GetIndex(handle);
+			if (invalid == handle || index >= size) return;
+
+			// only one of the threads freeing the same handle wins the slot
+			uint32_t expected = handle;
+			if (!handles[index].compare_exchange_strong(expected, invalid, std::memory_order_acq_rel))
+				return;
+
+			generations[index] = (generations[index] + 1) & generationMask;
+			liveCount.fetch_sub(1, std::memory_order_relaxed);
+
+			uint64_t oldHead = head.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				next[index].store(static_cast<uint32_t>(oldHead), std::memory_order_relaxed);
+				uint64_t newHead = MakeHead(static_cast<uint32_t>(oldHead >> 32) + 1, index);
+				if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_release, std::memory_order_relaxed))
+					break;
+			}
+		}
+
+		bool InUse(uint32_t handle) const
+		{
+			uint32_t index = GetIndex(handle);
+			return invalid != handle && index < size && handles[index].load(std::memory_order_acquire) == handle;
+		}
+
+		bool IndexInUse(uint32_t index) const
+		{
+			return index < size && handles[index].load(std::memory_order_acquire) != invalid;
+		}
+
+		static uint32_t GetIndex(uint32_t handle)
+		{
+			return handle & indexMask;
+		}
+
+		size_t Count() const
+		{
+			return liveCount.load(std::memory_order_relaxed);
 		}
 
 	private:
-		uint16_t 	handles[size];		// handles[i] - id of the i-th handle
-		uint16_t	indices[size];		// indices[i] - index of the handle whose id == i;
-		size_t		handleCount;
+		static uint64_t MakeHead(uint32_t tag, uint32_t index)
+		{
+			return (static_cast<uint64_t>(tag) << 32) | index;
+		}
+
+		std::atomic<uint64_t>	head;				// tag << 32 | index of the first free slot
+		std::atomic<uint32_t>	liveCount;
+		std::atomic<uint32_t>	handles[size];		// handles[i] - the live handle of slot i, or invalid
+		std::atomic<uint32_t>	next[size];			// next[i] - the free slot after slot i
+		uint32_t				generations[size];	// only touched by the thread owning slot i
 	};
 }
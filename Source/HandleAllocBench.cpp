@@ -0,0 +1,231 @@
+// Stress test and throughput benchmark of ConcurrentHandleAlloc.
+//
+//   HandleAllocBench stress [threads] [seconds]
+//   HandleAllocBench bench [max threads]
+//
+// stress has every thread take and give back handles at random and checks
+// that no slot is ever handed to two threads, that freed handles are stale
+// and that the allocator is whole at the end, it returns 1 on a failure.
+// bench counts Alloc + Free pairs per second for 1, 2, 4 ... threads, against
+// a HandleAlloc behind a mutex. Off Windows it builds with:
+//
+//   g++ -std=c++14 -O2 -pthread -ISource Source/HandleAllocBench.cpp -o HandleAllocBench
+
+#include "HandleAlloc.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace bamboo;
+
+	constexpr size_t HandleCount = 4096;
+	constexpr size_t HeldPerThread = 64;		// handles a thread keeps at most
+
+	typedef ConcurrentHandleAlloc<HandleCount> ConcurrentAlloc;
+
+	// xorshift, one per thread
+	struct Random
+	{
+		uint32_t					state;
+
+		explicit Random(uint32_t seed) : state(seed * 2654435761u + 1) {}
+
+		uint32_t Next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	};
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	int Stress(uint32_t threadCount, double seconds)
+	{
+		static ConcurrentAlloc alloc;
+
+		// owners[i] is the thread holding slot i, plus one, 0 if it is free
+		static std::atomic<uint32_t> owners[HandleCount];
+		for (size_t i = 0; i < HandleCount; ++i)
+			owners[i].store(0, std::memory_order_relaxed);
+
+		std::atomic<bool> stop(false);
+		std::atomic<uint32_t> errors(0);
+		std::atomic<uint64_t> ops(0);
+
+		auto worker = [&](uint32_t id)
+		{
+			Random random(id + 1);
+			std::vector<uint32_t> held;
+			uint64_t count = 0;
+
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				if (held.size() < HeldPerThread && (held.empty() || random.Next() % 2 == 0))
+				{
+					uint32_t handle = alloc.Alloc();
+					if (ConcurrentAlloc::invalid == handle)
+						continue;
+
+					uint32_t free = 0;
+					if (!owners[ConcurrentAlloc::GetIndex(handle)].compare_exchange_strong(free, id + 1) || !alloc.InUse(handle))
+						errors++;
+
+					held.push_back(handle);
+				}
+				else
+				{
+					size_t i = random.Next() % held.size();
+					uint32_t handle = held[i];
+					held[i] = held.back();
+					held.pop_back();
+
+					// released before Free, another thread may get the slot right after
+					owners[ConcurrentAlloc::GetIndex(handle)].store(0);
+					alloc.Free(handle);
+
+					// freeing twice does nothing, and the handle is stale for good
+					alloc.Free(handle);
+					if (alloc.InUse(handle))
+						errors++;
+				}
+				++count;
+			}
+
+			for (uint32_t handle : held)
+			{
+				owners[ConcurrentAlloc::GetIndex(handle)].store(0);
+				alloc.Free(handle);
+			}
+			ops += count;
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; ++i)
+			threads.emplace_back(worker, i);
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop = true;
+		for (std::thread& thread : threads)
+			thread.join();
+
+		// every slot is free again, and each one comes out exactly once
+		if (0 != alloc.Count())
+			errors++;
+
+		std::vector<bool> seen(HandleCount, false);
+		for (size_t i = 0; i < HandleCount; ++i)
+		{
+			uint32_t handle = alloc.Alloc();
+			uint32_t index = ConcurrentAlloc::GetIndex(handle);
+			if (ConcurrentAlloc::invalid == handle || seen[index])
+			{
+				errors++;
+				break;
+			}
+			seen[index] = true;
+		}
+		if (ConcurrentAlloc::invalid != alloc.Alloc())
+			errors++;
+
+		printf("stress: %u threads, %llu operations, %u errors\n", threadCount,
+			static_cast<unsigned long long>(ops.load()), errors.load());
+
+		return 0 == errors ? 0 : 1;
+	}
+
+	// Alloc + Free pairs per second, each thread keeping a few handles so the
+	// free list is shared by all of them
+	template<typename Alloc, typename Free>
+	double Throughput(uint32_t threadCount, Alloc alloc, Free free)
+	{
+		constexpr uint32_t PairsPerThread = 1 << 20;
+
+		std::atomic<uint32_t> ready(0);
+		std::atomic<bool> go(false);
+
+		auto worker = [&]()
+		{
+			uint32_t held[8];
+			ready++;
+			while (!go.load(std::memory_order_acquire)) {}
+
+			for (uint32_t i = 0; i < PairsPerThread; i += 8)
+			{
+				for (uint32_t k = 0; k < 8; ++k)
+					held[k] = alloc();
+				for (uint32_t k = 0; k < 8; ++k)
+					free(held[k]);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; ++i)
+			threads.emplace_back(worker);
+		while (ready.load() < threadCount) {}
+
+		auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (std::thread& thread : threads)
+			thread.join();
+
+		return static_cast<double>(PairsPerThread) * threadCount / Seconds(start);
+	}
+
+	int Bench(uint32_t maxThreads)
+	{
+		static ConcurrentAlloc concurrent;
+		HandleAlloc<> locked(HandleCount);
+		std::mutex mutex;
+
+		printf("threads  concurrent Mops/s  mutex Mops/s\n");
+		for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			double lockFree = Throughput(threads,
+				[&]() { return concurrent.Alloc(); },
+				[&](uint32_t handle) { concurrent.Free(handle); });
+
+			double withMutex = Throughput(threads,
+				[&]() { std::lock_guard<std::mutex> lock(mutex); return locked.Alloc(); },
+				[&](uint32_t handle) { std::lock_guard<std::mutex> lock(mutex); locked.Free(handle); });
+
+			printf("%7u  %17.2f  %12.2f\n", threads, lockFree / 1e6, withMutex / 1e6);
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t cores = std::thread::hardware_concurrency();
+	if (0 == cores) cores = 4;
+
+	if (argc > 1 && 0 == strcmp(argv[1], "stress"))
+	{
+		uint32_t threads = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : cores;
+		double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+		return Stress(threads > 0 ? threads : 1, seconds);
+	}
+
+	if (argc > 1 && 0 == strcmp(argv[1], "bench"))
+	{
+		uint32_t threads = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : (cores < 16 ? cores : 16);
+		return Bench(threads > 0 ? threads : 1);
+	}
+
+	printf("usage: %s stress [threads] [seconds]\n       %s bench [max threads]\n", argv[0], argv[0]);
+	return 1;
+}
@@ -0,0 +1,154 @@
+#include "MeshPool.h"
+
+#include <cassert>
+
+namespace bamboo
+{
+	MeshPool::MeshPool()
+		:
+		api(nullptr),
+		vertexBuffer{ invalid_handle },
+		indexBuffer{ invalid_handle },
+		vertexStride(0),
+		indexStride(0),
+		vertexAlloc(nullptr),
+		indexAlloc(nullptr),
+		meshCount(0),
+		failures(0)
+	{
+	}
+
+	MeshPool::~MeshPool()
+	{
+		Shutdown();
+	}
+
+	bool MeshPool::Init(GraphicsAPI* api, uint32_t vertexStride, uint32_t indexStride)
+	{
+		assert(nullptr != api && vertexStride > 0);
+
+		Shutdown();
+
+		if (indexStride != 2 && indexStride != 4)
+			return false;
+
+		this->api = api;
+		this->vertexStride = vertexStride;
+		this->indexStride = indexStride;
+
+		vertexBuffer = api->CreateBuffer(static_cast<size_t>(MeshPoolVertexCount) * vertexStride, BINDING_VERTEX_BUFFER);
+		indexBuffer = api->CreateBuffer(static_cast<size_t>(MeshPoolIndexCount) * indexStride, BINDING_INDEX_BUFFER);
+		if (invalid_handle == vertexBuffer.id || invalid_handle == indexBuffer.id)
+		{
+			Shutdown();
+			return false;
+		}
+
+		vertexTreeMem.resize((vertex_alloc_t::treeSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+		indexTreeMem.resize((index_alloc_t::treeSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+		vertexAlloc = vertex_alloc_t::create(vertexTreeMem.data());
+		indexAlloc = index_alloc_t::create(indexTreeMem.data());
+
+		meshCount = 0;
+		failures = 0;
+
+		return true;
+	}
+
+	void MeshPool::Shutdown()
+	{
+		if (nullptr != api)
+		{
+			if (invalid_handle != vertexBuffer.id)
+				api->DestroyBuffer(vertexBuffer);
+			if (invalid_handle != indexBuffer.id)
+				api->DestroyBuffer(indexBuffer);
+		}
+
+		api = nullptr;
+		vertexBuffer.id = invalid_handle;
+		indexBuffer.id = invalid_handle;
+		vertexAlloc = nullptr;
+		indexAlloc = nullptr;
+		meshCount = 0;
+	}
+
+	bool MeshPool::Add(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, MeshRange& range)
+	{
+		assert(nullptr != api);
+
+		if (0 == vertexCount || 0 == indexCount || nullptr == vertices || nullptr == indices)
+			return false;
+
+		uint32_t firstVertex = vertexAlloc->allocateOffset(vertexCount);
+		if (vertex_alloc_t::invalid_offset == firstVertex)
+		{
+			failures++;
+			return false;
+		}
+
+		uint32_t firstIndex = indexAlloc->allocateOffset(indexCount);
+		if (index_alloc_t::invalid_offset == firstIndex)
+		{
+			vertexAlloc->deallocateOffset(firstVertex);
+			failures++;
+			return false;
+		}
+
+		// the backend may be out of upload space, the ranges are given back
+		// and the mesh can be added again later
+		if (!api->UpdateBufferRegion(vertexBuffer, static_cast<size_t>(firstVertex) * vertexStride,
+				static_cast<size_t>(vertexCount) * vertexStride, vertices, vertexStride) ||
+			!api->UpdateBufferRegion(indexBuffer, static_cast<size_t>(firstIndex) * indexStride,
+				static_cast<size_t>(indexCount) * indexStride, indices, indexStride))
+		{
+			vertexAlloc->deallocateOffset(firstVertex);
+			indexAlloc->deallocateOffset(firstIndex);
+			failures++;
+			return false;
+		}
+
+		range.StartIndex = firstIndex;
+		range.BaseVertex = static_cast<int32_t>(firstVertex);
+		range.IndexCount = indexCount;
+		range.VertexCount = vertexCount;
+
+		meshCount++;
+
+		return true;
+	}
+
+	void MeshPool::Remove(const MeshRange& range)
+	{
+		assert(meshCount > 0);
+
+		vertexAlloc->deallocateOffset(static_cast<uint32_t>(range.BaseVertex));
+		indexAlloc->deallocateOffset(range.StartIndex);
+
+		meshCount--;
+	}
+
+	void MeshPool::SetupDrawCall(const MeshRange& range, DrawCall& drawcall) const
+	{
+		drawcall.VertexBufferCount = 1;
+		drawcall.VertexBuffers[0] = vertexBuffer;
+		drawcall.VertexBufferOffsets[0] = 0;
+		drawcall.HasIndexBuffer = 1;
+		drawcall.IndexBuffer = indexBuffer;
+		drawcall.IndexBufferOffset = 0;
+
+		drawcall.ElementCount = range.IndexCount;
+		drawcall.StartIndex = range.StartIndex;
+		drawcall.BaseVertex = range.BaseVertex;
+	}
+
+	MeshPoolStats MeshPool::GetStats() const
+	{
+		MeshPoolStats stats = {};
+		stats.MeshCount = meshCount;
+		stats.FreeVertices = nullptr != vertexAlloc ? vertexAlloc->freeRemaining() : 0;
+		stats.FreeIndices = nullptr != indexAlloc ? indexAlloc->freeRemaining() : 0;
+		stats.Failures = failures;
+		return stats;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+#include "TLSFAllocator.h"
+
+#include <vector>
+
+namespace bamboo
+{
+	// capacity of a pool, the ranges are rounded up to the granularity
+	constexpr uint32_t MeshPoolVertexCount = 1024 * 1024;
+	constexpr uint32_t MeshPoolVertexGranularity = 64;
+	constexpr uint32_t MeshPoolIndexCount = 4 * 1024 * 1024;
+	constexpr uint32_t MeshPoolIndexGranularity = 256;
+
+	// where a mesh is in the buffers of its pool
+	struct MeshRange
+	{
+		uint32_t					StartIndex;
+		int32_t						BaseVertex;
+		uint32_t					IndexCount;
+		uint32_t					VertexCount;
+	};
+
+	struct MeshPoolStats
+	{
+		uint32_t					MeshCount;
+		uint32_t					FreeVertices;
+		uint32_t					FreeIndices;
+		uint32_t					Failures;		// no room for a mesh, or its upload failed
+	};
+
+	// Meshes of the same vertex layout packed in one vertex buffer and one
+	// index buffer. The vertex and index ranges are placed by TLSF allocators,
+	// so meshes can be added and removed in any order. The indices of a mesh
+	// are relative to its first vertex: draws of different meshes of a pool
+	// use the same buffers and only differ by StartIndex, BaseVertex and
+	// ElementCount, going from one to the next needs no IA rebinding.
+	class MeshPool
+	{
+	public:
+		MeshPool();
+		~MeshPool();
+
+		MeshPool(const MeshPool&) = delete;
+		MeshPool& operator=(const MeshPool&) = delete;
+
+		// vertexStride in bytes, indexStride is 2 or 4
+		bool Init(GraphicsAPI* api, uint32_t vertexStride, uint32_t indexStride = 4);
+
+		void Shutdown();
+
+		// copies the mesh in the buffers, false if there is no room for it or
+		// the backend couldn't upload it
+		bool Add(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, MeshRange& range);
+
+		// the range can be reused right away, the mesh must not be drawn any more
+		void Remove(const MeshRange& range);
+
+		// sets the buffers, StartIndex, BaseVertex and ElementCount of a draw of the mesh
+		void SetupDrawCall(const MeshRange& range, DrawCall& drawcall) const;
+
+		BufferHandle GetVertexBuffer() const { return vertexBuffer; }
+
+		BufferHandle GetIndexBuffer() const { return indexBuffer; }
+
+		MeshPoolStats GetStats() const;
+
+	private:
+		typedef memory::TLSFAllocator<MeshPoolVertexCount, MeshPoolVertexGranularity, uint32_t> vertex_alloc_t;
+		typedef memory::TLSFAllocator<MeshPoolIndexCount, MeshPoolIndexGranularity, uint32_t> index_alloc_t;
+
+		GraphicsAPI*				api;
+		BufferHandle				vertexBuffer;
+		BufferHandle				indexBuffer;
+		uint32_t					vertexStride;
+		uint32_t					indexStride;
+
+		// out of band records of the allocators
+		std::vector<uint64_t>		vertexTreeMem;
+		std::vector<uint64_t>		indexTreeMem;
+		vertex_alloc_t*				vertexAlloc;
+		index_alloc_t*				indexAlloc;
+
+		uint32_t					meshCount;
+		uint32_t					failures;
+	};
+}
@@ -0,0 +1,421 @@
+#pragma once
+
+#include "GraphicsAPI.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bamboo
+{
+	struct PipelineCacheStatistics
+	{
+		uint32_t					Creates;		// descriptions given to Acquire
+		uint32_t					Shared;			// of those, identical to a live one, nothing was compiled
+		uint32_t					Compiles;		// finished, failed ones included
+		uint32_t					CompileFailures;
+		uint32_t					SkippedDraws;	// their pipeline state was still compiling
+		double						CompileTime;	// in milliseconds, summed over the compile threads
+	};
+
+	// hash of a shader's bytecode, for the pipeline cache keys
+	inline uint64_t HashShaderBytecode(const void* data, size_t size)
+	{
+		// FNV-1a over the bytes
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t h = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+			h = (h ^ bytes[i]) * 1099511628211ull;
+		return h;
+	}
+
+	// Pipeline states shared by the handles created from identical
+	// descriptions, and compiled on background threads. Acquire finds a live
+	// entry by the hash of the description, or takes a new one whose Job the
+	// backend fills in place and hands to Compile. The shaders are told apart
+	// by the hashes of their bytecode, given by the backend, not by their
+	// handles, so identical shaders created twice share the pipeline states.
+	// The handle can be used at once: Ready is false, and the backend skips
+	// the draws with it, until a compile thread has run the job. An entry
+	// lives as long as it has references, the last Release takes it out of
+	// the table so it isn't found any more, and Free gives it back once the
+	// GPU is done with it, or once its compile is, whichever comes last.
+	//
+	// The cache knows nothing of the device. Job::Compile() makes the object
+	// and returns false if it couldn't, from a compile thread, so it must not
+	// touch anything the backend may change meanwhile. Job::Reset() releases
+	// what Compile made, from the thread calling Free or Poll. Without compile
+	// threads the jobs are run by Compile itself.
+	template<typename Job>
+	class PipelineCache
+	{
+	public:
+		static constexpr uint32_t invalid_entry = UINT32_MAX;
+
+		PipelineCache()
+			:
+			freeEntry(none),
+			finishedCount(0),
+			stopping(false),
+			stats{}
+		{}
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		~PipelineCache()
+		{
+			Shutdown();
+		}
+
+		// every core but the one recording the draws, at most 4
+		static uint32_t DefaultThreadCount()
+		{
+			uint32_t cores = std::thread::hardware_concurrency();
+			return cores > 1 ? std::min(cores - 1, 4u) : 1;
+		}
+
+		void Init(uint32_t capacity, uint32_t threadCount)
+		{
+			uint32_t bucketCount = 1;
+			while (bucketCount < capacity * 2)
+				bucketCount <<= 1;
+
+			entries.resize(capacity);
+			buckets.assign(bucketCount, static_cast<uint32_t>(none));
+
+			for (uint32_t i = 0; i < capacity; ++i)
+			{
+				entries[i].refs = 0;
+				entries[i].ready = false;
+				entries[i].freed = false;
+				entries[i].compile = COMPILE_DONE;
+				entries[i].hashNext = i + 1 < capacity ? i + 1 : none;
+			}
+			freeEntry = capacity > 0 ? 0 : none;
+
+			memset(&stats, 0, sizeof(stats));
+
+			stopping = false;
+			for (uint32_t i = 0; i < threadCount; ++i)
+				threads.emplace_back([this] { CompileThread(); });
+		}
+
+		// the compiles not started yet are dropped, the entries are left as they
+		// are for the backend to Free. The running ones are waited for, and the
+		// entries freed meanwhile are given back.
+		void Shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+				for (uint32_t index : queue)
+					entries[index].compile = COMPILE_DONE;
+				queue.clear();
+			}
+			work.notify_all();
+
+			for (std::thread& thread : threads)
+				thread.join();
+			threads.clear();
+
+			Poll();
+		}
+
+		// entry of the description with one more reference, vsHash and psHash
+		// are the HashShaderBytecode of its shaders, 0 for none. created is set
+		// if it is a new one, whose job has to be filled and given to Compile.
+		// invalid_entry if there is no room for it.
+		uint32_t Acquire(const PipelineState& desc, uint64_t vsHash, uint64_t psHash, bool& created)
+		{
+			Key key;
+			Normalize(desc, vsHash, psHash, key);
+			uint64_t hash = Hash(key);
+			uint32_t bucket = static_cast<uint32_t>(hash) & static_cast<uint32_t>(buckets.size() - 1);
+
+			stats.Creates++;
+
+			for (uint32_t i = buckets[bucket]; none != i; i = entries[i].hashNext)
+			{
+				Entry& entry = entries[i];
+				if (entry.hash == hash && 0 == memcmp(&entry.key, &key, sizeof(key)))
+				{
+					entry.refs++;
+					stats.Shared++;
+					created = false;
+					return i;
+				}
+			}
+
+			if (none == freeEntry)
+				return invalid_entry;
+
+			uint32_t index = freeEntry;
+			Entry& entry = entries[index];
+			freeEntry = entry.hashNext;
+
+			entry.key = key;
+			entry.hash = hash;
+			entry.refs = 1;
+			entry.ready = false;
+
+			entry.hashNext = buckets[bucket];
+			buckets[bucket] = index;
+
+			created = true;
+			return index;
+		}
+
+		Job& GetJob(uint32_t index)
+		{
+			return entries[index].job;
+		}
+
+		void Compile(uint32_t index)
+		{
+			Entry& entry = entries[index];
+
+			if (threads.empty())
+			{
+				auto start = std::chrono::steady_clock::now();
+				bool succeeded = entry.job.Compile();
+				auto stop = std::chrono::steady_clock::now();
+				Complete(Finished{ index, succeeded, std::chrono::duration<double, std::milli>(stop - start).count() });
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				entry.compile = COMPILE_QUEUED;
+				queue.push_back(index);
+			}
+			work.notify_one();
+		}
+
+		// false while the job hasn't run, or if it failed
+		bool Ready(uint32_t index)
+		{
+			if (!entries[index].ready && finishedCount.load(std::memory_order_acquire) > 0)
+				Poll();
+			return entries[index].ready;
+		}
+
+		// takes in what the compile threads have finished
+		void Poll()
+		{
+			std::vector<Finished> results;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				results.swap(finished);
+				finishedCount.store(0, std::memory_order_relaxed);
+			}
+
+			for (const Finished& result : results)
+				Complete(result);
+		}
+
+		// drops a reference, true if it was the last one. The entry isn't
+		// found by Acquire any more, the caller Frees it.
+		bool Release(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			assert(entry.refs > 0);
+			if (0 != --entry.refs)
+				return false;
+
+			uint32_t* link = &buckets[static_cast<uint32_t>(entry.hash) & static_cast<uint32_t>(buckets.size() - 1)];
+			while (*link != index)
+			{
+				assert(none != *link);
+				link = &entries[*link].hashNext;
+			}
+			*link = entry.hashNext;
+
+			return true;
+		}
+
+		// gives the entry back, its compile is dropped if it hasn't started. A
+		// running one isn't waited for, the entry is given back by the Poll
+		// that takes in its result.
+		void Free(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			assert(0 == entry.refs && !entry.freed);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (COMPILE_RUNNING == entry.compile)
+				{
+					entry.freed = true;
+					return;
+				}
+				if (COMPILE_QUEUED == entry.compile)
+				{
+					queue.erase(std::find(queue.begin(), queue.end(), index));
+					entry.compile = COMPILE_DONE;
+				}
+			}
+
+			// its result may be waiting for Poll
+			entry.freed = true;
+			Poll();
+			if (entry.freed)
+				Recycle(index);
+		}
+
+		void CountSkippedDraw() { stats.SkippedDraws++; }
+
+		const PipelineCacheStatistics& GetStatistics() const { return stats; }
+
+		void ResetStatistics() { memset(&stats, 0, sizeof(stats)); }
+
+	private:
+		static constexpr uint32_t none = UINT32_MAX;
+
+		enum CompileState
+		{
+			COMPILE_QUEUED,
+			COMPILE_RUNNING,
+			COMPILE_DONE,
+		};
+
+		// the description, with the shaders as the hashes of their bytecode
+		struct Key
+		{
+			PipelineState			desc;
+			uint64_t				vsHash;
+			uint64_t				psHash;
+		};
+
+		struct Entry
+		{
+			Key						key;
+			uint64_t				hash;
+			uint32_t				refs;
+			uint32_t				hashNext;		// bucket chain, or free list
+			bool					ready;			// compiled, only seen by the backend thread
+			bool					freed;			// given to Free, waiting for its compile
+			CompileState			compile;		// guarded by the mutex
+			Job						job;
+		};
+
+		struct Finished
+		{
+			uint32_t				index;
+			bool					succeeded;
+			double					time;
+		};
+
+		// the bits of the description that make no difference are cleared, so
+		// the keys can be compared and hashed as bytes. The shader handles are
+		// left out, their hashes stand for them.
+		static void Normalize(const PipelineState& desc, uint64_t vsHash, uint64_t psHash, Key& out)
+		{
+			memset(&out, 0, sizeof(out));
+			out.vsHash = vsHash;
+			out.psHash = psHash;
+
+			PipelineState& key = out.desc;
+
+			uint16_t elementCount = std::min<uint16_t>(desc.VertexLayout.ElementCount, MaxVertexInputElement);
+			uint32_t renderTargetCount = std::min<uint32_t>(desc.RenderTargetCount, MaxRenderTargetBindingSlot);
+
+			key.BindingLayout = desc.BindingLayout;
+			memcpy(key.VertexLayout.Elements, desc.VertexLayout.Elements, elementCount * sizeof(VertexInputElement));
+			key.VertexLayout.ElementCount = elementCount;
+			key.CullMode = desc.CullMode;
+			key.DepthEnable = desc.DepthEnable;
+			key.DepthWrite = desc.DepthWrite;
+			key.DepthFunc = desc.DepthFunc;
+			key.RenderTargetCount = renderTargetCount;
+			for (uint32_t i = 0; i < renderTargetCount; ++i)
+				key.RenderTargetFormats[i] = desc.RenderTargetFormats[i];
+			key.DepthStencilFormat = desc.DepthStencilFormat;
+			key.PrimitiveType = desc.PrimitiveType;
+		}
+
+		static uint64_t Hash(const Key& key)
+		{
+			// FNV-1a over the bytes, with a final mix for the bucket bits
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+			uint64_t h = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(key); ++i)
+				h = (h ^ bytes[i]) * 1099511628211ull;
+			h ^= h >> 32;
+			return h;
+		}
+
+		void Complete(const Finished& result)
+		{
+			entries[result.index].ready = result.succeeded;
+
+			stats.Compiles++;
+			if (!result.succeeded)
+				stats.CompileFailures++;
+			stats.CompileTime += result.time;
+
+			if (entries[result.index].freed)
+				Recycle(result.index);
+		}
+
+		void Recycle(uint32_t index)
+		{
+			Entry& entry = entries[index];
+			entry.job.Reset();
+			entry.ready = false;
+			entry.freed = false;
+
+			entry.hashNext = freeEntry;
+			freeEntry = index;
+		}
+
+		void CompileThread()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;)
+			{
+				work.wait(lock, [this] { return stopping || !queue.empty(); });
+				if (queue.empty())
+					return;
+
+				uint32_t index = queue.front();
+				queue.pop_front();
+
+				Entry& entry = entries[index];
+				entry.compile = COMPILE_RUNNING;
+				lock.unlock();
+
+				auto start = std::chrono::steady_clock::now();
+				bool succeeded = entry.job.Compile();
+				auto stop = std::chrono::steady_clock::now();
+
+				lock.lock();
+				entry.compile = COMPILE_DONE;
+				finished.push_back(Finished{ index, succeeded, std::chrono::duration<double, std::milli>(stop - start).count() });
+				finishedCount.store(static_cast<uint32_t>(finished.size()), std::memory_order_release);
+			}
+		}
+
+		std::vector<Entry>			entries;		// never resized once the threads run
+		std::vector<uint32_t>		buckets;
+		uint32_t					freeEntry;
+
+		std::vector<std::thread>	threads;
+		std::mutex					mutex;
+		std::condition_variable		work;			// something in the queue, or stopping
+		std::deque<uint32_t>		queue;			// entries waiting for a compile thread
+		std::vector<Finished>		finished;		// not seen by Poll yet
+		std::atomic<uint32_t>		finishedCount;
+		bool						stopping;
+
+		PipelineCacheStatistics		stats;
+	};
+}
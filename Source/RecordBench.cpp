@@ -0,0 +1,616 @@
+// Compares the cost of the resource lookups a draw makes in the D3D12
+// backend with the records it had before they were split into hot and cold
+// parts, and with the split ones, first with the buffer states in an array
+// of their own and then packed into the hot buffer record.
+//
+//   RecordBench [draws] [buffers] [textures]
+//
+// The records mirror the ones in GraphicsAPIDX12.cpp. Before, a buffer was a
+// record with its resource, state, size, stride and format, and its address
+// came from the resource itself. A texture record held its whole
+// description. Split, a draw reads 16 byte records and a state array, and
+// the rest sits in pools it doesn't touch. Packed, as the backend has it now,
+// the buffer state is a 4 bit index next to the stride, so a buffer bind reads
+// a single record. Every draw binds two vertex buffers,
+// an index buffer, two constant buffers and four textures picked at random,
+// checks their states and changes one now and then, as BindResources does.
+// It prints the time per draw and, on Linux when perf events are allowed,
+// the cache misses per draw. Off Windows it builds with:
+//
+//   g++ -std=c++14 -O2 -ISource Source/RecordBench.cpp -o RecordBench
+
+#include "ResourcePool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using namespace bamboo;
+
+	constexpr uint32_t VertexBuffersPerDraw = 2;
+	constexpr uint32_t ConstantBuffersPerDraw = 2;
+	constexpr uint32_t TexturesPerDraw = 4;
+
+	// the resource states, as D3D12_RESOURCE_STATES
+	enum ResourceState : uint32_t
+	{
+		STATE_COMMON = 0,
+		STATE_VERTEX_AND_CONSTANT_BUFFER = 0x1,
+		STATE_INDEX_BUFFER = 0x2,
+		STATE_PIXEL_SHADER_RESOURCE = 0x80,
+		STATE_COPY_DEST = 0x400,
+	};
+
+	// what the driver keeps for an ID3D12Resource, the address is read from it
+	struct Resource
+	{
+		uint64_t					gpuAddress;
+		uint8_t						driverData[120];
+	};
+
+	// ---- before the split ----
+
+	struct BufferRecord
+	{
+		Resource*					buffer;
+		ResourceState				state;
+		uint32_t					bindFlags;
+		uint32_t					size;
+		uint32_t					stride;
+		uint32_t					format;
+	};
+
+	struct TextureRecord
+	{
+		Resource*					texture;
+		uint32_t					rtv;
+		uint32_t					dsv;
+		ResourceState				state;
+		uint32_t					type;
+		uint32_t					format;
+		uint32_t					width;
+		uint32_t					height;
+		uint32_t					depth;
+		uint32_t					arraySize;
+		uint32_t					mipLevels;
+		bool						isCubeMap;
+	};
+
+	// ---- after the split ----
+
+	struct BufferHot
+	{
+		uint64_t					gpuAddress;
+		uint32_t					size;
+		uint16_t					stride;
+		uint8_t						bindFlags;
+		uint8_t						format;
+	};
+
+	struct BufferCold
+	{
+		Resource*					buffer;
+	};
+
+	struct TextureHot
+	{
+		Resource*					texture;
+		uint32_t					rtv;
+		uint32_t					dsv;
+	};
+
+	struct TextureDesc
+	{
+		uint32_t					type;
+		uint32_t					format;
+		uint32_t					width;
+		uint32_t					height;
+		uint32_t					depth;
+		uint32_t					arraySize;
+		uint32_t					mipLevels;
+		bool						isCubeMap;
+	};
+
+	// ---- with the buffer state packed in the hot record ----
+
+	enum BufferState : uint16_t
+	{
+		BUFFER_STATE_COMMON = 0,
+		BUFFER_STATE_COPY_DEST,
+		BUFFER_STATE_VERTEX_AND_CONSTANT_BUFFER,
+		BUFFER_STATE_INDEX_BUFFER,
+		BUFFER_STATE_PIXEL_SHADER_RESOURCE,
+		BUFFER_STATE_COUNT,
+	};
+
+	const ResourceState BufferStateTable[BUFFER_STATE_COUNT] =
+	{
+		STATE_COMMON,
+		STATE_COPY_DEST,
+		STATE_VERTEX_AND_CONSTANT_BUFFER,
+		STATE_INDEX_BUFFER,
+		STATE_PIXEL_SHADER_RESOURCE,
+	};
+
+	inline uint16_t BufferStateIndex(ResourceState state)
+	{
+		switch (state)
+		{
+		case STATE_COPY_DEST:					return BUFFER_STATE_COPY_DEST;
+		case STATE_VERTEX_AND_CONSTANT_BUFFER:	return BUFFER_STATE_VERTEX_AND_CONSTANT_BUFFER;
+		case STATE_INDEX_BUFFER:				return BUFFER_STATE_INDEX_BUFFER;
+		case STATE_PIXEL_SHADER_RESOURCE:		return BUFFER_STATE_PIXEL_SHADER_RESOURCE;
+		default:								return BUFFER_STATE_COMMON;
+		}
+	}
+
+	struct BufferPacked
+	{
+		uint64_t					gpuAddress;
+		uint32_t					size;
+		uint16_t					stride : 12;
+		uint16_t					state : 4;
+		uint8_t						bindFlags;
+		uint8_t						format;
+	};
+
+	static_assert(sizeof(BufferHot) == 16 && sizeof(BufferPacked) == 16 && sizeof(TextureHot) == 16, "the hot records are 16 bytes in the backend");
+
+	struct Draw
+	{
+		uint32_t					vertexBuffers[VertexBuffersPerDraw];
+		uint32_t					indexBuffer;
+		uint32_t					constantBuffers[ConstantBuffersPerDraw];
+		uint32_t					textures[TexturesPerDraw];
+	};
+
+	// xorshift, so a seed gives the same draws everywhere
+	struct Random
+	{
+		uint32_t					state;
+
+		explicit Random(uint32_t seed) : state(seed * 2654435761u + 1) {}
+
+		uint32_t Next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+	};
+
+	struct Scene
+	{
+		std::vector<Resource*>		resources;		// allocated in random order, as the driver would
+		std::vector<Draw>			draws;
+		uint32_t					bufferCount;
+		uint32_t					textureCount;
+	};
+
+	void BuildScene(uint32_t drawCount, uint32_t bufferCount, uint32_t textureCount, Scene& scene)
+	{
+		Random random(1);
+		uint32_t count = bufferCount + textureCount;
+
+		std::vector<Resource*> blocks(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			blocks[i] = new Resource();
+			blocks[i]->gpuAddress = static_cast<uint64_t>(i) << 16;
+		}
+		for (uint32_t i = count; i > 1; --i)
+			std::swap(blocks[i - 1], blocks[random.Next() % i]);
+		scene.resources = blocks;
+
+		scene.bufferCount = bufferCount;
+		scene.textureCount = textureCount;
+		scene.draws.resize(drawCount);
+		for (Draw& draw : scene.draws)
+		{
+			for (uint32_t& vb : draw.vertexBuffers) vb = random.Next() % bufferCount;
+			draw.indexBuffer = random.Next() % bufferCount;
+			for (uint32_t& cb : draw.constantBuffers) cb = random.Next() % bufferCount;
+			for (uint32_t& tex : draw.textures) tex = random.Next() % textureCount;
+		}
+	}
+
+	void ReleaseScene(Scene& scene)
+	{
+		for (Resource* resource : scene.resources)
+			delete resource;
+		scene.resources.clear();
+	}
+
+	// a barrier is rare, the state mostly is already the one wanted. It goes
+	// to the resource, as ResourceBarrier does
+	template<typename Transition>
+	inline void Transist(ResourceState& state, ResourceState dest, Transition transition)
+	{
+		if (dest != state)
+		{
+			transition();
+			state = dest;
+		}
+	}
+
+	struct Before
+	{
+		ResourcePool<BufferRecord>	buffers;
+		ResourcePool<TextureRecord>	textures;
+
+		void Init(const Scene& scene)
+		{
+			buffers.Init(scene.bufferCount);
+			textures.Init(scene.textureCount);
+			for (uint32_t i = 0; i < scene.bufferCount; ++i)
+			{
+				BufferRecord& buf = buffers.Acquire(i);
+				buf.buffer = scene.resources[i];
+				buf.state = STATE_COMMON;
+				buf.size = 65536;
+				buf.stride = 32;
+			}
+			for (uint32_t i = 0; i < scene.textureCount; ++i)
+			{
+				TextureRecord& tex = textures.Acquire(i);
+				tex.texture = scene.resources[scene.bufferCount + i];
+				tex.state = STATE_COMMON;
+				tex.width = tex.height = 1024;
+			}
+		}
+
+		uint64_t Bind(const Draw& draw, uint64_t& barriers)
+		{
+			uint64_t sum = 0;
+			for (uint32_t index : draw.vertexBuffers)
+			{
+				BufferRecord& buf = buffers[index];
+				Transist(buf.state, STATE_VERTEX_AND_CONSTANT_BUFFER, [&] { barriers += buf.buffer->driverData[0] + 1; });
+				sum += buf.buffer->gpuAddress + buf.size + buf.stride;
+			}
+
+			BufferRecord& ib = buffers[draw.indexBuffer];
+			Transist(ib.state, STATE_INDEX_BUFFER, [&] { barriers += ib.buffer->driverData[0] + 1; });
+			sum += ib.buffer->gpuAddress + ib.size + ib.format;
+
+			for (uint32_t index : draw.constantBuffers)
+			{
+				BufferRecord& buf = buffers[index];
+				Transist(buf.state, STATE_VERTEX_AND_CONSTANT_BUFFER, [&] { barriers += buf.buffer->driverData[0] + 1; });
+				sum += buf.buffer->gpuAddress;
+			}
+
+			for (uint32_t index : draw.textures)
+			{
+				TextureRecord& tex = textures[index];
+				Transist(tex.state, STATE_PIXEL_SHADER_RESOURCE, [&] { barriers += tex.texture->driverData[0] + 1; });
+				sum += reinterpret_cast<uintptr_t>(tex.texture);
+			}
+
+			return sum;
+		}
+
+		// an update of the buffer, it will need a barrier on the next bind
+		void Update(uint32_t index)
+		{
+			buffers[index].state = STATE_COPY_DEST;
+		}
+	};
+
+	struct After
+	{
+		ResourcePool<BufferHot>		buffers;
+		ResourcePool<ResourceState>	bufferStates;
+		ResourcePool<BufferCold>	bufferResources;
+		ResourcePool<TextureHot>	textures;
+		ResourcePool<ResourceState>	textureStates;
+		ResourcePool<TextureDesc>	textureDescs;
+
+		void Init(const Scene& scene)
+		{
+			buffers.Init(scene.bufferCount);
+			bufferStates.Init(scene.bufferCount);
+			bufferResources.Init(scene.bufferCount);
+			textures.Init(scene.textureCount);
+			textureStates.Init(scene.textureCount);
+			textureDescs.Init(scene.textureCount);
+			for (uint32_t i = 0; i < scene.bufferCount; ++i)
+			{
+				Resource* resource = scene.resources[i];
+				bufferResources.Acquire(i).buffer = resource;
+				bufferStates.Acquire(i) = STATE_COMMON;
+				BufferHot& buf = buffers.Acquire(i);
+				buf.gpuAddress = resource->gpuAddress;
+				buf.size = 65536;
+				buf.stride = 32;
+			}
+			for (uint32_t i = 0; i < scene.textureCount; ++i)
+			{
+				textures.Acquire(i).texture = scene.resources[scene.bufferCount + i];
+				textureStates.Acquire(i) = STATE_COMMON;
+				TextureDesc& desc = textureDescs.Acquire(i);
+				desc.width = desc.height = 1024;
+			}
+		}
+
+		uint64_t Bind(const Draw& draw, uint64_t& barriers)
+		{
+			uint64_t sum = 0;
+			for (uint32_t index : draw.vertexBuffers)
+			{
+				Transist(bufferStates[index], STATE_VERTEX_AND_CONSTANT_BUFFER, [&] { barriers += bufferResources[index].buffer->driverData[0] + 1; });
+				const BufferHot& buf = buffers[index];
+				sum += buf.gpuAddress + buf.size + buf.stride;
+			}
+
+			uint32_t ib = draw.indexBuffer;
+			Transist(bufferStates[ib], STATE_INDEX_BUFFER, [&] { barriers += bufferResources[ib].buffer->driverData[0] + 1; });
+			sum += buffers[ib].gpuAddress + buffers[ib].size + buffers[ib].format;
+
+			for (uint32_t index : draw.constantBuffers)
+			{
+				Transist(bufferStates[index], STATE_VERTEX_AND_CONSTANT_BUFFER, [&] { barriers += bufferResources[index].buffer->driverData[0] + 1; });
+				sum += buffers[index].gpuAddress;
+			}
+
+			for (uint32_t index : draw.textures)
+			{
+				const TextureHot& tex = textures[index];
+				Transist(textureStates[index], STATE_PIXEL_SHADER_RESOURCE, [&] { barriers += tex.texture->driverData[0] + 1; });
+				sum += reinterpret_cast<uintptr_t>(tex.texture);
+			}
+
+			return sum;
+		}
+
+		void Update(uint32_t index)
+		{
+			bufferStates[index] = STATE_COPY_DEST;
+		}
+	};
+
+	struct Packed
+	{
+		ResourcePool<BufferPacked>	buffers;
+		ResourcePool<BufferCold>	bufferResources;
+		ResourcePool<TextureHot>	textures;
+		ResourcePool<ResourceState>	textureStates;
+		ResourcePool<TextureDesc>	textureDescs;
+
+		void Init(const Scene& scene)
+		{
+			buffers.Init(scene.bufferCount);
+			bufferResources.Init(scene.bufferCount);
+			textures.Init(scene.textureCount);
+			textureStates.Init(scene.textureCount);
+			textureDescs.Init(scene.textureCount);
+			for (uint32_t i = 0; i < scene.bufferCount; ++i)
+			{
+				Resource* resource = scene.resources[i];
+				bufferResources.Acquire(i).buffer = resource;
+				BufferPacked& buf = buffers.Acquire(i);
+				buf.gpuAddress = resource->gpuAddress;
+				buf.size = 65536;
+				buf.stride = 32;
+				buf.state = BUFFER_STATE_COMMON;
+			}
+			for (uint32_t i = 0; i < scene.textureCount; ++i)
+			{
+				textures.Acquire(i).texture = scene.resources[scene.bufferCount + i];
+				textureStates.Acquire(i) = STATE_COMMON;
+				TextureDesc& desc = textureDescs.Acquire(i);
+				desc.width = desc.height = 1024;
+			}
+		}
+
+		// as TransistBuffer does, the state wanted is mostly a constant and its
+		// index folds away, the table is only read on a barrier
+		inline void TransistBuffer(uint32_t index, ResourceState dest, uint64_t& barriers)
+		{
+			BufferPacked& buf = buffers[index];
+			if (BufferStateIndex(dest) != buf.state)
+			{
+				barriers += bufferResources[index].buffer->driverData[0] + 1;
+				buf.state = BufferStateIndex(dest);
+			}
+		}
+
+		uint64_t Bind(const Draw& draw, uint64_t& barriers)
+		{
+			uint64_t sum = 0;
+			for (uint32_t index : draw.vertexBuffers)
+			{
+				TransistBuffer(index, STATE_VERTEX_AND_CONSTANT_BUFFER, barriers);
+				const BufferPacked& buf = buffers[index];
+				sum += buf.gpuAddress + buf.size + buf.stride;
+			}
+
+			uint32_t ib = draw.indexBuffer;
+			TransistBuffer(ib, STATE_INDEX_BUFFER, barriers);
+			sum += buffers[ib].gpuAddress + buffers[ib].size + buffers[ib].format;
+
+			for (uint32_t index : draw.constantBuffers)
+			{
+				TransistBuffer(index, STATE_VERTEX_AND_CONSTANT_BUFFER, barriers);
+				sum += buffers[index].gpuAddress;
+			}
+
+			for (uint32_t index : draw.textures)
+			{
+				const TextureHot& tex = textures[index];
+				Transist(textureStates[index], STATE_PIXEL_SHADER_RESOURCE, [&] { barriers += tex.texture->driverData[0] + 1; });
+				sum += reinterpret_cast<uintptr_t>(tex.texture);
+			}
+
+			return sum;
+		}
+
+		void Update(uint32_t index)
+		{
+			buffers[index].state = BUFFER_STATE_COPY_DEST;
+		}
+	};
+
+	// hardware counters of the thread, none if perf events aren't allowed
+	struct Counters
+	{
+		int							cacheMisses;
+		int							l1Misses;
+
+#if defined(__linux__)
+		static int Open(uint32_t type, uint64_t config)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+
+		Counters()
+			:
+			cacheMisses(Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES)),
+			l1Misses(Open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)))
+		{}
+
+		~Counters()
+		{
+			if (cacheMisses >= 0) close(cacheMisses);
+			if (l1Misses >= 0) close(l1Misses);
+		}
+
+		static void Start(int fd)
+		{
+			if (fd < 0) return;
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+
+		static int64_t Stop(int fd)
+		{
+			if (fd < 0) return -1;
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			int64_t count = 0;
+			return sizeof(count) == read(fd, &count, sizeof(count)) ? count : -1;
+		}
+#else
+		Counters() : cacheMisses(-1), l1Misses(-1) {}
+
+		static void Start(int) {}
+		static int64_t Stop(int) { return -1; }
+#endif
+	};
+
+	struct Result
+	{
+		double						nsPerDraw;
+		double						cacheMissesPerDraw;		// negative if not counted
+		double						l1MissesPerDraw;
+		uint64_t					checksum;
+	};
+
+	template<typename Records>
+	Result Run(const Scene& scene, Counters& counters)
+	{
+		Records records;
+		records.Init(scene);
+
+		Result result = {};
+		uint64_t barriers = 0;
+		uint32_t drawCount = static_cast<uint32_t>(scene.draws.size());
+		uint32_t frames = 0;
+		int64_t cacheMisses = 0;
+		int64_t l1Misses = 0;
+		double seconds = 0.0;
+
+		while (seconds < 1.0 || frames < 3)
+		{
+			// a few buffers are updated every frame
+			for (uint32_t i = 0; i < drawCount / 64; ++i)
+				records.Update(scene.draws[(i * 7919 + frames) % drawCount].constantBuffers[0]);
+
+			Counters::Start(counters.cacheMisses);
+			Counters::Start(counters.l1Misses);
+			auto start = std::chrono::steady_clock::now();
+
+			for (const Draw& draw : scene.draws)
+				result.checksum += records.Bind(draw, barriers);
+
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			int64_t misses = Counters::Stop(counters.cacheMisses);
+			int64_t l1 = Counters::Stop(counters.l1Misses);
+			cacheMisses = misses < 0 || cacheMisses < 0 ? -1 : cacheMisses + misses;
+			l1Misses = l1 < 0 || l1Misses < 0 ? -1 : l1Misses + l1;
+			frames++;
+		}
+
+		double draws = static_cast<double>(drawCount) * frames;
+		result.nsPerDraw = seconds * 1e9 / draws;
+		result.cacheMissesPerDraw = cacheMisses < 0 ? -1.0 : cacheMisses / draws;
+		result.l1MissesPerDraw = l1Misses < 0 ? -1.0 : l1Misses / draws;
+		result.checksum += barriers;
+		return result;
+	}
+
+	void Print(const char* name, const Result& result)
+	{
+		printf("%-12s %9.1f", name, result.nsPerDraw);
+		if (result.cacheMissesPerDraw < 0.0)
+			printf("  %14s", "n/a");
+		else
+			printf("  %14.2f", result.cacheMissesPerDraw);
+		if (result.l1MissesPerDraw < 0.0)
+			printf("  %15s\n", "n/a");
+		else
+			printf("  %15.2f\n", result.l1MissesPerDraw);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t drawCount = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 100000;
+	uint32_t bufferCount = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 65536;
+	uint32_t textureCount = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 16384;
+
+	if (0 == drawCount || 0 == bufferCount || 0 == textureCount)
+	{
+		printf("usage: %s [draws] [buffers] [textures]\n", argv[0]);
+		return 1;
+	}
+
+	Scene scene;
+	BuildScene(drawCount, bufferCount, textureCount, scene);
+	Counters counters;
+
+	printf("%u draws a frame, %u buffers, %u textures\n\n", drawCount, bufferCount, textureCount);
+	printf("records      ns/draw  cache miss/draw  L1D miss/draw\n");
+
+	Result before = Run<Before>(scene, counters);
+	Result after = Run<After>(scene, counters);
+	Result packed = Run<Packed>(scene, counters);
+	Print("before split", before);
+	Print("hot/cold", after);
+	Print("packed state", packed);
+
+	ReleaseScene(scene);
+
+	// keeps the lookups from being optimized away
+	return before.checksum == after.checksum + 1 || after.checksum == packed.checksum + 1 ? 2 : 0;
+}
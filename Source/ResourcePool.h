@@ -0,0 +1,121 @@
+#pragma once
+
+#include "common.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace bamboo
+{
+	// Storage for the backend records of a resource type, indexed by the slot
+	// index of the handles. Records live in fixed size pages which are only
+	// allocated when a slot in them is acquired, so a pool costs nothing but
+	// the page table until it is used. Pages never move, references to the
+	// records stay valid until Release.
+	template<typename T, uint32_t pageBits = 6>
+	class ResourcePool
+	{
+	public:
+		static constexpr uint32_t pageSize = 1u << pageBits;
+
+		ResourcePool()
+			:
+			pages(nullptr),
+			pageCount(0),
+			capacity(0)
+		{}
+
+		~ResourcePool()
+		{
+			Release();
+		}
+
+		ResourcePool(const ResourcePool&) = delete;
+		ResourcePool& operator=(const ResourcePool&) = delete;
+
+		void Init(size_t capacity)
+		{
+			Release();
+
+			this->capacity = capacity;
+			pageCount = (capacity + pageSize - 1) >> pageBits;
+			if (pageCount > 0)
+			{
+				pages = new T*[pageCount];
+				for (size_t i = 0; i < pageCount; ++i)
+					pages[i] = nullptr;
+			}
+		}
+
+		void Release()
+		{
+			for (size_t i = 0; i < pageCount; ++i)
+				delete[] pages[i];
+			delete[] pages;
+
+			pages = nullptr;
+			pageCount = 0;
+			capacity = 0;
+		}
+
+		// record of a newly allocated slot, brings in its page if needed
+		T& Acquire(uint32_t index)
+		{
+			assert(index < capacity);
+			T*& page = pages[index >> pageBits];
+			if (nullptr == page)
+				page = new T[PageLength(index >> pageBits)]();
+			return page[index & (pageSize - 1)];
+		}
+
+		T& operator[](uint32_t index)
+		{
+			assert(index < capacity && nullptr != pages[index >> pageBits]);
+			return pages[index >> pageBits][index & (pageSize - 1)];
+		}
+
+		const T& operator[](uint32_t index) const
+		{
+			assert(index < capacity && nullptr != pages[index >> pageBits]);
+			return pages[index >> pageBits][index & (pageSize - 1)];
+		}
+
+		// brings the record of a slot in the cache ahead of its use, slots
+		// out of range or in pages not brought in are ignored
+		void Prefetch(uint32_t index) const
+		{
+			if (index < capacity && nullptr != pages[index >> pageBits])
+				BAMBOO_PREFETCH(&pages[index >> pageBits][index & (pageSize - 1)]);
+		}
+
+		size_t Capacity() const
+		{
+			return capacity;
+		}
+
+		// bytes taken by the page table and the pages brought in
+		size_t MemoryUsage() const
+		{
+			size_t bytes = pageCount * sizeof(T*);
+			for (size_t i = 0; i < pageCount; ++i)
+			{
+				if (nullptr != pages[i])
+					bytes += PageLength(i) * sizeof(T);
+			}
+			return bytes;
+		}
+
+	private:
+		// the last page is cut to the capacity
+		size_t PageLength(size_t page) const
+		{
+			size_t begin = page << pageBits;
+			return capacity - begin < pageSize ? capacity - begin : pageSize;
+		}
+
+		T**		pages;
+		size_t	pageCount;
+		size_t	capacity;
+	};
+}
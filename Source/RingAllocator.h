@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace bamboo
+{
+	namespace memory
+	{
+		/*
+		Linear allocator over a ring of memory, for data that only lives until
+		the GPU has consumed it. Allocations of a frame are a pointer bump, at
+		the end of the frame they are tagged with the fence value signaled for
+		it and the whole region is given back at once when the fence reaches
+		that value. Like the other allocators it only deals with offsets, the
+		memory is owned by the caller. Up to maxFrames frames can be in flight.
+		*/
+		template<size_t maxFrames = 4>
+		struct RingAllocator
+		{
+			static constexpr uint64_t invalid_offset = UINT64_MAX;
+
+			struct Frame
+			{
+				uint64_t	fenceValue;
+				uint64_t	size;		// bytes taken by the frame, including padding
+			};
+
+			uint64_t	capacity;
+			uint64_t	head;			// where the next allocation starts
+			uint64_t	used;			// live bytes, they end at head
+			uint64_t	frameSize;		// bytes taken by the current frame so far
+
+			Frame		frames[maxFrames];
+			size_t		frameHead;
+			size_t		frameCount;
+
+			void initialize(uint64_t size)
+			{
+				capacity = size;
+				head = 0;
+				used = 0;
+				frameSize = 0;
+				frameHead = 0;
+				frameCount = 0;
+			}
+
+			// alignment must be power of 2
+			uint64_t allocate(uint64_t size, uint64_t alignment)
+			{
+				assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+				uint64_t start = (head + alignment - 1) & ~(alignment - 1);
+				if (start + size > capacity)
+				{
+					// doesn't fit before the end, skip the rest and wrap around
+					start = 0;
+				}
+
+				// the live bytes are right behind head, so as long as the padding
+				// and the allocation fit in what is not used, they don't overlap
+				uint64_t taken = (start >= head ? start - head : capacity - head) + size;
+				if (used + taken > capacity)
+					return invalid_offset;
+
+				head = start + size;
+				used += taken;
+				frameSize += taken;
+
+				return start;
+			}
+
+			// close the current frame, its allocations go back when the fence
+			// reaches fenceValue, returns false when too many frames are pending:
+			// the caller waits for oldestFenceValue, retires and tries again
+			bool finishFrame(uint64_t fenceValue)
+			{
+				if (frameCount >= maxFrames)
+					return false;
+
+				Frame& frame = frames[(frameHead + frameCount) % maxFrames];
+				frame.fenceValue = fenceValue;
+				frame.size = frameSize;
+				++frameCount;
+
+				frameSize = 0;
+				return true;
+			}
+
+			// give back the frames whose fence value has been reached
+			void retire(uint64_t completedFenceValue)
+			{
+				while (frameCount > 0 && frames[frameHead].fenceValue <= completedFenceValue)
+				{
+					const Frame& frame = frames[frameHead];
+					assert(used >= frame.size);
+					used -= frame.size;
+
+					frameHead = (frameHead + 1) % maxFrames;
+					--frameCount;
+				}
+
+				// nothing alive, start over from the beginning
+				if (0 == used)
+					head = 0;
+			}
+
+			uint64_t freeRemaining() const
+			{
+				return capacity - used;
+			}
+
+			// of the first frame pending, there must be one
+			uint64_t oldestFenceValue() const
+			{
+				assert(frameCount > 0);
+				return frames[frameHead].fenceValue;
+			}
+		};
+	}
+}
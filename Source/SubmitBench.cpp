@@ -0,0 +1,296 @@
+// Measures how fast a frame of draws gets from the application to the
+// backend, for each way of handing them over: a DrawCall per Draw, an array
+// of DrawItems given to Submit, a CommandStream, and a DrawQueue sorting
+// the draws by key.
+//
+//   SubmitBench [draws] [frames]
+//
+// The draws go to the null backend, which walks them as a real one does
+// without a device, so what is measured is the recording, the memory the
+// draws are read from and the dispatch. The draws bind one of 64 meshes,
+// 256 constant buffers and 64 textures with one of 4 pipeline states, and
+// root constants that change every draw. For each way it prints the best
+// frame time for recording and for submitting, the bytes a draw takes and
+// the rate they are read at while submitting. Build without _DEBUG, or the
+// validation layer is measured too. Off Windows it builds with:
+//
+//   g++ -std=c++14 -O2 -pthread -ISource Source/SubmitBench.cpp Source/DrawQueue.cpp Source/GraphicsAPI.cpp
+//       Source/GraphicsAPINull.cpp Source/GraphicsAPIValidation.cpp Source/CommandStream.cpp -o SubmitBench
+
+#include "GraphicsAPI.h"
+#include "GraphicsAPINull.h"
+#include "CommandStream.h"
+#include "DrawQueue.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	using namespace bamboo;
+
+	constexpr uint32_t PipelineCount = 4;
+	constexpr uint32_t MeshCount = 64;
+	constexpr uint32_t ConstantBufferCount = 256;
+	constexpr uint32_t TextureCount = 64;
+
+	struct Scene
+	{
+		BindingLayoutHandle			layout;
+		VertexShaderHandle			vs;
+		PixelShaderHandle			ps[PipelineCount];
+		PipelineStateHandle			pipelines[PipelineCount];
+		BufferHandle				vertexBuffers[MeshCount];
+		BufferHandle				indexBuffers[MeshCount];
+		BufferHandle				constantBuffers[ConstantBufferCount];
+		TextureHandle				textures[TextureCount];
+		SamplerHandle				sampler;
+	};
+
+	void CreateScene(GraphicsAPI* api, Scene& scene)
+	{
+		// 4 root constants, a constant buffer, a texture and a sampler
+		BindingLayout layout = {};
+		layout.SetEntry(0, BINDING_SLOT_TYPE_CONSTANT, SHADER_VISIBILITY_ALL, 4, 0);
+		layout.SetEntry(1, BINDING_SLOT_TYPE_CBV, SHADER_VISIBILITY_ALL, 1, 0);
+		layout.SetEntry(2, BINDING_SLOT_TYPE_TABLE, SHADER_VISIBILITY_PIXEL, 1, 0);
+		layout.SetEntry(3, BINDING_SLOT_TYPE_SRV, SHADER_VISIBILITY_PIXEL, 1, 0);
+		layout.SetEntry(4, BINDING_SLOT_TYPE_TABLE, SHADER_VISIBILITY_PIXEL, 1, 0);
+		layout.SetEntry(5, BINDING_SLOT_TYPE_SAMPLER, SHADER_VISIBILITY_PIXEL, 1, 0);
+		scene.layout = api->CreateBindingLayout(layout);
+
+		uint8_t bytecode[16] = {};
+		scene.vs = api->CreateVertexShader(bytecode, sizeof(bytecode));
+
+		for (uint32_t i = 0; i < PipelineCount; ++i)
+		{
+			bytecode[0] = static_cast<uint8_t>(i + 1);
+			scene.ps[i] = api->CreatePixelShader(bytecode, sizeof(bytecode));
+
+			PipelineState state = {};
+			state.BindingLayout = scene.layout;
+			state.VertexShader = scene.vs;
+			state.PixelShader = scene.ps[i];
+			state.VertexLayout.ElementCount = 1;
+			state.PrimitiveType = PRIMITIVE_TRIANGLES;
+			scene.pipelines[i] = api->CreatePipelineState(state);
+		}
+
+		float data[64] = {};
+		for (uint32_t i = 0; i < MeshCount; ++i)
+		{
+			scene.vertexBuffers[i] = api->CreateBuffer(sizeof(data), BINDING_VERTEX_BUFFER);
+			api->UpdateBuffer(scene.vertexBuffers[i], sizeof(data), data, 16);
+			scene.indexBuffers[i] = api->CreateBuffer(sizeof(data), BINDING_INDEX_BUFFER);
+			api->UpdateBuffer(scene.indexBuffers[i], sizeof(data), data, 4, FORMAT_R32_UINT);
+		}
+
+		for (uint32_t i = 0; i < ConstantBufferCount; ++i)
+			scene.constantBuffers[i] = api->CreateBuffer(256, BINDING_CONSTANT_BUFFER);
+
+		for (uint32_t i = 0; i < TextureCount; ++i)
+			scene.textures[i] = api->CreateTexture(TEXTURE_2D, FORMAT_R8G8B8A8_UNORM, BINDING_SHADER_RESOURCE, 64, 64);
+
+		scene.sampler = api->CreateSampler();
+	}
+
+	// the draw i of a frame, what a scene traversal would fill in
+	void FillDraw(const Scene& scene, uint32_t i, DrawCall& drawcall, PipelineStateHandle& pipeline)
+	{
+		uint32_t mesh = (i * 7) % MeshCount;
+
+		drawcall.ElementCount = 36 + mesh * 3;
+		drawcall.VertexBufferCount = 1;
+		drawcall.VertexBuffers[0] = scene.vertexBuffers[mesh];
+		drawcall.HasIndexBuffer = 1;
+		drawcall.IndexBuffer = scene.indexBuffers[mesh];
+
+		drawcall.ResourceBindingData[0] = i;
+		drawcall.ResourceBindingData[1] = mesh;
+		drawcall.ResourceBindingData[2] = i * 3;
+		drawcall.ResourceBindingData[3] = 1;
+		drawcall.ResourceBindingData[4] = scene.constantBuffers[i % ConstantBufferCount].id;
+		drawcall.ResourceBindingData[5] = scene.textures[(i / 4) % TextureCount].id;
+		drawcall.ResourceBindingData[6] = scene.sampler.id;
+
+		pipeline = scene.pipelines[(i / 16) % PipelineCount];
+	}
+
+	struct Result
+	{
+		double						recordTime;		// in milliseconds, the best frame
+		double						submitTime;
+		double						bytesPerDraw;
+	};
+
+	double Milliseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// a frame is recorded, then submitted, record returns the bytes the draws took
+	template<typename Record, typename Submit>
+	Result Run(GraphicsAPI* api, uint32_t drawCount, uint32_t frameCount, Record record, Submit submit)
+	{
+		Result result = {};
+		size_t bytes = 0;
+
+		null::ResetStatistics(api);
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			auto start = std::chrono::steady_clock::now();
+			bytes = record();
+			double recordTime = Milliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			submit();
+			double submitTime = Milliseconds(start);
+
+			api->Present();
+
+			if (0 == frame || recordTime < result.recordTime) result.recordTime = recordTime;
+			if (0 == frame || submitTime < result.submitTime) result.submitTime = submitTime;
+		}
+
+		null::Statistics stats;
+		null::GetStatistics(api, stats);
+		if (stats.DrawCalls != drawCount * frameCount || stats.DroppedDrawCalls != 0)
+			printf("%u draws of %u went through, %u dropped\n", stats.DrawCalls, drawCount * frameCount, stats.DroppedDrawCalls);
+
+		result.bytesPerDraw = static_cast<double>(bytes) / drawCount;
+		return result;
+	}
+
+	void Print(const char* name, uint32_t drawCount, const Result& result)
+	{
+		double gbPerSecond = result.bytesPerDraw * drawCount / (result.submitTime * 1e6);
+		printf("%-10s %10.3f %10.3f %10.1f %10.1f %8.2f\n", name, result.recordTime, result.submitTime,
+			result.submitTime * 1e6 / drawCount, result.bytesPerDraw, gbPerSecond);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t drawCount = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 100000;
+	uint32_t frameCount = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 20;
+
+	if (0 == drawCount || 0 == frameCount)
+	{
+		printf("usage: %s [draws] [frames]\n", argv[0]);
+		return 1;
+	}
+
+	GraphicsAPI* api = InitGraphicsAPI(Null, nullptr);
+	if (nullptr == api)
+	{
+		printf("can't create the null backend\n");
+		return 1;
+	}
+
+	Scene scene;
+	CreateScene(api, scene);
+
+	std::vector<DrawCall> drawcalls(drawCount);
+	std::vector<PipelineStateHandle> pipelines(drawCount);
+	std::vector<DrawItem> items(drawCount);
+	CommandStream stream;
+	DrawQueue queue;
+	queue.Init(drawCount);
+
+	// every way records the same draws, from a DrawCall the traversal fills in
+	auto recordCalls = [&]()
+	{
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			DrawCall& drawcall = drawcalls[i];
+			memset(&drawcall, 0, sizeof(drawcall));
+			FillDraw(scene, i, drawcall, pipelines[i]);
+		}
+		return drawCount * (sizeof(DrawCall) + sizeof(PipelineStateHandle));
+	};
+
+	printf("%u draws a frame, %u frames, DrawCall is %u bytes\n\n", drawCount, frameCount, static_cast<uint32_t>(sizeof(DrawCall)));
+	printf("           record ms  submit ms    ns/draw bytes/draw     GB/s\n");
+
+	Print("drawcall", drawCount, Run(api, drawCount, frameCount,
+		recordCalls,
+		[&]()
+		{
+			for (uint32_t i = 0; i < drawCount; ++i)
+				api->Draw(pipelines[i], drawcalls[i]);
+		}));
+
+	Print("items", drawCount, Run(api, drawCount, frameCount,
+		[&]()
+		{
+			size_t bytes = recordCalls();
+			for (uint32_t i = 0; i < drawCount; ++i)
+				items[i] = DrawItem{ pipelines[i], &drawcalls[i] };
+			return bytes + drawCount * sizeof(DrawItem);
+		},
+		[&]()
+		{
+			api->Submit(items.data(), items.size());
+		}));
+
+	Print("stream", drawCount, Run(api, drawCount, frameCount,
+		[&]()
+		{
+			DrawCall drawcall;
+			PipelineStateHandle pipeline;
+			stream.Clear();
+			for (uint32_t i = 0; i < drawCount; ++i)
+			{
+				memset(&drawcall, 0, sizeof(drawcall));
+				FillDraw(scene, i, drawcall, pipeline);
+				stream.Draw(pipeline, drawcall);
+			}
+			return stream.Size();
+		},
+		[&]()
+		{
+			api->Submit(stream);
+		}));
+
+	// the encoders keep their viewports, so the draws can be read out of order
+	size_t queueStreamSize = 0;
+	{
+		CommandStream unelided(false);
+		DrawCall drawcall;
+		PipelineStateHandle pipeline;
+		for (uint32_t i = 0; i < drawCount; ++i)
+		{
+			memset(&drawcall, 0, sizeof(drawcall));
+			FillDraw(scene, i, drawcall, pipeline);
+			unelided.Draw(pipeline, drawcall);
+		}
+		queueStreamSize = unelided.Size();
+	}
+
+	Print("queue", drawCount, Run(api, drawCount, frameCount,
+		[&]()
+		{
+			DrawCall drawcall;
+			PipelineStateHandle pipeline;
+			queue.Clear();
+			for (uint32_t i = 0; i < drawCount; ++i)
+			{
+				memset(&drawcall, 0, sizeof(drawcall));
+				FillDraw(scene, i, drawcall, pipeline);
+				queue.Draw(DefaultSortKeyLayout.Encode(0, 0, pipeline, i % MeshCount, 0), pipeline, drawcall);
+			}
+			queue.Sort();
+			return drawCount * sizeof(DrawQueueEntry) + queueStreamSize;
+		},
+		[&]()
+		{
+			queue.Submit(api);
+		}));
+
+	api->Shutdown();
+	return 0;
+}
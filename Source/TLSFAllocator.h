@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bamboo
+{
+	namespace memory
+	{
+		constexpr uint32_t log2_floor(uint64_t x)
+		{
+			return x > 1 ? 1 + log2_floor(x >> 1) : 0;
+		}
+
+		/*
+		Two-Level Segregated Fit allocator, see "TLSF: a New Dynamic Memory
+		Allocator for Real-Time Systems" (Masmano et al.).
+
+		It has the same interface as FastBuddyAllocator and manages an imaginary
+		space as well, so the block records are kept out of band in the memory
+		given to create(). Sizes are rounded up to granularity (instead of the
+		next power of 2), which must be the placement alignment the heap needs.
+		Free blocks are kept in lists segregated by a first level (power of 2)
+		and a second level (slBits linear subdivisions of it) size class, with
+		a bitmap on each level, so allocate and deallocate are O(1).
+		*/
+		template<uint64_t memSize, uint64_t granularity, typename size_type = uint64_t>
+		struct TLSFAllocator
+		{
+			static constexpr uint32_t blockCount = static_cast<uint32_t>(memSize / granularity);
+
+			static_assert(memSize <= static_cast<size_type>(~size_type(0)), "memSize doesn't fit in size_type");
+			static_assert(granularity > 0 && memSize % granularity == 0, "memSize must be multiple of granularity");
+			static_assert(memSize / granularity < (uint64_t(1) << 31), "too many blocks");
+
+			static constexpr uint32_t slBits = 4;
+			static constexpr uint32_t slCount = 1u << slBits;
+
+			// sizes below slCount blocks all go to first level 0
+			static constexpr uint32_t flCount = log2_floor(blockCount) < slBits ? 1 : log2_floor(blockCount) - slBits + 2;
+
+			static constexpr uint32_t none = UINT32_MAX;
+
+			// returned by allocateOffset when there is no space
+			static constexpr size_type invalid_offset = static_cast<size_type>(~size_type(0));
+
+			struct Block
+			{
+				uint32_t	size;		// in granularity, 0 if the record is not a block start
+				uint32_t	prevPhys;	// block right before this one, or none
+				uint32_t	prevFree;	// links in the free list, valid when free
+				uint32_t	nextFree;
+				uint32_t	isFree;
+			};
+
+			struct Header
+			{
+				size_type	freeBytes;
+				uint32_t	flBitmap;
+				uint32_t	slBitmap[flCount];
+				uint32_t	freeLists[flCount][slCount];
+			};
+
+			// size of the metadata, a header and one record per granularity block
+			static constexpr size_t treeSize = sizeof(Header) + alignof(Block) + sizeof(Block) * blockCount;
+
+			Header header;
+			Block blocks[1];
+
+			static TLSFAllocator* create(void* addr)
+			{
+				TLSFAllocator* obj = reinterpret_cast<TLSFAllocator*>(addr);
+				obj->initialize();
+				return obj;
+			}
+
+			static inline uint32_t find_first_set(uint32_t x)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, x);
+				return index;
+#else
+				return static_cast<uint32_t>(__builtin_ctz(x));
+#endif
+			}
+
+			static inline uint32_t find_last_set(uint32_t x)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanReverse(&index, x);
+				return index;
+#else
+				return static_cast<uint32_t>(31 - __builtin_clz(x));
+#endif
+			}
+
+			// size class of a block of the given size
+			static inline void mapping_insert(uint32_t size, uint32_t& fl, uint32_t& sl)
+			{
+				if (size < slCount)
+				{
+					fl = 0;
+					sl = size;
+				}
+				else
+				{
+					uint32_t l = find_last_set(size);
+					fl = l - slBits + 1;
+					sl = (size >> (l - slBits)) ^ slCount;
+				}
+			}
+
+			// size class of which any block can hold the given size
+			static inline void mapping_search(uint32_t size, uint32_t& fl, uint32_t& sl)
+			{
+				if (size >= slCount)
+				{
+					uint32_t round = (1u << (find_last_set(size) - slBits)) - 1;
+					size += round;
+				}
+				mapping_insert(size, fl, sl);
+			}
+
+			// lower bound of the size class
+			static inline uint32_t class_size(uint32_t fl, uint32_t sl)
+			{
+				return fl == 0 ? sl : ((slCount | sl) << (fl - 1));
+			}
+
+			void initialize()
+			{
+				header.freeBytes = static_cast<size_type>(memSize);
+				header.flBitmap = 0;
+				for (uint32_t fl = 0; fl < flCount; ++fl)
+				{
+					header.slBitmap[fl] = 0;
+					for (uint32_t sl = 0; sl < slCount; ++sl)
+						header.freeLists[fl][sl] = none;
+				}
+
+				for (uint32_t i = 0; i < blockCount; ++i)
+					blocks[i].size = 0;
+
+				// the whole space as one free block
+				blocks[0].size = blockCount;
+				blocks[0].prevPhys = none;
+				insert(0);
+			}
+
+			void insert(uint32_t index)
+			{
+				Block& block = blocks[index];
+				uint32_t fl, sl;
+				mapping_insert(block.size, fl, sl);
+
+				uint32_t head = header.freeLists[fl][sl];
+				block.isFree = 1;
+				block.prevFree = none;
+				block.nextFree = head;
+				if (none != head)
+					blocks[head].prevFree = index;
+
+				header.freeLists[fl][sl] = index;
+				header.flBitmap |= 1u << fl;
+				header.slBitmap[fl] |= 1u << sl;
+			}
+
+			void remove(uint32_t index)
+			{
+				Block& block = blocks[index];
+				uint32_t fl, sl;
+				mapping_insert(block.size, fl, sl);
+
+				if (none != block.prevFree)
+					blocks[block.prevFree].nextFree = block.nextFree;
+				else
+					header.freeLists[fl][sl] = block.nextFree;
+
+				if (none != block.nextFree)
+					blocks[block.nextFree].prevFree = block.prevFree;
+
+				if (none == header.freeLists[fl][sl])
+				{
+					header.slBitmap[fl] &= ~(1u << sl);
+					if (0 == header.slBitmap[fl])
+						header.flBitmap &= ~(1u << fl);
+				}
+
+				block.isFree = 0;
+			}
+
+			// the first free block of a size class not smaller than (fl, sl)
+			uint32_t find_suitable(uint32_t fl, uint32_t sl) const
+			{
+				if (fl >= flCount)
+					return none;
+
+				uint32_t slMap = header.slBitmap[fl] & (~0u << sl);
+				if (0 == slMap)
+				{
+					uint32_t flMap = (fl + 1 < 32) ? (header.flBitmap & (~0u << (fl + 1))) : 0;
+					if (0 == flMap)
+						return none;
+
+					fl = find_first_set(flMap);
+					slMap = header.slBitmap[fl];
+				}
+				sl = find_first_set(slMap);
+
+				return header.freeLists[fl][sl];
+			}
+
+			static inline uint32_t blocks_of(size_type size)
+			{
+				return size == 0 ? 1 : static_cast<uint32_t>((size + granularity - 1) / granularity);
+			}
+
+			size_type allocateOffset(size_type size)
+			{
+				if (size > memSize)
+					return invalid_offset;
+
+				uint32_t need = blocks_of(size);
+				uint32_t fl, sl;
+				mapping_search(need, fl, sl);
+
+				uint32_t index = find_suitable(fl, sl);
+				if (none == index)
+					return invalid_offset;
+
+				remove(index);
+
+				Block& block = blocks[index];
+				assert(block.size >= need);
+
+				// give the tail back
+				if (block.size > need)
+				{
+					uint32_t rest = index + need;
+					blocks[rest].size = block.size - need;
+					blocks[rest].prevPhys = index;
+
+					uint32_t next = index + block.size;
+					if (next < blockCount)
+						blocks[next].prevPhys = rest;
+
+					block.size = need;
+					insert(rest);
+				}
+
+				header.freeBytes -= static_cast<size_type>(need * granularity);
+
+				return static_cast<size_type>(index * granularity);
+			}
+
+			void deallocateOffset(size_type offset)
+			{
+				assert(offset < memSize && offset % granularity == 0);
+
+				uint32_t index = static_cast<uint32_t>(offset / granularity);
+				assert(blocks[index].size > 0 && !blocks[index].isFree);
+
+				header.freeBytes += static_cast<size_type>(blocks[index].size * granularity);
+
+				// merge with the previous block
+				uint32_t prev = blocks[index].prevPhys;
+				if (none != prev && blocks[prev].isFree)
+				{
+					remove(prev);
+					blocks[prev].size += blocks[index].size;
+					blocks[index].size = 0;
+					index = prev;
+				}
+
+				// merge with the next block
+				uint32_t next = index + blocks[index].size;
+				if (next < blockCount && blocks[next].isFree)
+				{
+					remove(next);
+					blocks[index].size += blocks[next].size;
+					blocks[next].size = 0;
+				}
+
+				next = index + blocks[index].size;
+				if (next < blockCount)
+					blocks[next].prevPhys = index;
+
+				insert(index);
+			}
+
+			// the base addres of the managed memory is provided here,
+			// because it is imaginary to the allocator, we don't keep it.
+			void* allocate(void* baseAddr, size_type size)
+			{
+				size_type offset = allocateOffset(size);
+				if (invalid_offset == offset)
+					return nullptr;
+
+				return reinterpret_cast<void*>(reinterpret_cast<char*>(baseAddr) + offset);
+			}
+
+			void deallocate(void* baseAddr, void* addr)
+			{
+				deallocateOffset(static_cast<size_type>(
+					reinterpret_cast<char*>(addr) - reinterpret_cast<char*>(baseAddr)
+					));
+			}
+
+			// total free bytes, O(1)
+			size_type freeRemaining() const
+			{
+				return header.freeBytes;
+			}
+
+			// the largest size allocate() is guaranteed to succeed with, that
+			// is the lower bound of the highest non-empty size class, O(1)
+			size_type largestFree() const
+			{
+				if (0 == header.flBitmap)
+					return 0;
+
+				uint32_t fl = find_last_set(header.flBitmap);
+				uint32_t sl = find_last_set(header.slBitmap[fl]);
+				return static_cast<size_type>(class_size(fl, sl) * granularity);
+			}
+
+			// whether allocate(size) would succeed, without touching the lists
+			bool canAllocate(size_type size) const
+			{
+				if (size > memSize)
+					return false;
+
+				uint32_t fl, sl;
+				mapping_search(blocks_of(size), fl, sl);
+				return none != find_suitable(fl, sl);
+			}
+
+			// check the block records and free lists against their invariants,
+			// O(n), for debugging only
+			bool validate() const
+			{
+				uint32_t freeCount = 0;
+				size_type freeBytes = 0;
+				uint32_t prev = none;
+				for (uint32_t index = 0; index < blockCount; index += blocks[index].size)
+				{
+					const Block& block = blocks[index];
+					if (0 == block.size || index + block.size > blockCount || block.prevPhys != prev)
+						return false;
+
+					if (block.isFree)
+					{
+						// free neighbours should have been merged
+						if (none != prev && blocks[prev].isFree)
+							return false;
+
+						++freeCount;
+						freeBytes += static_cast<size_type>(block.size * granularity);
+					}
+
+					prev = index;
+				}
+
+				if (freeBytes != header.freeBytes)
+					return false;
+
+				uint32_t listed = 0;
+				for (uint32_t fl = 0; fl < flCount; ++fl)
+				{
+					if (((header.flBitmap >> fl) & 1) != (0 != header.slBitmap[fl] ? 1u : 0u))
+						return false;
+
+					for (uint32_t sl = 0; sl < slCount; ++sl)
+					{
+						uint32_t index = header.freeLists[fl][sl];
+						if (((header.slBitmap[fl] >> sl) & 1) != (none != index ? 1u : 0u))
+							return false;
+
+						uint32_t prevFree = none;
+						for (; none != index; prevFree = index, index = blocks[index].nextFree)
+						{
+							uint32_t f, s;
+							mapping_insert(blocks[index].size, f, s);
+							if (!blocks[index].isFree || blocks[index].prevFree != prevFree || f != fl || s != sl)
+								return false;
+
+							if (++listed > freeCount)
+								return false;
+						}
+					}
+				}
+
+				return listed == freeCount;
+			}
+		};
+	}
+}
@@ -0,0 +1,122 @@
+// Plays a trace recorded with trace::InitGraphicsAPITrace as fast as the
+// backend takes it and prints the CPU time of every frame.
+//
+//   TraceReplay <trace file> [null|d3d11|d3d12] [runs]
+//
+// The null backend needs no window and no device, it is the default and the
+// only one off Windows, where the tool builds with:
+//
+//   g++ -std=c++14 -O2 -pthread -ISource Source/TraceReplay.cpp Source/GraphicsAPITrace.cpp Source/GraphicsAPI.cpp
+//       Source/GraphicsAPINull.cpp Source/GraphicsAPIValidation.cpp Source/CommandStream.cpp -o TraceReplay
+
+#if defined(_WIN32)
+#include "NativeWindow.h"
+#endif
+#include "GraphicsAPI.h"
+#include "GraphicsAPITrace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	bool LoadTrace(const char* filename, std::vector<uint32_t>& words)
+	{
+		FILE* fp = fopen(filename, "rb");
+		if (nullptr == fp) return false;
+
+		fseek(fp, 0, SEEK_END);
+		size_t length = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		words.resize((length + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+		size_t length_read = fread(words.data(), 1, length, fp);
+		fclose(fp);
+
+		return length == length_read && length % sizeof(uint32_t) == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s <trace file> [null|d3d11|d3d12] [runs]\n", argv[0]);
+		return 1;
+	}
+
+	bamboo::GraphicsAPIType type = bamboo::Null;
+	if (argc > 2)
+	{
+		if (0 == strcmp(argv[2], "null"))
+			type = bamboo::Null;
+		else if (0 == strcmp(argv[2], "d3d11"))
+			type = bamboo::Direct3D11;
+		else if (0 == strcmp(argv[2], "d3d12"))
+			type = bamboo::Direct3D12;
+		else
+		{
+			printf("unknown backend %s\n", argv[2]);
+			return 1;
+		}
+	}
+
+	int runs = argc > 3 ? atoi(argv[3]) : 1;
+	if (runs < 1) runs = 1;
+
+	std::vector<uint32_t> words;
+	bamboo::trace::Replay replay;
+	if (!LoadTrace(argv[1], words) || !replay.Load(words.data(), words.size() * sizeof(uint32_t)))
+	{
+		printf("can't read trace %s\n", argv[1]);
+		return 1;
+	}
+
+	void* windowHandle = nullptr;
+#if defined(_WIN32)
+	bamboo::win32::NativeWindow win(L"Bamboo Trace Replay", 1280, 720);
+	if (type != bamboo::Null)
+		windowHandle = win.GetHandle();
+#endif
+
+	bamboo::GraphicsAPI* api = bamboo::InitGraphicsAPI(type, windowHandle);
+	if (nullptr == api)
+	{
+		printf("can't create the %s backend\n", argc > 2 ? argv[2] : "null");
+		return 1;
+	}
+
+	for (int run = 0; run < runs; ++run)
+	{
+		double total = 0.0, minTime = 0.0, maxTime = 0.0;
+		uint32_t frameCount = 0;
+		double cpuTime;
+
+		replay.Begin(api);
+
+		while (replay.RunFrame(cpuTime))
+		{
+			printf("run %d frame %u: %.3f ms\n", run, frameCount, cpuTime);
+
+			if (0 == frameCount || cpuTime < minTime) minTime = cpuTime;
+			if (0 == frameCount || cpuTime > maxTime) maxTime = cpuTime;
+			total += cpuTime;
+			frameCount++;
+
+#if defined(_WIN32)
+			win.ProcessEvent();
+#endif
+		}
+
+		replay.End();
+
+		printf("run %d: %u frames, min %.3f ms, avg %.3f ms, max %.3f ms, total %.3f ms\n",
+			run, frameCount, minTime, frameCount > 0 ? total / frameCount : 0.0, maxTime, total);
+	}
+
+	api->Shutdown();
+
+	return 0;
+}
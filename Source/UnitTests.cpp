@@ -0,0 +1,703 @@
+// Unit tests of the parts of the engine that don't need a device.
+//
+//   UnitTests [test name]
+//
+// Runs every test, or the one named, prints the checks that failed and
+// returns 1 if any did. The GPU is stood in for by a fence whose completed
+// value lags the submitted one. Off Windows it builds with:
+//
+//   g++ -std=c++14 -O2 -pthread -ISource Source/UnitTests.cpp -o UnitTests
+
+#include "DeferredRelease.h"
+#include "DescriptorCache.h"
+#include "HandleAlloc.h"
+#include "PipelineCache.h"
+#include "RingAllocator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace bamboo;
+
+	uint32_t failures = 0;
+
+#define CHECK(x) \
+	do { if (!(x)) { printf("  %s:%d: %s\n", __FILE__, __LINE__, #x); failures++; } } while (0)
+
+	// xorshift, so a seed gives the same run everywhere
+	struct Random
+	{
+		uint32_t					state;
+
+		explicit Random(uint32_t seed) : state(seed * 2654435761u + 1) {}
+
+		uint32_t Range(uint32_t lo, uint32_t hi)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return lo + state % (hi - lo + 1);
+		}
+	};
+
+	// the GPU, it has finished the frames up to completed out of submitted
+	struct Fence
+	{
+		uint64_t					submitted;
+		uint64_t					completed;
+
+		Fence() : submitted(0), completed(0) {}
+
+		uint64_t Signal() { return ++submitted; }
+
+		// lets the GPU catch up until at most lag frames are in flight
+		void Catch(uint64_t lag)
+		{
+			if (submitted > completed + lag)
+				completed = submitted - lag;
+		}
+	};
+
+	// ---- HandleAlloc ----
+
+	void TestHandleAllocInvalid()
+	{
+		// grown to its full capacity, invalid has the index of the last slot
+		typedef HandleAlloc<5> alloc_t;
+		alloc_t alloc(alloc_t::maxCapacity);
+
+		uint32_t handles[alloc_t::maxCapacity];
+		for (uint32_t i = 0; i < alloc_t::maxCapacity; ++i)
+			handles[i] = alloc.Alloc();
+		CHECK(alloc_t::indexMask == alloc_t::GetIndex(alloc_t::invalid));
+		CHECK(alloc_t::indexMask == alloc_t::GetIndex(handles[alloc_t::maxCapacity - 1]));
+
+		// the last slot free, invalid still isn't a handle in use
+		alloc.Free(handles[alloc_t::maxCapacity - 1]);
+		CHECK(!alloc.InUse(alloc_t::invalid));
+
+		// and freeing or retiring it doesn't put the slot in the free list twice
+		alloc.Free(alloc_t::invalid);
+		alloc.Retire(alloc_t::invalid);
+		CHECK(alloc.Validate());
+		CHECK(alloc_t::maxCapacity - 1 == alloc.Count());
+		CHECK(0 == alloc.RetiredCount());
+		CHECK(alloc_t::invalid != alloc.Alloc());
+		CHECK(alloc_t::invalid == alloc.Alloc());
+		CHECK(alloc.Validate());
+	}
+
+	void TestConcurrentHandleAllocInvalid()
+	{
+		// the index of invalid is the last slot
+		typedef ConcurrentHandleAlloc<32, 5> alloc_t;
+		static alloc_t alloc;
+		alloc.Reset();
+
+		uint32_t handles[32];
+		for (uint32_t i = 0; i < 32; ++i)
+			handles[i] = alloc.Alloc();
+		CHECK(alloc_t::GetIndex(alloc_t::invalid) == alloc_t::GetIndex(handles[31]));
+
+		alloc.Free(handles[31]);
+		CHECK(!alloc.InUse(alloc_t::invalid));
+
+		// freeing invalid doesn't push the free slot again, it goes out once
+		alloc.Free(alloc_t::invalid);
+		CHECK(31 == alloc.Count());
+		CHECK(alloc_t::invalid != alloc.Alloc());
+		CHECK(alloc_t::invalid == alloc.Alloc());
+		CHECK(32 == alloc.Count());
+	}
+
+	// ---- RingAllocator ----
+
+	void TestRingAllocatorFrames()
+	{
+		typedef memory::RingAllocator<3> ring_t;
+		ring_t ring;
+		ring.initialize(1024);
+
+		// a frame is a pointer bump, aligned
+		CHECK(0 == ring.allocate(100, 1));
+		CHECK(256 == ring.allocate(100, 256));
+		CHECK(1024 - 356 == ring.freeRemaining());
+		CHECK(ring.finishFrame(1));
+
+		// the padding to 512 counts for the second frame
+		CHECK(512 == ring.allocate(256, 256));
+		CHECK(ring.finishFrame(2));
+		CHECK(1024 - 768 == ring.freeRemaining());
+
+		// no room before the end, wraps around, but the first frame is alive
+		CHECK(ring_t::invalid_offset == ring.allocate(300, 1));
+		CHECK(1024 - 768 == ring.freeRemaining());
+
+		// a fence that hasn't reached a frame gives nothing back
+		ring.retire(0);
+		CHECK(1024 - 768 == ring.freeRemaining());
+
+		// the first frame back, the allocation wraps to the start of the ring
+		ring.retire(1);
+		CHECK(1024 - 412 == ring.freeRemaining());
+		CHECK(0 == ring.allocate(300, 1));
+		CHECK(ring.finishFrame(3));
+
+		// the rest of the ring was skipped, and belongs to the third frame, what
+		// is left ends where the second frame starts
+		CHECK(1024 - 412 - 556 == ring.freeRemaining());
+		CHECK(ring_t::invalid_offset == ring.allocate(57, 1));
+		CHECK(300 == ring.allocate(56, 1));
+		CHECK(0 == ring.freeRemaining());
+
+		// too many frames pending, the oldest one is waited for
+		CHECK(ring.finishFrame(4));
+		CHECK(!ring.finishFrame(5));
+		CHECK(2 == ring.oldestFenceValue());
+		ring.retire(2);
+		CHECK(ring.finishFrame(5));
+
+		// the fence jumps past all of them, the ring starts over
+		ring.retire(5);
+		CHECK(1024 == ring.freeRemaining());
+		CHECK(0 == ring.allocate(1024, 256));
+		CHECK(ring_t::invalid_offset == ring.allocate(1, 1));
+		CHECK(ring.finishFrame(6));
+		ring.retire(6);
+		CHECK(ring_t::invalid_offset == ring.allocate(1025, 1));
+		CHECK(1024 == ring.freeRemaining());
+	}
+
+	// random frames against a fence that falls behind by a random number of
+	// frames, the live allocations must never overlap
+	void TestRingAllocatorFence()
+	{
+		constexpr uint64_t Capacity = 64 * 1024;
+		constexpr size_t MaxFrames = 4;
+
+		struct Block { uint64_t offset; uint64_t size; uint64_t fenceValue; };
+
+		memory::RingAllocator<MaxFrames> ring;
+		ring.initialize(Capacity);
+
+		Random random(7);
+		Fence fence;
+		std::vector<Block> live;
+		std::vector<uint8_t> owner(Capacity, 0);	// bytes of the live blocks
+		uint32_t wraps = 0;
+		uint32_t failed = 0;
+
+		for (uint32_t frame = 0; frame < 2000; ++frame)
+		{
+			uint64_t fenceValue = fence.submitted + 1;
+			uint64_t last = 0;
+			uint32_t count = random.Range(0, 12);
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint64_t size = random.Range(1, 4096);
+				uint64_t alignment = 1ull << random.Range(0, 8);
+				uint64_t freeBefore = ring.freeRemaining();
+				uint64_t offset = ring.allocate(size, alignment);
+
+				if (decltype(ring)::invalid_offset == offset)
+				{
+					CHECK(ring.freeRemaining() == freeBefore);
+					failed++;
+					continue;
+				}
+
+				CHECK(0 == offset % alignment);
+				CHECK(offset + size <= Capacity);
+				CHECK(freeBefore - ring.freeRemaining() >= size);
+				if (offset < last)
+					wraps++;
+				last = offset + size;
+
+				bool overlap = false;
+				for (uint64_t b = offset; b < offset + size; ++b)
+				{
+					overlap |= 0 != owner[b];
+					owner[b] = 1;
+				}
+				CHECK(!overlap);
+				live.push_back(Block{ offset, size, fenceValue });
+			}
+
+			CHECK(ring.finishFrame(fence.Signal()));
+
+			// the backend waits for the GPU when all the frames are in flight
+			fence.Catch(random.Range(0, MaxFrames - 1));
+			ring.retire(fence.completed);
+
+			for (size_t i = 0; i < live.size();)
+			{
+				if (live[i].fenceValue <= fence.completed)
+				{
+					memset(&owner[live[i].offset], 0, live[i].size);
+					live[i] = live.back();
+					live.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+
+			uint64_t liveBytes = 0;
+			for (const Block& block : live)
+				liveBytes += block.size;
+			CHECK(Capacity - ring.freeRemaining() >= liveBytes);
+		}
+
+		// the GPU catches up, everything is back
+		fence.Catch(0);
+		ring.retire(fence.completed);
+		CHECK(Capacity == ring.freeRemaining());
+		CHECK(wraps > 0);
+		CHECK(failed > 0);
+	}
+
+	// ---- DescriptorCache ----
+
+	// a table of one or two keys, the descriptors of a draw
+	template<typename Cache>
+	uint32_t Acquire(Cache& cache, uint64_t a, uint64_t b, bool& created)
+	{
+		uint64_t key[2] = { a, b };
+		return cache.Acquire(key, 0 != b ? 2 : 1, created);
+	}
+
+	template<typename Cache>
+	bool Cached(Cache& cache, uint64_t a, uint64_t b)
+	{
+		bool created;
+		return Cache::invalid_offset != Acquire(cache, a, b, created) && !created;
+	}
+
+	void TestDescriptorCacheHits()
+	{
+		DescriptorCache<16> cache;
+		cache.Init();
+		cache.SetFrame(1, 0);
+
+		bool created;
+		uint32_t offset = Acquire(cache, 1, 2, created);
+		CHECK(created);
+		CHECK(offset == Acquire(cache, 1, 2, created));
+		CHECK(!created);
+
+		// the keys, their order and their count make the table
+		CHECK(offset != Acquire(cache, 2, 1, created));
+		CHECK(created);
+		CHECK(offset != Acquire(cache, 1, 0, created));
+		CHECK(created);
+
+		const DescriptorCacheStatistics& stats = cache.GetStatistics();
+		CHECK(1 == stats.Hits);
+		CHECK(3 == stats.Misses);
+		CHECK(0 == stats.Evictions + stats.Invalidations + stats.Failures);
+
+		cache.ResetStatistics();
+		CHECK(0 == cache.GetStatistics().Hits);
+	}
+
+	void TestDescriptorCacheEviction()
+	{
+		DescriptorCache<8> cache;
+		cache.Init();
+
+		// fills the heap with 4 tables of 2 slots
+		bool created;
+		cache.SetFrame(1, 0);
+		Acquire(cache, 1, 2, created);
+		Acquire(cache, 3, 4, created);
+		cache.SetFrame(2, 0);
+		Acquire(cache, 5, 6, created);
+		Acquire(cache, 7, 8, created);
+
+		// nothing the GPU is done with, no room
+		cache.SetFrame(3, 0);
+		CHECK(DescriptorCache<8>::invalid_offset == Acquire(cache, 9, 10, created));
+		CHECK(1 == cache.GetStatistics().Failures);
+
+		// the first table used again, the second one is the oldest
+		CHECK(Cached(cache, 1, 2));
+		cache.SetFrame(4, 1);
+		CHECK(DescriptorCache<8>::invalid_offset != Acquire(cache, 9, 10, created));
+		CHECK(created);
+		CHECK(1 == cache.GetStatistics().Evictions);
+
+		// the frame 2 ones go next, in the order they were used, the one used
+		// in frame 3 stays until the GPU is done with frame 3
+		cache.SetFrame(5, 2);
+		Acquire(cache, 11, 12, created);
+		Acquire(cache, 13, 14, created);
+		CHECK(DescriptorCache<8>::invalid_offset == Acquire(cache, 15, 16, created));
+		CHECK(Cached(cache, 1, 2));
+		CHECK(Cached(cache, 9, 10));
+		CHECK(!Cached(cache, 3, 4) && !Cached(cache, 5, 6) && !Cached(cache, 7, 8));
+		CHECK(3 == cache.GetStatistics().Evictions);
+	}
+
+	void TestDescriptorCachePins()
+	{
+		DescriptorCache<4> cache;
+		cache.Init();
+
+		bool created;
+		cache.SetFrame(1, 0);
+		uint32_t pinned = Acquire(cache, 1, 2, created);
+		cache.Pin(pinned);
+		cache.Pin(pinned);
+		Acquire(cache, 3, 4, created);
+
+		// the pinned table is never evicted, however old
+		cache.SetFrame(10, 9);
+		CHECK(DescriptorCache<4>::invalid_offset != Acquire(cache, 5, 6, created));
+		CHECK(DescriptorCache<4>::invalid_offset == Acquire(cache, 7, 8, created));
+		CHECK(Cached(cache, 1, 2));
+
+		// pinned until as many Unpin
+		cache.Unpin(pinned);
+		cache.SetFrame(20, 19);
+		CHECK(DescriptorCache<4>::invalid_offset != Acquire(cache, 7, 8, created));
+		CHECK(DescriptorCache<4>::invalid_offset == Acquire(cache, 9, 10, created));
+		CHECK(Cached(cache, 1, 2));
+
+		// then it counts as used in the frame it was unpinned in
+		cache.Unpin(pinned);
+		cache.SetFrame(21, 19);
+		CHECK(DescriptorCache<4>::invalid_offset == Acquire(cache, 9, 10, created));
+		cache.SetFrame(22, 20);
+		CHECK(DescriptorCache<4>::invalid_offset != Acquire(cache, 9, 10, created));
+		CHECK(DescriptorCache<4>::invalid_offset != Acquire(cache, 11, 12, created));
+		CHECK(!Cached(cache, 1, 2));
+	}
+
+	void TestDescriptorCacheInvalidate()
+	{
+		DescriptorCache<8> cache;
+		cache.Init();
+
+		bool created;
+		cache.SetFrame(1, 0);
+		Acquire(cache, 1, 2, created);
+		Acquire(cache, 3, 0, created);
+		Acquire(cache, 4, 2, created);
+		Acquire(cache, 7, 7, created);
+
+		// every table with the key goes, once each
+		cache.Invalidate(2);
+		cache.Invalidate(7);
+		cache.Invalidate(99);
+		CHECK(3 == cache.GetStatistics().Invalidations);
+		CHECK(Cached(cache, 3, 0));
+
+		// the dropped ranges come back once the GPU is done with them, before
+		// any table still cached is evicted
+		cache.SetFrame(2, 0);
+		CHECK(DescriptorCache<8>::invalid_offset == Acquire(cache, 5, 6, created));
+		cache.ResetStatistics();
+		cache.SetFrame(3, 2);
+		CHECK(DescriptorCache<8>::invalid_offset != Acquire(cache, 5, 6, created));
+		CHECK(DescriptorCache<8>::invalid_offset != Acquire(cache, 8, 9, created));
+		CHECK(0 == cache.GetStatistics().Evictions);
+		CHECK(Cached(cache, 3, 0));
+		CHECK(!Cached(cache, 1, 2));
+
+		// a pinned table isn't found any more, but keeps its range until unpinned
+		cache.SetFrame(4, 3);
+		cache.ResetStatistics();
+		uint32_t pinned = Acquire(cache, 10, 0, created);
+		cache.Pin(pinned);
+		cache.Invalidate(10);
+		CHECK(1 == cache.GetStatistics().Invalidations);
+		CHECK(pinned != Acquire(cache, 10, 0, created));
+		CHECK(created);
+		cache.Unpin(pinned);
+	}
+
+	// ---- DeferredReleaseQueue ----
+
+	void TestDeferredReleaseOrder()
+	{
+		DeferredReleaseQueue<uint32_t> queue;
+		std::vector<uint32_t> released;
+		auto release = [&](uint32_t item) { released.push_back(item); };
+
+		const uint64_t fenceValues[] = { 1, 1, 2, 3, 3, 3, 5 };
+		for (uint32_t i = 0; i < 7; ++i)
+			queue.Push(fenceValues[i], i);
+		CHECK(7 == queue.Size());
+
+		// nothing before its fence value, then in the order they were pushed
+		CHECK(0 == queue.Retire(0, release));
+		CHECK(3 == queue.Retire(2, release));
+		CHECK(0 == queue.Retire(2, release));
+		CHECK(3 == queue.Retire(4, release));
+		CHECK(1 == queue.Size());
+		CHECK(6 == released.size() && 0 == released[0] && 2 == released[2] && 5 == released[5]);
+
+		// the fence may skip frames
+		queue.Push(7, 7);
+		queue.Push(9, 8);
+		CHECK(2 == queue.Retire(8, release));
+		CHECK(7 == released.back());
+		CHECK(!queue.Empty());
+
+		// Flush takes what is left, whatever its fence value
+		queue.Push(UINT64_MAX, 9);
+		CHECK(2 == queue.Flush(release));
+		CHECK(queue.Empty());
+		CHECK(0 == queue.Flush(release));
+		for (uint32_t i = 0; i < released.size(); ++i)
+			CHECK(i == released[i]);
+	}
+
+	void TestDeferredReleaseFence()
+	{
+		struct Item { uint32_t id; uint64_t fenceValue; };
+
+		DeferredReleaseQueue<Item> queue;
+		Random random(11);
+		Fence fence;
+		std::vector<uint64_t> fenceValues;		// of every item pushed, by id
+		uint32_t pushed = 0;
+		uint32_t released = 0;
+		bool early = false;
+
+		auto release = [&](const Item& item)
+		{
+			CHECK(item.id == released);
+			early |= item.fenceValue > fence.completed;
+			released++;
+		};
+
+		for (uint32_t frame = 0; frame < 2000; ++frame)
+		{
+			// destroyed in this frame, safe once its end is signaled
+			uint64_t fenceValue = fence.submitted + 1;
+			uint32_t count = random.Range(0, 40);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				fenceValues.push_back(fenceValue);
+				queue.Push(fenceValue, Item{ pushed++, fenceValue });
+			}
+			fence.Signal();
+
+			// the GPU lags, and Retire isn't called every frame
+			fence.Catch(random.Range(0, 3));
+			if (0 == random.Range(0, 2))
+			{
+				queue.Retire(fence.completed, release);
+
+				// what is left is what the GPU may still use
+				CHECK(released == pushed || fenceValues[released] > fence.completed);
+			}
+			CHECK(pushed - released == queue.Size());
+		}
+
+		CHECK(!early);
+		CHECK(released > 0 && !queue.Empty());
+
+		queue.Flush(release);
+		CHECK(pushed == released);
+		CHECK(queue.Empty());
+	}
+
+	// ---- PipelineCache ----
+
+	// a compile that waits for the test to open the gate, counting the
+	// objects it makes and Reset releases
+	struct GateJob
+	{
+		std::atomic<bool>*			gate;
+		std::atomic<bool>*			started;
+		std::atomic<int>*			live;
+		bool						made;
+
+		GateJob() : gate(nullptr), started(nullptr), live(nullptr), made(false) {}
+
+		bool Compile()
+		{
+			if (nullptr != started)
+				started->store(true);
+			while (nullptr != gate && !gate->load())
+				std::this_thread::yield();
+			made = true;
+			(*live)++;
+			return true;
+		}
+
+		void Reset()
+		{
+			if (made)
+				(*live)--;
+			made = false;
+		}
+	};
+
+	PipelineState Description(uint8_t cullMode)
+	{
+		PipelineState desc = {};
+		desc.BindingLayout.id = 1;
+		desc.VertexShader.id = 2;
+		desc.PixelShader.id = 3;
+		desc.CullMode = cullMode;
+		return desc;
+	}
+
+	void TestPipelineCacheFree()
+	{
+		std::atomic<bool> gate(false);
+		std::atomic<bool> started(false);
+		std::atomic<bool> opened(false);
+		std::atomic<int> live(0);
+
+		PipelineCache<GateJob> cache;
+		cache.Init(2, 1);
+
+		// one compile held running on the only thread, one queued behind it
+		bool created;
+		uint32_t running = cache.Acquire(Description(0), 1, 2, created);
+		GateJob& job = cache.GetJob(running);
+		job.gate = &gate;
+		job.started = &started;
+		job.live = &live;
+		cache.Compile(running);
+
+		uint32_t queued = cache.Acquire(Description(1), 1, 2, created);
+		cache.GetJob(queued).live = &live;
+		cache.Compile(queued);
+
+		while (!started.load())
+			std::this_thread::yield();
+
+		// opens the gate late if Free waits for the compile
+		std::thread opener([&]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			opened.store(true);
+			gate.store(true);
+		});
+
+		// the queued one is dropped and its entry comes back at once
+		CHECK(cache.Release(queued));
+		cache.Free(queued);
+		CHECK(cache.Release(running));
+		cache.Free(running);
+		CHECK(!opened.load());
+
+		// the running one keeps its entry until Poll takes in its result
+		CHECK(PipelineCache<GateJob>::invalid_entry != cache.Acquire(Description(2), 1, 2, created));
+		CHECK(PipelineCache<GateJob>::invalid_entry == cache.Acquire(Description(3), 1, 2, created));
+
+		gate.store(true);
+		opener.join();
+
+		uint32_t entry = PipelineCache<GateJob>::invalid_entry;
+		for (uint32_t i = 0; i < 1000 && PipelineCache<GateJob>::invalid_entry == entry; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			cache.Poll();
+			entry = cache.Acquire(Description(3), 1, 2, created);
+		}
+		CHECK(PipelineCache<GateJob>::invalid_entry != entry && created);
+
+		// what the freed compile made is released, the queued one never ran
+		CHECK(0 == live.load());
+		CHECK(1 == cache.GetStatistics().Compiles);
+
+		cache.Shutdown();
+	}
+
+	void TestPipelineCacheShaders()
+	{
+		std::atomic<int> live(0);
+		PipelineCache<GateJob> cache;
+		cache.Init(8, 0);
+
+		bool created;
+		uint32_t entry = cache.Acquire(Description(0), 1, 2, created);
+		CHECK(created);
+		cache.GetJob(entry).live = &live;
+		cache.Compile(entry);
+		CHECK(cache.Ready(entry));
+
+		// other handles of the same bytecode share it, other bytecode doesn't
+		PipelineState desc = Description(0);
+		desc.VertexShader.id = 12;
+		desc.PixelShader.id = 13;
+		CHECK(entry == cache.Acquire(desc, 1, 2, created));
+		CHECK(!created);
+		CHECK(entry != cache.Acquire(Description(0), 1, 3, created));
+		CHECK(created);
+		CHECK(entry != cache.Acquire(Description(0), 4, 2, created));
+		CHECK(created);
+
+		CHECK(1 == cache.GetStatistics().Shared);
+
+		CHECK(!cache.Release(entry));
+		CHECK(cache.Release(entry));
+		cache.Free(entry);
+		CHECK(0 == live.load());
+	}
+
+	struct Test
+	{
+		const char*					name;
+		void						(*run)();
+	};
+
+	const Test tests[] =
+	{
+		{ "HandleAllocInvalid", TestHandleAllocInvalid },
+		{ "ConcurrentHandleAllocInvalid", TestConcurrentHandleAllocInvalid },
+		{ "RingAllocatorFrames", TestRingAllocatorFrames },
+		{ "RingAllocatorFence", TestRingAllocatorFence },
+		{ "DescriptorCacheHits", TestDescriptorCacheHits },
+		{ "DescriptorCacheEviction", TestDescriptorCacheEviction },
+		{ "DescriptorCachePins", TestDescriptorCachePins },
+		{ "DescriptorCacheInvalidate", TestDescriptorCacheInvalidate },
+		{ "DeferredReleaseOrder", TestDeferredReleaseOrder },
+		{ "DeferredReleaseFence", TestDeferredReleaseFence },
+		{ "PipelineCacheFree", TestPipelineCacheFree },
+		{ "PipelineCacheShaders", TestPipelineCacheShaders },
+	};
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t run = 0;
+	uint32_t failed = 0;
+
+	for (const Test& test : tests)
+	{
+		if (argc > 1 && 0 != strcmp(argv[1], test.name))
+			continue;
+
+		uint32_t before = failures;
+		test.run();
+		printf("%-32s %s\n", test.name, failures == before ? "ok" : "FAILED");
+
+		run++;
+		if (failures != before)
+			failed++;
+	}
+
+	if (0 == run)
+	{
+		printf("no test named %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("%u tests, %u failed\n", run, failed);
+	return 0 == failed ? 0 : 1;
+}
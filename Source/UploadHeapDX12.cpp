@@ -10,12 +10,29 @@ namespace bamboo
 	namespace dx12
 	{
 
+#if UPLOAD_HEAP_TRACE
+		// in the format AllocatorBench reads, a request that failed is freed at once
+		inline void TraceAlloc(FILE* fp, uint64_t id, uint64_t size)
+		{
+			if (nullptr != fp)
+				fprintf(fp, "+ %llu %llu\n", static_cast<unsigned long long>(id), static_cast<unsigned long long>(size));
+		}
+
+		inline void TraceFree(FILE* fp, uint64_t id)
+		{
+			if (nullptr != fp)
+				fprintf(fp, "- %llu\n", static_cast<unsigned long long>(id));
+		}
+#endif
+
 #pragma region Sync Upload Heap
 
 		bool UploadHeapSyncDX12::Init(ID3D12Device * device, ID3D12GraphicsCommandList * cmdList)
 		{
 			this->device = device;
 			this->cmdList = cmdList;
+			ringBuffer = nullptr;
+			ringData = nullptr;
 
 			CD3DX12_HEAP_DESC heapDesc(UploadHeapSize, D3D12_HEAP_TYPE_UPLOAD, 0Ui64,
 				(D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES | D3D12_HEAP_FLAG_DENY_NON_RT_DS_TEXTURES));
@@ -26,7 +43,37 @@ namespace bamboo
 
 			alloc = alloc_t::create(treeMem);
 
+			CD3DX12_HEAP_PROPERTIES ringHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+			CD3DX12_RESOURCE_DESC ringDesc = CD3DX12_RESOURCE_DESC::Buffer(UploadRingSize);
+			if (FAILED(device->CreateCommittedResource(
+				&ringHeapProps,
+				D3D12_HEAP_FLAG_NONE,
+				&ringDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(&ringBuffer))))
+			{
+				return false;
+			}
+
+			// never read by cpu, stays mapped until Release
+			D3D12_RANGE range = { 0, 0 };
+			if (FAILED(ringBuffer->Map(0, &range, reinterpret_cast<void**>(&ringData))))
+			{
+				return false;
+			}
+
+			ring.initialize(UploadRingSize);
+
 			bufferCount = 0;
+			stats = {};
+
+#if UPLOAD_HEAP_TRACE
+			traceFile = fopen("upload_heap.trace", "w");
+			traceCount = 0;
+			if (nullptr != traceFile)
+				fprintf(traceFile, "# bamboo allocation trace, upload heap\n");
+#endif
 			return true;
 		}
 
@@ -35,7 +82,14 @@ namespace bamboo
 			if (bufferCount >= UploadHeapQueueSize)
 				return false;
 
-			uint32_t bufIdx = bufferCount;
+#if UPLOAD_HEAP_FAST_REJECT
+			// the heap is full, don't bother asking for the footprint
+			if (0 == alloc->largestFree())
+			{
+				stats.failedCount++;
+				return false;
+			}
+#endif
 
 			UINT64 size = GetRequiredIntermediateSize(destRes, firstSubRes, subResCount);
 			/*if (0 != rowPitch && 0 == size)
@@ -46,13 +100,71 @@ namespace bamboo
 				size = static_cast<uint32_t>(requiredSize);
 			}*/
 
-			void* ptr = alloc->allocate(reinterpret_cast<void*>(0x10), static_cast<uint32_t>(size));
+			ID3D12Resource* uploadRes = AllocateUploadBuffer(size);
+			if (nullptr == uploadRes)
+				return false;
+
+			UpdateSubresources(cmdList, destRes, uploadRes, 0, firstSubRes, subResCount, data);
+
+			return true;
+		}
+
+		bool UploadHeapSyncDX12::UploadResource(ID3D12Resource* destRes, const void* data, size_t size, uint64_t destOffset)
+		{
+			ID3D12Resource* uploadRes = AllocateUploadBuffer(size);
+			if (nullptr == uploadRes)
+				return false;
+
+			void* pData = nullptr;
+			D3D12_RANGE range = { 0, 0 };
+			if (FAILED(uploadRes->Map(0, &range, &pData)))
+				return false;
+			memcpy(pData, data, size);
+			uploadRes->Unmap(0, nullptr);
+
+			cmdList->CopyBufferRegion(destRes, destOffset, uploadRes, 0, size);
+
+			return true;
+		}
+
+		ID3D12Resource* UploadHeapSyncDX12::AllocateUploadBuffer(uint64_t size)
+		{
+			if (bufferCount >= UploadHeapQueueSize)
+				return nullptr;
+
+			uint32_t bufIdx = bufferCount;
+
+#if UPLOAD_HEAP_FAST_REJECT
+			if (size > UploadHeapSize || !alloc->canAllocate(static_cast<size_t>(size)))
+#else
+			if (size > UploadHeapSize)
+#endif
+			{
+#if UPLOAD_HEAP_TRACE
+				TraceAlloc(traceFile, traceCount, size);
+				TraceFree(traceFile, traceCount++);
+#endif
+				stats.failedCount++;
+				return nullptr;
+			}
+
+			UINT64 freeSize = alloc->freeRemaining();
+			void* ptr = alloc->allocate(reinterpret_cast<void*>(0x10), static_cast<size_t>(size));
 			if (nullptr == ptr)
 			{
-				return false;
+#if UPLOAD_HEAP_TRACE
+				TraceAlloc(traceFile, traceCount, size);
+				TraceFree(traceFile, traceCount++);
+#endif
+				stats.failedCount++;
+				return nullptr;
 			}
+#if UPLOAD_HEAP_VALIDATION
+			assert(alloc->validate());
+#endif
 
 			UINT64 offset = reinterpret_cast<UINT64>(ptr) - 0x10u;
+			UINT64 usedSize = freeSize - alloc->freeRemaining();
 
 			ID3D12Resource* uploadRes = nullptr;
 			D3D12_RESOURCE_DESC uploadDesc = {};
@@ -73,56 +185,51 @@ namespace bamboo
 				IID_PPV_ARGS(&uploadRes))))
 			{
 				alloc->deallocate(nullptr, reinterpret_cast<void*>(offset));
-				return false;
+				return nullptr;
 			}
 
-			buffers[bufIdx].offset = static_cast<uint32_t>(offset);
+			buffers[bufIdx].offset = offset;
+			buffers[bufIdx].size = size;
+			buffers[bufIdx].usedSize = usedSize;
 			buffers[bufIdx].resource = uploadRes;
+#if UPLOAD_HEAP_TRACE
+			buffers[bufIdx].traceId = traceCount++;
+			TraceAlloc(traceFile, buffers[bufIdx].traceId, size);
+#endif
 
-			UpdateSubresources(cmdList, destRes, uploadRes, 0, firstSubRes, subResCount, data);
-
-			/*void* pData = nullptr;
-			D3D12_RANGE range = { 0, 0 };
-			if (FAILED(uploadRes->Map(0, &range, &pData)))
-			{
-				return false;
-			}
-			memcpy(pData, data, size);
-			uploadRes->Unmap(0, nullptr);*/
+			stats.uploadCount++;
+			stats.requestedBytes += size;
+			stats.usedBytes += usedSize;
+			if (stats.usedBytes > stats.peakUsedBytes)
+				stats.peakUsedBytes = stats.usedBytes;
 
+			bufferCount++;
 
+			return uploadRes;
+		}
 
-			/*cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(destRes,
-				D3D12_RESOURCE_STATE_COMMON,
-				D3D12_RESOURCE_STATE_COPY_DEST));*/
-
-			//if (0 == rowPitch) // for buffer
-			//{
-			//	cmdList->CopyBufferRegion(destRes, 0, uploadRes, 0, size);
-			//}
-			//else // for texture
-			//{
-			//	D3D12_RESOURCE_DESC destDesc = destRes->GetDesc();
-			//	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint =
-			//	{
-			//		0,
-			//		CD3DX12_SUBRESOURCE_FOOTPRINT(destDesc, rowPitch)
-			//	};
-			//	CD3DX12_TEXTURE_COPY_LOCATION srcLoc(uploadRes, footprint);
-			//	CD3DX12_TEXTURE_COPY_LOCATION destLoc(destRes, 0);
-
-			//	cmdList->CopyTextureRegion(&destLoc, 0, 0, 0, &srcLoc, nullptr);
-			//}
-
-			/*cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(destRes,
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				D3D12_RESOURCE_STATE_COMMON));*/
+		bool UploadHeapSyncDX12::UploadBuffer(ID3D12Resource* destRes, const void* data, size_t size, uint64_t destOffset)
+		{
+			uint64_t offset = ring.allocate(size, UploadRingAlignment);
+			if (memory::RingAllocator<>::invalid_offset == offset)
+				return UploadResource(destRes, data, size, destOffset);
 
-			bufferCount++;
+			memcpy(ringData + offset, data, size);
+			cmdList->CopyBufferRegion(destRes, destOffset, ringBuffer, offset, size);
 
 			return true;
 		}
 
+		bool UploadHeapSyncDX12::FinishFrame(uint64_t fenceValue)
+		{
+			return ring.finishFrame(fenceValue);
+		}
+
+		void UploadHeapSyncDX12::Retire(uint64_t completedFenceValue)
+		{
+			ring.retire(completedFenceValue);
+		}
+
 		void UploadHeapSyncDX12::Clear()
 		{
 			for (uint32_t i = 0; i < bufferCount; i++)
@@ -130,6 +237,15 @@ namespace bamboo
 				UINT64 addr = buffers[i].offset;
 				alloc->deallocate(nullptr, reinterpret_cast<void*>(addr));
 				buffers[i].resource->Release();
+#if UPLOAD_HEAP_VALIDATION
+				assert(alloc->validate());
+#endif
+
+				stats.requestedBytes -= buffers[i].size;
+				stats.usedBytes -= buffers[i].usedSize;
+#if UPLOAD_HEAP_TRACE
+				TraceFree(traceFile, buffers[i].traceId);
+#endif
 			}
 			bufferCount = 0;
 		}
@@ -138,6 +254,16 @@ namespace bamboo
 		{
 			Clear();
 			RELEASE(heap);
+
+			if (nullptr != ringBuffer)
+				ringBuffer->Unmap(0, nullptr);
+			RELEASE(ringBuffer);
+
+#if UPLOAD_HEAP_TRACE
+			if (nullptr != traceFile)
+				fclose(traceFile);
+			traceFile = nullptr;
+#endif
 		}
 
 
@@ -221,7 +347,7 @@ namespace bamboo
 			return true;
 		}
 
-		bool UploadHeapDX12::UploadResource(ID3D12Resource* destRes, size_t size, const void* data, uint32_t rowPitch)
+		bool UploadHeapDX12::UploadResource(ID3D12Resource* destRes, size_t size, const void* data, uint32_t rowPitch, uint64_t destOffset)
 		{
 			CheckFence();
 
@@ -236,10 +362,17 @@ namespace bamboo
 				D3D12_RESOURCE_DESC resDesc = destRes->GetDesc();
 				UINT64 requiredSize = 0;
 				device->GetCopyableFootprints(&resDesc, 0, 1, 0, nullptr, nullptr, nullptr, &requiredSize);
-				size = static_cast<uint32_t>(requiredSize);
+				size = static_cast<size_t>(requiredSize);
 			}
 
-			void* ptr = alloc->allocate(reinterpret_cast<void*>(0x10), static_cast<uint32_t>(size));
+#if UPLOAD_HEAP_FAST_REJECT
+			if (size > UploadHeapSize || !alloc->canAllocate(static_cast<size_t>(size)))
+#else
+			if (size > UploadHeapSize)
+#endif
+				return false;
+
+			void* ptr = alloc->allocate(reinterpret_cast<void*>(0x10), static_cast<size_t>(size));
 			if (nullptr == ptr)
 			{
 				return false;
@@ -269,7 +402,7 @@ namespace bamboo
 				return false;
 			}
 
-			ringBuffer[tail].offset = static_cast<uint32_t>(offset);
+			ringBuffer[tail].offset = offset;
 			ringBuffer[tail].resource = uploadRes;
 
 			void* pData = nullptr;
@@ -288,7 +421,7 @@ namespace bamboo
 
 			if (0 == rowPitch) // for buffer
 			{
-				cmdList->CopyBufferRegion(destRes, 0, uploadRes, 0, size);
+				cmdList->CopyBufferRegion(destRes, destOffset, uploadRes, 0, size);
 			}
 			else // for texture
 			{
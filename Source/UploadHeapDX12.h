@@ -1,8 +1,11 @@
 #pragma once
 
 #include "BuddyAllocator.h"
+#include "TLSFAllocator.h"
+#include "RingAllocator.h"
 
 #include <cstdint>
+#include <cstdio>
 
 struct ID3D12Device;
 struct ID3D12CommandAllocator;
@@ -18,40 +21,138 @@ namespace bamboo
 {
 	namespace dx12
 	{
-		constexpr size_t UploadHeapSize = 32 * 1024 * 1024; // 32 MB
-		constexpr size_t UploadHeapBufferMinSize = 64 * 1024; // 64 KB
+		constexpr uint64_t UploadHeapSize = 32 * 1024 * 1024; // 32 MB
+		constexpr uint64_t UploadHeapBufferMinSize = 64 * 1024; // 64 KB
 		constexpr size_t UploadHeapQueueSize = 1024;
+		constexpr uint64_t UploadRingSize = 4 * 1024 * 1024; // 4 MB
+		constexpr uint64_t UploadRingAlignment = 16;
+
+// TLSF only rounds sizes up to UploadHeapBufferMinSize (the placement
+// alignment), the buddy allocators round them up to a power of 2
+#define USING_TLSF_ALLOCATOR 1
+#define USING_FAST_BUDDY_ALLOCATOR 1
+
+#if USING_TLSF_ALLOCATOR
+		typedef bamboo::memory::TLSFAllocator<UploadHeapSize, UploadHeapBufferMinSize> upload_alloc_t;
+#elif USING_FAST_BUDDY_ALLOCATOR
+		typedef bamboo::memory::FastBuddyAllocator<UploadHeapSize, UploadHeapBufferMinSize> upload_alloc_t;
+#else
+		typedef bamboo::memory::BuddyAllocator<static_cast<unsigned int>(UploadHeapSize), static_cast<unsigned int>(UploadHeapBufferMinSize)> upload_alloc_t;
+#endif
+
+// the allocator knows its largest free block in O(1), an upload that can't
+// fit is rejected before any work. The old BuddyAllocator only counts bytes.
+#define UPLOAD_HEAP_FAST_REJECT (USING_TLSF_ALLOCATOR || USING_FAST_BUDDY_ALLOCATOR)
+
+// check the allocator invariants after every allocation and free (slow),
+// needs TLSF or the fast buddy allocator
+#define UPLOAD_HEAP_VALIDATION 0
+
+// write the requests of the sync upload heap to upload_heap.trace, to be
+// replayed by AllocatorBench
+#define UPLOAD_HEAP_TRACE 0
+
+		struct UploadHeapStats
+		{
+			uint64_t					uploadCount;
+			uint64_t					failedCount;		// uploads rejected for lack of space
+			uint64_t					requestedBytes;		// asked for by the uploads in flight
+			uint64_t					usedBytes;			// taken from the heap by the uploads in flight
+			uint64_t					peakUsedBytes;
+		};
 
 		struct UploadHeapSyncDX12
 		{
-			typedef bamboo::memory::BuddyAllocator<UploadHeapSize, UploadHeapBufferMinSize> alloc_t;
+			typedef upload_alloc_t alloc_t;
 
 			bool Init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
 
 			bool UploadResource(ID3D12Resource* destRes, uint32_t firstSubRes, uint32_t subResCount, D3D12_SUBRESOURCE_DATA* data);
 
+			// copy to a buffer at destOffset through a buffer placed in the heap
+			bool UploadResource(ID3D12Resource* destRes, const void* data, size_t size, uint64_t destOffset);
+
+			// copy to a buffer through the ring, falls back to UploadResource if the ring is full
+			bool UploadBuffer(ID3D12Resource* destRes, const void* data, size_t size, uint64_t destOffset = 0);
+
+			// the ring space taken so far is given back once the fence reaches fenceValue.
+			// false if too many frames are pending, the caller waits for the fence to
+			// reach GetOldestFrameFence, calls Retire and tries again
+			bool FinishFrame(uint64_t fenceValue);
+
+			uint64_t GetOldestFrameFence() const { return ring.oldestFenceValue(); }
+
+			void Retire(uint64_t completedFenceValue);
+
 			void Clear();
 
 			void Release();
 
+			// occupancy of the heap, O(1)
+			size_t GetFreeSize() const { return static_cast<size_t>(alloc->freeRemaining()); }
+
+			size_t GetUsedSize() const { return static_cast<size_t>(UploadHeapSize - alloc->freeRemaining()); }
+
+#if UPLOAD_HEAP_FAST_REJECT
+			size_t GetLargestFreeBlock() const { return static_cast<size_t>(alloc->largestFree()); }
+#endif
+
+			const UploadHeapStats& GetStats() const { return stats; }
+
+			// a buffer placed in the heap, kept until Clear. nullptr if the heap or
+			// the queue is full
+			ID3D12Resource* AllocateUploadBuffer(uint64_t size);
+
+			// part of the used space lost to rounding
+			float GetInternalFragmentation() const
+			{
+				return stats.usedBytes > 0 ? 1.0f - float(stats.requestedBytes) / float(stats.usedBytes) : 0.0f;
+			}
+
+#if UPLOAD_HEAP_FAST_REJECT
+			// part of the free space that can't be handed out as one block
+			float GetExternalFragmentation() const
+			{
+				size_t freeSize = GetFreeSize();
+				return freeSize > 0 ? 1.0f - float(GetLargestFreeBlock()) / float(freeSize) : 0.0f;
+			}
+#endif
+
 			ID3D12Device*				device;
 			ID3D12GraphicsCommandList*	cmdList;
 			ID3D12Heap*					heap;
 
 			alloc_t*					alloc;
-			uint8_t						treeMem[alloc_t::treeSize];
+			alignas(alloc_t) uint8_t	treeMem[alloc_t::treeSize];
+
+			// persistently mapped buffer for transient uploads
+			ID3D12Resource*				ringBuffer;
+			uint8_t*					ringData;
+			memory::RingAllocator<>		ring;
 
 			struct
 			{
-				uint32_t				offset;
+				uint64_t				offset;
+				uint64_t				size;
+				uint64_t				usedSize;
 				ID3D12Resource*			resource;
+#if UPLOAD_HEAP_TRACE
+				uint64_t				traceId;
+#endif
 			}							buffers[UploadHeapQueueSize];
 			uint32_t					bufferCount;
+
+			UploadHeapStats				stats;
+
+#if UPLOAD_HEAP_TRACE
+			FILE*						traceFile;
+			uint64_t					traceCount;		// requests written so far, the next id
+#endif
 		};
 
 		struct UploadHeapDX12
 		{
-			typedef bamboo::memory::BuddyAllocator<UploadHeapSize, UploadHeapBufferMinSize> alloc_t;
+			typedef upload_alloc_t alloc_t;
 
 			UploadHeapDX12()
 				:
@@ -70,7 +171,8 @@ namespace bamboo
 
 			bool Init(ID3D12Device* device);
 
-			bool UploadResource(ID3D12Resource* destRes, size_t size, const void* data, uint32_t rowPitch);
+			// a buffer when rowPitch is 0, copied to destOffset
+			bool UploadResource(ID3D12Resource* destRes, size_t size, const void* data, uint32_t rowPitch, uint64_t destOffset = 0);
 
 			void Execute();
 			
@@ -91,11 +193,11 @@ namespace bamboo
 			void*						hEvent;
 
 			alloc_t*					alloc;
-			uint8_t						treeMem[alloc_t::treeSize];
+			alignas(alloc_t) uint8_t	treeMem[alloc_t::treeSize];
 
 			struct
 			{
-				uint32_t				offset;
+				uint64_t				offset;
 				ID3D12Resource*			resource;
 			}							ringBuffer[UploadHeapQueueSize];
 
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BAMBOO_PREFETCH(addr) _mm_prefetch(reinterpret_cast<const char*>(addr), _MM_HINT_T0)
+#else
+#define BAMBOO_PREFETCH(addr) __builtin_prefetch(addr)
+#endif
+
 namespace bamboo
 {
 	enum result_t